@@ -205,6 +205,11 @@ struct intel_context {
 		struct list_head requests;
 		/** @prio: the context's current guc priority */
 		u8 prio;
+		/**
+		 * @base_prio: the guc priority the context was initialized
+		 * with, not affected by priority boosts of inflight requests
+		 */
+		u8 base_prio;
 		/**
 		 * @prio_count: a counter of the number requests in flight in
 		 * each priority bucket
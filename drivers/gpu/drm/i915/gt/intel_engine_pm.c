@@ -16,6 +16,7 @@
 #include "intel_ring.h"
 #include "shmem_utils.h"
 #include "intel_gt_regs.h"
+#include "iov/intel_iov_memirq.h"
 
 static void intel_gsc_idle_msg_enable(struct intel_engine_cs *engine)
 {
@@ -91,6 +92,7 @@ static int __engine_unpark(struct intel_wakeref *wf)
 	if (engine->unpark)
 		engine->unpark(engine);
 
+	intel_iov_memirq_engine_unpark(engine);
 	intel_breadcrumbs_unpark(engine->breadcrumbs);
 	intel_engine_unpark_heartbeat(engine);
 	return 0;
@@ -277,6 +279,7 @@ static int __engine_park(struct intel_wakeref *wf)
 
 	intel_engine_park_heartbeat(engine);
 	intel_breadcrumbs_park(engine->breadcrumbs);
+	intel_iov_memirq_engine_park(engine);
 
 	if (engine->park)
 		engine->park(engine);
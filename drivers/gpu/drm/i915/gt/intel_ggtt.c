@@ -356,9 +356,9 @@ static void gen8_ggtt_bind_put_ce(struct intel_context *ce)
 	intel_gt_pm_put(ce->engine->gt);
 }
 
-static bool gen8_ggtt_bind_ptes(struct i915_ggtt *ggtt, u32 offset,
-				struct sg_table *pages, u32 num_entries,
-				const gen8_pte_t pte)
+static bool __gen8_ggtt_bind_ptes(struct i915_ggtt *ggtt, u32 offset,
+				  struct sg_table *pages, const gen8_pte_t *ptes,
+				  u32 num_entries, const gen8_pte_t pte)
 {
 	struct i915_sched_attr attr = {};
 	struct intel_gt *gt = ggtt->vm.gt;
@@ -407,7 +407,11 @@ static bool gen8_ggtt_bind_ptes(struct i915_ggtt *ggtt, u32 offset,
 		*cs++ = MI_UPDATE_GTT | (2 * n_ptes);
 		*cs++ = offset << 12;
 
-		if (pages) {
+		if (ptes) {
+			memcpy(cs, ptes, n_ptes * sizeof(*ptes));
+			cs += n_ptes * 2;
+			ptes += n_ptes;
+		} else if (pages) {
 			for_each_sgt_daddr_next(addr, iter) {
 				if (count == n_ptes)
 					break;
@@ -454,6 +458,13 @@ put_ce:
 	return false;
 }
 
+static bool gen8_ggtt_bind_ptes(struct i915_ggtt *ggtt, u32 offset,
+				struct sg_table *pages, u32 num_entries,
+				const gen8_pte_t pte)
+{
+	return __gen8_ggtt_bind_ptes(ggtt, offset, pages, NULL, num_entries, pte);
+}
+
 static void gen8_set_pte(void __iomem *addr, gen8_pte_t pte)
 {
 	writeq(pte, addr);
@@ -1526,7 +1537,7 @@ static void ggtt_insert_entries_vf_relay_wa(struct i915_address_space *vm,
 
 	/*
 	 * We want to flush the TLBs only after we're certain all the PTE
-	 * updates have finished.
+	 * updates have finished, i.e. PF acked all pipelined requests.
 	 */
 	intel_iov_ggtt_vf_flush_ptes(iov);
 	mutex_unlock(&iov->vf.ptes_buffer.lock);
@@ -1841,8 +1852,10 @@ static void sgtable_update_shadow_ggtt(struct i915_ggtt *ggtt, unsigned int vfid
 		return;
 	}
 
-	for_each_sgt_daddr(addr, iter, st)
+	for_each_sgt_daddr(addr, iter, st) {
 		intel_iov_ggtt_shadow_set_pte(iov, vfid, ggtt_addr, pte_pattern | addr);
+		ggtt_addr += I915_GTT_PAGE_SIZE_4K;
+	}
 }
 
 int i915_ggtt_sgtable_update_ptes(struct i915_ggtt *ggtt, unsigned int vfid, u64 ggtt_addr,
@@ -1881,6 +1894,53 @@ out:
 	return (ret) ? 0 : -EIO;
 }
 
+/**
+ * i915_ggtt_write_vf_ptes - write already encoded PTEs into the VF GGTT range
+ * @ggtt: the &struct i915_ggtt
+ * @vfid: VF identifier
+ * @ggtt_addr: GGTT address of the first PTE
+ * @ptes: array of PTEs to write
+ * @num_entries: number of PTEs in the @ptes array
+ *
+ * Unlike i915_ggtt_sgtable_update_ptes() this function doesn't need any
+ * sg_table, PTEs are copied directly from the @ptes array. The caller is
+ * responsible for the GGTT invalidation once all PTEs are written.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int i915_ggtt_write_vf_ptes(struct i915_ggtt *ggtt, unsigned int vfid, u64 ggtt_addr,
+			    const gen8_pte_t *ptes, u32 num_entries)
+{
+	struct intel_iov *iov = &ggtt->vm.gt->iov;
+	gen8_pte_t __iomem *gtt_entries;
+	u32 i;
+
+	GEM_BUG_ON(!IS_SRIOV_PF(ggtt->vm.i915));
+
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+	if (iov->pf.ggtt.selftest.mock_write_ptes)
+		return iov->pf.ggtt.selftest.mock_write_ptes(iov, ggtt_addr, ptes, num_entries);
+#endif
+
+	if (should_update_ggtt_with_bind(ggtt)) {
+		if (!__gen8_ggtt_bind_ptes(ggtt, ggtt_addr >> PAGE_SHIFT, NULL, ptes,
+					   num_entries, 0))
+			return -EIO;
+	} else {
+		/* see sgtable_update_ptes_via_cpu() */
+		WARN_ON(i915_ggtt_require_binder(ggtt->vm.i915));
+
+		gtt_entries = (gen8_pte_t __iomem *)ggtt->gsm + ggtt_addr / I915_GTT_PAGE_SIZE;
+		for (i = 0; i < num_entries; i++)
+			gen8_set_pte(gtt_entries++, ptes[i]);
+	}
+
+	if (vfid != PFID)
+		intel_iov_ggtt_shadow_set_ptes(iov, vfid, ggtt_addr, ptes, num_entries);
+
+	return 0;
+}
+
 static gen8_pte_t tgl_prepare_vf_pte_vfid(u16 vfid)
 {
 	GEM_BUG_ON(!FIELD_FIT(TGL_GGTT_PTE_VFID_MASK, vfid));
@@ -1908,6 +1968,14 @@ void i915_ggtt_set_space_owner(struct i915_ggtt *ggtt, u16 vfid,
 	gt_dbg(ggtt->vm.gt, "GGTT VF%u [%#llx-%#llx] %lluK\n",
 	       vfid, base, base + size, size / SZ_1K);
 
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+	if (ggtt->vm.gt->iov.pf.ggtt.selftest.mock_set_space_owner) {
+		ggtt->vm.gt->iov.pf.ggtt.selftest.mock_set_space_owner(&ggtt->vm.gt->iov,
+									vfid, node);
+		return;
+	}
+#endif
+
 	/* Wa_22018453856 */
 	if (i915_ggtt_require_binder(ggtt->vm.i915) &&
 	    should_update_ggtt_with_bind(ggtt) &&
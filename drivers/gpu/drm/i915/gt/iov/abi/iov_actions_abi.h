@@ -216,4 +216,146 @@
 #define VF2PF_UPDATE_GGTT32_IS_LAST_MODE(_mode) \
 	((_mode) == VF2PF_UPDATE_GGTT32_MODE_DUPLICATE_LAST || \
 	 (_mode) == VF2PF_UPDATE_GGTT32_MODE_REPLICATE_LAST)
+
+/**
+ * DOC: VF2PF_UPDATE_GGTT_RANGES
+ *
+ * This `IOV Message`_ is used to request the PF to update the GGTT mapping
+ * using run-length encoded ranges of PTEs provided by the VF.
+ * Each range describes %COUNT consecutive GGTT entries. The first entry uses
+ * the provided PTE, each next entry is generated by the PF from the previous
+ * one by advancing its GPA by %INCREMENT pages (0 means exact duplicate).
+ * Ranges are applied back to back, starting from the %OFFSET.
+ *
+ * This message is available since VFPF interface version 1.1.
+ *
+ *  +---+-------+--------------------------------------------------------------+
+ *  |   | Bits  | Description                                                  |
+ *  +===+=======+==============================================================+
+ *  | 0 |    31 | ORIGIN = GUC_HXG_ORIGIN_HOST_                                |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   | 30:28 | TYPE = GUC_HXG_TYPE_REQUEST_                                 |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   | 27:16 | DATA0 = MBZ                                                  |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  15:0 | ACTION = _`VF2PF_UPDATE_GGTT_RANGES` = 0x0103                |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 1 | 31:12 | **OFFSET** - relative offset within VF's GGTT region         |
+ *  |   |       | 0x00000 = VF GGTT BEGIN                                      |
+ *  |   |       | 0x00001 = VF GGTT BEGIN + 4K                                 |
+ *  |   |       | 0x00002 = ...                                                |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  11:0 | MBZ                                                          |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 2 |  31:0 | **PTE_LO** - lower 32 bits of the first PTE of RANGE0        |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 3 |  31:0 | **PTE_HI** - upper 32 bits of the first PTE of RANGE0        |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 4 | 31:16 | **COUNT** - number of PTEs in RANGE0 (can't be 0)            |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  15:0 | **INCREMENT** - GPA increment between PTEs (in 4K pages)     |
+ *  +---+-------+--------------------------------------------------------------+
+ *  :   :       :                                                              :
+ *  +---+-------+--------------------------------------------------------------+
+ *  |n-2|  31:0 | **PTE_LO** - lower 32 bits of the first PTE of RANGEn        |
+ *  +---+-------+--------------------------------------------------------------+
+ *  |n-1|  31:0 | **PTE_HI** - upper 32 bits of the first PTE of RANGEn        |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | n | 31:16 | **COUNT** - number of PTEs in RANGEn (can't be 0)            |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  15:0 | **INCREMENT** - GPA increment between PTEs (in 4K pages)     |
+ *  +---+-------+--------------------------------------------------------------+
+ *
+ *  +---+-------+--------------------------------------------------------------+
+ *  |   | Bits  | Description                                                  |
+ *  +===+=======+==============================================================+
+ *  | 0 |    31 | ORIGIN = GUC_HXG_ORIGIN_HOST_                                |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   | 30:28 | TYPE = GUC_HXG_TYPE_RESPONSE_SUCCESS_                        |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  27:0 | **NUM_PTES** - number of PTEs entries updated                |
+ *  +---+-------+--------------------------------------------------------------+
+ */
+
+#define IOV_ACTION_VF2PF_UPDATE_GGTT_RANGES		0x103
+
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_MIN_LEN	5u
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_MAX_LEN	VF2GUC_RELAY_TO_PF_REQUEST_MSG_MAX_LEN
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_0_MBZ	GUC_HXG_REQUEST_MSG_0_DATA0
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_1_OFFSET	(0xfffff << 12)
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_1_MBZ	(0xfff << 0)
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN	3u
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_PTE_LO	GUC_HXG_REQUEST_MSG_n_DATAn
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_PTE_HI	GUC_HXG_REQUEST_MSG_n_DATAn
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_COUNT	(0xffff << 16)
+#define VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_INCREMENT	(0xffff << 0)
+#define   VF2PF_UPDATE_GGTT_MAX_RANGES \
+	  ((VF2PF_MSG_MAX_LEN - 2) / VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN)
+
+#define VF2PF_UPDATE_GGTT_RANGES_RESPONSE_MSG_LEN	1u
+#define VF2PF_UPDATE_GGTT_RANGES_RESPONSE_MSG_0_NUM_PTES	GUC_HXG_RESPONSE_MSG_0_DATA0
+
+/**
+ * DOC: VF2PF_QUERY_RUNTIME_SNAPSHOT
+ *
+ * This `IOV Message`_ is used by the VF to fetch the whole snapshot of the
+ * runtime registers published by the PF in a single transfer.
+ *
+ * Each snapshot is stamped with a non-zero @GENERATION that changes whenever
+ * any of the register values changes. VF provides @GENERATION of the snapshot
+ * it has already cached (or 0 if none) and if it matches the current one, PF
+ * replies with @COUNT = 0 and no register entries.
+ *
+ * This message is available since VFPF interface version 1.2.
+ *
+ *  +---+-------+--------------------------------------------------------------+
+ *  |   | Bits  | Description                                                  |
+ *  +===+=======+==============================================================+
+ *  | 0 |    31 | ORIGIN = GUC_HXG_ORIGIN_HOST_                                |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   | 30:28 | TYPE = GUC_HXG_TYPE_REQUEST_                                 |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   | 27:16 | DATA0 = MBZ                                                  |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  15:0 | ACTION = _`IOV_ACTION_VF2PF_QUERY_RUNTIME_SNAPSHOT` = 0x0104 |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 1 |  31:0 | **GENERATION** - generation of the snapshot cached by VF     |
+ *  +---+-------+--------------------------------------------------------------+
+ *
+ *  +---+-------+--------------------------------------------------------------+
+ *  |   | Bits  | Description                                                  |
+ *  +===+=======+==============================================================+
+ *  | 0 |    31 | ORIGIN = GUC_HXG_ORIGIN_HOST_                                |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   | 30:28 | TYPE = GUC_HXG_TYPE_RESPONSE_SUCCESS_                        |
+ *  |   +-------+--------------------------------------------------------------+
+ *  |   |  27:0 | DATA0 = **COUNT** - number of entries included in response   |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 1 |  31:0 | DATA1 = **GENERATION** - generation of the current snapshot  |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 2 |  31:0 | DATA2 = **REG_OFFSET** - offset of register[0]               |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | 3 |  31:0 | DATA3 = **REG_VALUE** - value of register[0]                 |
+ *  +---+-------+--------------------------------------------------------------+
+ *  |   |       |                                                              |
+ *  +---+-------+--------------------------------------------------------------+
+ *  |n-1|  31:0 | REG_OFFSET - offset of register[COUNT - 1]                   |
+ *  +---+-------+--------------------------------------------------------------+
+ *  | n |  31:0 | REG_VALUE - value of register[COUNT - 1]                     |
+ *  +---+-------+--------------------------------------------------------------+
+ */
+#define IOV_ACTION_VF2PF_QUERY_RUNTIME_SNAPSHOT			0x0104
+
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_LEN		2u
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_0_MBZ		GUC_HXG_REQUEST_MSG_0_DATA0
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_1_GENERATION	GUC_HXG_REQUEST_MSG_n_DATAn
+
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN	(GUC_HXG_MSG_MIN_LEN + 1u)
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MAX_LEN	VF2PF_MSG_MAX_LEN
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_0_COUNT	GUC_HXG_RESPONSE_MSG_0_DATA0
+#define VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_1_GENERATION	GUC_HXG_RESPONSE_MSG_n_DATAn
+#define   VF2PF_QUERY_RUNTIME_SNAPSHOT_MAX_REGS \
+	  ((VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MAX_LEN - \
+	    VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN) / 2)
+
 #endif /* _ABI_IOV_ACTIONS_ABI_H_ */
@@ -7,7 +7,7 @@
 #define _ABI_IOV_VERSION_ABI_H_
 
 #define IOV_VERSION_LATEST_MAJOR		1u
-#define IOV_VERSION_LATEST_MINOR		0u
+#define IOV_VERSION_LATEST_MINOR		2u
 /* XXX In future we need to have major.minor base versions per platform */
 #define IOV_VERSION_BASE_MAJOR			1u
 #define IOV_VERSION_BASE_MINOR			0u
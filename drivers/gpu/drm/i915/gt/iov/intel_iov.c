@@ -9,6 +9,7 @@
 #include "intel_iov_provisioning.h"
 #include "intel_iov_query.h"
 #include "intel_iov_relay.h"
+#include "intel_iov_sched.h"
 #include "intel_iov_service.h"
 #include "intel_iov_state.h"
 #include "intel_iov_utils.h"
@@ -27,6 +28,7 @@ void intel_iov_init_early(struct intel_iov *iov)
 		intel_iov_provisioning_init_early(iov);
 		intel_iov_service_init_early(iov);
 		intel_iov_state_init_early(iov);
+		intel_iov_sched_init_early(iov);
 	} else if (intel_iov_is_vf(iov)) {
 		intel_iov_ggtt_vf_init_early(iov);
 	}
@@ -43,12 +45,15 @@ void intel_iov_init_early(struct intel_iov *iov)
 void intel_iov_release(struct intel_iov *iov)
 {
 	if (intel_iov_is_pf(iov)) {
+		intel_iov_sched_release(iov);
 		intel_iov_state_release(iov);
 		intel_iov_service_release(iov);
 		intel_iov_provisioning_release(iov);
 	} else if (intel_iov_is_vf(iov)) {
 		intel_iov_ggtt_vf_release(iov);
 	}
+
+	intel_iov_relay_release(&iov->relay);
 }
 
 /**
@@ -135,8 +140,10 @@ int intel_iov_init(struct intel_iov *iov)
  */
 void intel_iov_fini(struct intel_iov *iov)
 {
-	if (intel_iov_is_pf(iov))
+	if (intel_iov_is_pf(iov)) {
+		intel_iov_sched_fini(iov);
 		intel_iov_provisioning_fini(iov);
+	}
 
 	if (intel_iov_is_vf(iov))
 		intel_iov_memirq_fini(iov);
@@ -174,14 +181,18 @@ static int vf_balloon_ggtt(struct intel_iov *iov)
 	start = iov->vf.config.ggtt_base + iov->vf.config.ggtt_size;
 	end = GUC_GGTT_TOP;
 	err = i915_ggtt_balloon(ggtt, start, end, &iov->vf.ggtt_balloon[1]);
+	if (unlikely(err))
+		return err;
 
-	return err;
+	intel_iov_ggtt_vf_alloc_init(iov, iov->vf.config.ggtt_base, iov->vf.config.ggtt_size);
+	return 0;
 }
 
 static void vf_deballoon_ggtt(struct intel_iov *iov)
 {
 	struct i915_ggtt *ggtt = iov_to_gt(iov)->ggtt;
 
+	intel_iov_ggtt_vf_alloc_fini(iov);
 	i915_ggtt_deballoon(ggtt, &iov->vf.ggtt_balloon[1]);
 	i915_ggtt_deballoon(ggtt, &iov->vf.ggtt_balloon[0]);
 }
@@ -14,6 +14,7 @@
 #include "intel_iov_event.h"
 #include "intel_iov_provisioning.h"
 #include "intel_iov_query.h"
+#include "intel_iov_state.h"
 
 static bool eval_is_pf(void *data)
 {
@@ -65,6 +66,32 @@ static int dbs_provisioning_show(struct seq_file *m, void *data)
 }
 DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE(dbs_provisioning);
 
+static size_t provisioning_snapshot_size(struct intel_gt *gt)
+{
+	/* seq_file needs one spare byte to accept the whole snapshot */
+	return intel_iov_provisioning_snapshot_size(&gt->iov) + 1;
+}
+
+static int provisioning_snapshot_show(struct seq_file *m, void *data)
+{
+	struct intel_iov *iov = &((struct intel_gt *)m->private)->iov;
+	size_t size = intel_iov_provisioning_snapshot_size(iov);
+	ssize_t ret;
+	void *buf;
+
+	buf = kvmalloc(size, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	ret = intel_iov_provisioning_snapshot(iov, buf, size);
+	if (ret > 0)
+		seq_write(m, buf, ret);
+
+	kvfree(buf);
+	return ret < 0 ? ret : 0;
+}
+DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE_WITH_SIZE(provisioning_snapshot, provisioning_snapshot_size);
+
 static int adverse_events_show(struct seq_file *m, void *data)
 {
 	struct intel_iov *iov = &((struct intel_gt *)m->private)->iov;
@@ -74,6 +101,23 @@ static int adverse_events_show(struct seq_file *m, void *data)
 }
 DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE(adverse_events);
 
+static int adverse_events_log_show(struct seq_file *m, void *data)
+{
+	struct intel_iov *iov = &((struct intel_gt *)m->private)->iov;
+
+	return intel_iov_event_dump_log(iov, m);
+}
+DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE(adverse_events_log);
+
+static int state_timings_show(struct seq_file *m, void *data)
+{
+	struct intel_iov *iov = &((struct intel_gt *)m->private)->iov;
+	struct drm_printer p = drm_seq_file_printer(m);
+
+	return intel_iov_state_print_timings(iov, &p);
+}
+DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE(state_timings);
+
 static int vf_self_config_show(struct seq_file *m, void *data)
 {
 	struct intel_iov *iov = &((struct intel_gt *)m->private)->iov;
@@ -98,7 +142,10 @@ void intel_iov_debugfs_register(struct intel_iov *iov, struct dentry *root)
 		{ "ggtt_available", &ggtt_available_fops, eval_is_pf },
 		{ "contexts_provisioning", &ctxs_provisioning_fops, eval_is_pf },
 		{ "doorbells_provisioning", &dbs_provisioning_fops, eval_is_pf },
+		{ "provisioning_snapshot", &provisioning_snapshot_fops, eval_is_pf },
 		{ "adverse_events", &adverse_events_fops, eval_is_pf },
+		{ "adverse_events_log", &adverse_events_log_fops, eval_is_pf },
+		{ "state_timings", &state_timings_fops, eval_is_pf },
 		{ "self_config", &vf_self_config_fops, eval_is_vf },
 	};
 	struct dentry *dir;
@@ -3,6 +3,8 @@
  * Copyright © 2022 Intel Corporation
  */
 
+#include <linux/seq_file.h>
+
 #include "intel_iov.h"
 #include "intel_iov_event.h"
 #include "intel_iov_utils.h"
@@ -45,24 +47,82 @@ static void pf_update_event_counter(struct intel_iov *iov, u32 vfid,
 	++iov->pf.state.data[vfid].adverse_events[e];
 }
 
+static unsigned int event_log_index(u64 seq)
+{
+	BUILD_BUG_ON(!is_power_of_2(IOV_EVENT_LOG_SIZE));
+
+	return seq & (IOV_EVENT_LOG_SIZE - 1);
+}
+
+static void pf_record_event(struct intel_iov *iov, u32 vfid, u32 threshold,
+			    enum intel_iov_threshold e)
+{
+	struct intel_iov_event_log *log = &iov->pf.state.data[vfid].events;
+	u64 seq = atomic64_read(&log->head) + 1;
+	struct intel_iov_event_record *rec = &log->records[event_log_index(seq)];
+
+	/* invalidate the oldest record before it is overwritten */
+	WRITE_ONCE(rec->seq, 0);
+	smp_wmb();
+
+	rec->timestamp = ktime_get_ns();
+	rec->vfid = vfid;
+	rec->threshold = threshold;
+	rec->engine = IOV_EVENT_ENGINE_UNKNOWN;
+	rec->value = READ_ONCE(iov->pf.provisioning.configs[vfid].thresholds[e]);
+
+	smp_wmb();
+	WRITE_ONCE(rec->seq, seq);
+	atomic64_set_release(&log->head, seq);
+}
+
+static bool event_log_read(const struct intel_iov_event_log *log, u64 seq,
+			   struct intel_iov_event_record *out)
+{
+	const struct intel_iov_event_record *rec = &log->records[event_log_index(seq)];
+
+	if (READ_ONCE(rec->seq) != seq)
+		return false;
+	smp_rmb();
+
+	memcpy(out, rec, sizeof(*out));
+
+	/* record might have been overwritten while we were copying it */
+	smp_rmb();
+	return READ_ONCE(rec->seq) == seq && out->seq == seq;
+}
+
 #define I915_UEVENT_THRESHOLD_EXCEEDED	"THRESHOLD_EXCEEDED"
 #define I915_UEVENT_THRESHOLD_ID	"THRESHOLD_ID"
 #define I915_UEVENT_VFID		"VF_ID"
 
+/* minimal interval between uevents of the same VF */
+#define I915_UEVENT_THRESHOLD_INTERVAL_MS	1000
+
 static void pf_emit_threshold_uevent(struct intel_iov *iov, u32 vfid, u32 threshold)
 {
+	struct intel_iov_event_log *log = &iov->pf.state.data[vfid].events;
 	struct kobject *kobj = &iov_to_i915(iov)->drm.primary->kdev->kobj;
+	char threshold_env[sizeof(I915_UEVENT_THRESHOLD_ID"=0x") + 8];
+	char vfid_env[sizeof(I915_UEVENT_VFID"=") + 10];
 	char *envp[] = {
 		I915_UEVENT_THRESHOLD_EXCEEDED"=1",
-		kasprintf(GFP_KERNEL, I915_UEVENT_THRESHOLD_ID"=%#x", threshold),
-		kasprintf(GFP_KERNEL, I915_UEVENT_VFID"=%u", vfid),
+		threshold_env,
+		vfid_env,
 		NULL,
 	};
 
-	kobject_uevent_env(kobj, KOBJ_CHANGE, envp);
+	/* events are still recorded in the log, only the notification is skipped */
+	if (log->last_uevent &&
+	    time_before(jiffies, log->last_uevent +
+			msecs_to_jiffies(I915_UEVENT_THRESHOLD_INTERVAL_MS)))
+		return;
+	log->last_uevent = jiffies ?: 1;
+
+	snprintf(threshold_env, sizeof(threshold_env), I915_UEVENT_THRESHOLD_ID"=%#x", threshold);
+	snprintf(vfid_env, sizeof(vfid_env), I915_UEVENT_VFID"=%u", vfid);
 
-	kfree(envp[1]);
-	kfree(envp[2]);
+	kobject_uevent_env(kobj, KOBJ_CHANGE, envp);
 }
 
 static void pf_emit_log_message(struct intel_iov *iov, u32 vfid, int e)
@@ -84,9 +144,8 @@ static int pf_handle_vf_threshold_event(struct intel_iov *iov, u32 vfid, u32 thr
 	IOV_DEBUG(iov, "VF%u threshold %04x\n", vfid, threshold);
 
 	pf_update_event_counter(iov, vfid, e);
-
-	if (IS_ENABLED(CONFIG_DRM_I915_SELFTEST))
-		pf_emit_threshold_uevent(iov, vfid, threshold);
+	pf_record_event(iov, vfid, threshold, e);
+	pf_emit_threshold_uevent(iov, vfid, threshold);
 
 	pf_emit_log_message(iov, vfid, e);
 
@@ -172,3 +231,38 @@ int intel_iov_event_print_events(struct intel_iov *iov, struct drm_printer *p)
 
 	return 0;
 }
+
+/**
+ * intel_iov_event_dump_log - Dump recent adverse events.
+ * @iov: the IOV struct
+ * @m: the seq_file
+ *
+ * Write recent adverse events of all VFs, oldest first for each VF, as
+ * binary &struct intel_iov_event_record records.
+ *
+ * This function can only be called on PF.
+ */
+int intel_iov_event_dump_log(struct intel_iov *iov, struct seq_file *m)
+{
+	unsigned int n, total_vfs = pf_get_totalvfs(iov);
+	struct intel_iov_event_record rec;
+	const struct intel_iov_event_log *log;
+	u64 seq, head;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (unlikely(!iov->pf.state.data))
+		return -ENODATA;
+
+	for (n = 1; n <= total_vfs; n++) {
+		log = &iov->pf.state.data[n].events;
+		head = atomic64_read_acquire(&log->head);
+		seq = head > IOV_EVENT_LOG_SIZE ? head - IOV_EVENT_LOG_SIZE + 1 : 1;
+
+		for (; seq <= head; seq++)
+			if (event_log_read(log, seq, &rec))
+				seq_write(m, &rec, sizeof(rec));
+	}
+
+	return 0;
+}
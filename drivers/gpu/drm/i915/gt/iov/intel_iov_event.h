@@ -10,9 +10,11 @@
 
 struct drm_printer;
 struct intel_iov;
+struct seq_file;
 
 void intel_iov_event_reset(struct intel_iov *iov, u32 vfid);
 int intel_iov_event_process_guc2pf(struct intel_iov *iov, const u32 *msg, u32 len);
 int intel_iov_event_print_events(struct intel_iov *iov, struct drm_printer *p);
+int intel_iov_event_dump_log(struct intel_iov *iov, struct seq_file *m);
 
 #endif /* __INTEL_IOV_EVENT_H__ */
@@ -48,45 +48,124 @@ sg_add_pte(struct sg_table *st, struct scatterlist *sg, gen8_pte_t source_pte)
 	return sg_add_ptes(st, sg, source_pte, 1, false);
 }
 
-int intel_iov_ggtt_pf_update_vf_ptes(struct intel_iov *iov, u32 vfid, u32 pte_offset, u8 mode,
-				     u16 num_copies, gen8_pte_t *ptes, u16 count)
+/*
+ * PTEs requested by the VF are encoded directly into the VF's preallocated
+ * staging buffer and written to the GGTT in batches, without any sg_table.
+ * The GGTT is invalidated only once, after the whole request is written.
+ */
+struct pf_ggtt_batch {
+	struct intel_iov *iov;
+	u32 vfid;
+	u64 ggtt_addr;
+	gen8_pte_t *ptes;
+	u32 count;
+	u32 written;
+};
+
+static int pf_ggtt_batch_init(struct pf_ggtt_batch *batch, struct intel_iov *iov, u32 vfid,
+			      u32 pte_offset, u32 num_ptes)
 {
 	struct drm_mm_node *node = &iov->pf.provisioning.configs[vfid].ggtt_region;
 	u64 ggtt_addr = node->start + pte_offset * I915_GTT_PAGE_SIZE_4K;
-	u64 ggtt_addr_end = ggtt_addr + count * I915_GTT_PAGE_SIZE_4K - 1;
+	u64 ggtt_addr_end = ggtt_addr + num_ptes * I915_GTT_PAGE_SIZE_4K - 1;
 	u64 vf_ggtt_end = node->start + node->size - 1;
-	gen8_pte_t pte_pattern = prepare_pattern_pte(*(ptes), vfid);
-	struct sg_table *st;
-	struct scatterlist *sg;
-	bool is_duplicated;
-	u16 n_ptes;
-	int err;
-	int i;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
-	/* XXX: All PTEs must have the same flags */
-	for (i = 0; i < count; i++)
-		GEM_BUG_ON(prepare_pattern_pte(ptes[i], vfid) != pte_pattern);
 
-	if (!count)
+	if (!num_ptes)
 		return -EINVAL;
 
-	if (ggtt_addr_end > vf_ggtt_end)
+	if (!drm_mm_node_allocated(node) || ggtt_addr_end > vf_ggtt_end)
 		return -ERANGE;
 
-	n_ptes = num_copies ? num_copies + count : count;
+	if (unlikely(!iov->pf.ggtt.shadows_ggtt || !iov->pf.ggtt.shadows_ggtt[vfid].staging))
+		return -ENODEV;
 
-	st = kmalloc(sizeof(*st), GFP_KERNEL);
-	if (!st)
-		return -ENOMEM;
+	batch->iov = iov;
+	batch->vfid = vfid;
+	batch->ggtt_addr = ggtt_addr;
+	batch->ptes = iov->pf.ggtt.shadows_ggtt[vfid].staging;
+	batch->count = 0;
+	batch->written = 0;
 
-	if (sg_alloc_table(st, n_ptes, GFP_KERNEL)) {
-		kfree(st);
-		return -ENOMEM;
+	return 0;
+}
+
+static int pf_ggtt_batch_write(struct pf_ggtt_batch *batch)
+{
+	struct i915_ggtt *ggtt = iov_to_gt(batch->iov)->ggtt;
+	int err;
+
+	if (!batch->count)
+		return 0;
+
+	err = i915_ggtt_write_vf_ptes(ggtt, batch->vfid, batch->ggtt_addr,
+				      batch->ptes, batch->count);
+	if (unlikely(err))
+		return err;
+
+	batch->ggtt_addr += batch->count * I915_GTT_PAGE_SIZE_4K;
+	batch->written += batch->count;
+	batch->count = 0;
+
+	return 0;
+}
+
+static int pf_ggtt_batch_add(struct pf_ggtt_batch *batch, gen8_pte_t pte, u32 count,
+			     u32 increment)
+{
+	gen8_pte_t pattern = prepare_pattern_pte(pte, batch->vfid);
+	u64 pfn = FIELD_GET(GEN12_GGTT_PTE_ADDR_MASK, pte);
+	int err;
+
+	while (count--) {
+		if (batch->count == IOV_GGTT_STAGING_PTES) {
+			err = pf_ggtt_batch_write(batch);
+			if (unlikely(err))
+				return err;
+		}
+
+		batch->ptes[batch->count++] = pattern |
+					      FIELD_PREP(GEN12_GGTT_PTE_ADDR_MASK, pfn);
+		pfn += increment;
 	}
 
-	sg = st->sgl;
-	st->nents = 0;
+	return 0;
+}
+
+static int pf_ggtt_batch_finish(struct pf_ggtt_batch *batch)
+{
+	struct i915_ggtt *ggtt = iov_to_gt(batch->iov)->ggtt;
+	int err;
+
+	err = pf_ggtt_batch_write(batch);
+	if (unlikely(err))
+		return err;
+
+	if (!I915_SELFTEST_ONLY(batch->iov->pf.ggtt.selftest.mock_write_ptes))
+		ggtt->invalidate(ggtt);
+
+	IOV_DEBUG(batch->iov, "PF updated GGTT for %u PTE(s) from VF%u\n",
+		  batch->written, batch->vfid);
+	return batch->written;
+}
+
+int intel_iov_ggtt_pf_update_vf_ptes(struct intel_iov *iov, u32 vfid, u32 pte_offset, u8 mode,
+				     u16 num_copies, gen8_pte_t *ptes, u16 count)
+{
+	struct pf_ggtt_batch batch;
+	bool is_duplicated;
+	int err;
+
+	if (!count)
+		return -EINVAL;
+
+	err = pf_ggtt_batch_init(&batch, iov, vfid, pte_offset, num_copies + count);
+	if (unlikely(err))
+		return err;
+
+	is_duplicated = mode == MMIO_UPDATE_GGTT_MODE_DUPLICATE ||
+			mode == MMIO_UPDATE_GGTT_MODE_DUPLICATE_LAST;
 
 	/*
 	 * To simplify the code, always let at least one PTE be updated by
@@ -95,39 +174,72 @@ int intel_iov_ggtt_pf_update_vf_ptes(struct intel_iov *iov, u32 vfid, u32 pte_of
 	num_copies++;
 	count--;
 
-	is_duplicated = mode == MMIO_UPDATE_GGTT_MODE_DUPLICATE ||
-			mode == MMIO_UPDATE_GGTT_MODE_DUPLICATE_LAST;
-
 	switch (mode) {
 	case MMIO_UPDATE_GGTT_MODE_DUPLICATE:
 	case MMIO_UPDATE_GGTT_MODE_REPLICATE:
-		sg = sg_add_ptes(st, sg, *(ptes++), num_copies, is_duplicated);
+		err = pf_ggtt_batch_add(&batch, *(ptes++), num_copies, !is_duplicated);
 
-		while (count--)
-			sg = sg_add_pte(st, sg, *(ptes++));
+		while (!err && count--)
+			err = pf_ggtt_batch_add(&batch, *(ptes++), 1, 0);
 		break;
 	case MMIO_UPDATE_GGTT_MODE_DUPLICATE_LAST:
 	case MMIO_UPDATE_GGTT_MODE_REPLICATE_LAST:
-		while (count--)
-			sg = sg_add_pte(st, sg, *(ptes++));
+		while (!err && count--)
+			err = pf_ggtt_batch_add(&batch, *(ptes++), 1, 0);
 
-		sg = sg_add_ptes(st, sg, *(ptes++), num_copies, is_duplicated);
+		if (!err)
+			err = pf_ggtt_batch_add(&batch, *(ptes++), num_copies, !is_duplicated);
 		break;
 	default:
 		err = -EINVAL;
-		goto cleanup;
+		break;
 	}
 
-	err = i915_ggtt_sgtable_update_ptes(iov_to_gt(iov)->ggtt, vfid, ggtt_addr, st, n_ptes,
-					    pte_pattern);
-cleanup:
-	sg_free_table(st);
-	kfree(st);
-	if (err < 0)
+	if (unlikely(err))
 		return err;
 
-	IOV_DEBUG(iov, "PF updated GGTT for %d PTE(s) from VF%u\n", n_ptes, vfid);
-	return n_ptes;
+	return pf_ggtt_batch_finish(&batch);
+}
+
+/**
+ * intel_iov_ggtt_pf_update_vf_ranges - Update runs of VF PTEs
+ * @iov: the &struct intel_iov
+ * @vfid: VF identifier
+ * @pte_offset: offset of the first PTE within VF's GGTT region
+ * @ranges: array of runs, applied back to back starting from @pte_offset
+ * @num_ranges: number of runs in the @ranges array
+ *
+ * This function is for PF use only.
+ *
+ * Return: number of updated PTEs on success or a negative error code on failure.
+ */
+int intel_iov_ggtt_pf_update_vf_ranges(struct intel_iov *iov, u32 vfid, u32 pte_offset,
+				       const struct intel_iov_ggtt_range *ranges,
+				       u16 num_ranges)
+{
+	struct pf_ggtt_batch batch;
+	u32 num_ptes = 0;
+	int err;
+	u16 i;
+
+	for (i = 0; i < num_ranges; i++) {
+		if (!ranges[i].count)
+			return -EINVAL;
+		num_ptes += ranges[i].count;
+	}
+
+	err = pf_ggtt_batch_init(&batch, iov, vfid, pte_offset, num_ptes);
+	if (unlikely(err))
+		return err;
+
+	for (i = 0; i < num_ranges; i++) {
+		err = pf_ggtt_batch_add(&batch, ranges[i].pte, ranges[i].count,
+					ranges[i].increment);
+		if (unlikely(err))
+			return err;
+	}
+
+	return pf_ggtt_batch_finish(&batch);
 }
 
 void intel_iov_ggtt_vf_init_early(struct intel_iov *iov)
@@ -140,10 +252,140 @@ void intel_iov_ggtt_vf_init_early(struct intel_iov *iov)
 void intel_iov_ggtt_vf_release(struct intel_iov *iov)
 {
 	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	GEM_BUG_ON(iov->vf.ptes_buffer.num_inflight);
 
 	mutex_destroy(&iov->vf.ptes_buffer.lock);
 }
 
+static void vf_complete_oldest_ptes(struct intel_iov *iov)
+{
+	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
+	struct intel_iov_vf_ggtt_inflight *inflight;
+
+	GEM_BUG_ON(!buffer->num_inflight);
+
+	inflight = &buffer->inflight[buffer->inflight_head];
+	intel_iov_query_update_ggtt_ptes_wait(iov, inflight);
+
+	buffer->inflight_head = (buffer->inflight_head + 1) % ARRAY_SIZE(buffer->inflight);
+	buffer->num_inflight--;
+}
+
+/*
+ * When CTB is available, buffered PTEs are sent to the PF without waiting for
+ * the response, so the PF can already process one request while we are still
+ * collecting PTEs for the next one. Up to ARRAY_SIZE(buffer->inflight) requests
+ * can stay in flight, then we wait for the oldest one to free its slot.
+ */
+static void vf_queue_ptes(struct intel_iov *iov)
+{
+	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
+	struct intel_iov_vf_ggtt_inflight *inflight;
+	unsigned int slot;
+
+	if (!buffer->count && !buffer->num_ranges)
+		return;
+
+	if (!intel_guc_ct_enabled(&iov_to_guc(iov)->ct)) {
+		GEM_BUG_ON(buffer->num_ranges);
+		intel_iov_query_update_ggtt_ptes(iov);
+		buffer->count = 0;
+		return;
+	}
+
+	if (buffer->num_inflight == ARRAY_SIZE(buffer->inflight))
+		vf_complete_oldest_ptes(iov);
+
+	slot = (buffer->inflight_head + buffer->num_inflight) % ARRAY_SIZE(buffer->inflight);
+	inflight = &buffer->inflight[slot];
+
+	if (!intel_iov_query_update_ggtt_ptes_submit(iov, inflight))
+		buffer->num_inflight++;
+
+	buffer->count = 0;
+	buffer->num_ranges = 0;
+	buffer->num_range_ptes = 0;
+}
+
+static bool vf_use_ggtt_ranges(struct intel_iov *iov)
+{
+	struct intel_iov_vf_config *config = &iov->vf.config;
+
+	if (!intel_guc_ct_enabled(&iov_to_guc(iov)->ct))
+		return false;
+
+	return config->iov_abi.major > 1 ||
+	       (config->iov_abi.major == 1 && config->iov_abi.minor >= 1);
+}
+
+static bool vf_try_extend_range(struct intel_iov_ggtt_range *range, gen8_pte_t pte)
+{
+	u64 new_gfn = FIELD_GET(GEN12_GGTT_PTE_ADDR_MASK, pte);
+	u64 range_gfn = FIELD_GET(GEN12_GGTT_PTE_ADDR_MASK, range->pte);
+	u64 new_flags = FIELD_GET(MTL_GGTT_PTE_PAT_MASK, pte);
+	u64 range_flags = FIELD_GET(MTL_GGTT_PTE_PAT_MASK, range->pte);
+	u64 delta;
+
+	if (new_flags != range_flags || new_gfn < range_gfn)
+		return false;
+
+	if (range->count == FIELD_MAX(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_COUNT))
+		return false;
+
+	delta = new_gfn - range_gfn;
+
+	/* second PTE of the run defines its increment */
+	if (range->count == 1) {
+		if (delta > FIELD_MAX(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_INCREMENT))
+			return false;
+		range->increment = delta;
+	} else if (delta != (u64)range->count * range->increment) {
+		return false;
+	}
+
+	range->count++;
+	return true;
+}
+
+/*
+ * Since ABI 1.1 the PTEs are sent to the PF as a list of (PTE, COUNT, INCREMENT)
+ * runs, so a physically contiguous (or duplicated) mapping of any size is sent
+ * as a single run and a typical object bind needs just one message.
+ */
+static void vf_update_pte_range(struct intel_iov *iov, u32 pte_offset, gen8_pte_t pte)
+{
+	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
+	struct intel_iov_ggtt_range *range;
+
+	GEM_BUG_ON(buffer->count);
+
+	if (buffer->num_ranges) {
+		if (pte_offset != buffer->offset + buffer->num_range_ptes)
+			goto flush;
+
+		range = &buffer->ranges[buffer->num_ranges - 1];
+		if (vf_try_extend_range(range, pte))
+			goto done;
+
+		if (buffer->num_ranges == ARRAY_SIZE(buffer->ranges))
+			goto flush;
+	} else {
+		buffer->offset = pte_offset;
+	}
+
+	range = &buffer->ranges[buffer->num_ranges++];
+	range->pte = pte;
+	range->count = 1;
+	range->increment = 0;
+done:
+	buffer->num_range_ptes++;
+	return;
+
+flush:
+	vf_queue_ptes(iov);
+	vf_update_pte_range(iov, pte_offset, pte);
+}
+
 static bool is_next_ggtt_offset(struct intel_iov *iov, u32 offset)
 {
 	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
@@ -186,6 +428,11 @@ void intel_iov_ggtt_vf_update_pte(struct intel_iov *iov, u32 offset, gen8_pte_t
 
 	GEM_BUG_ON(!intel_iov_is_vf(iov));
 
+	if (vf_use_ggtt_ranges(iov)) {
+		vf_update_pte_range(iov, pte_offset, pte);
+		return;
+	}
+
 	if (intel_guc_ct_enabled(&iov_to_guc(iov)->ct))
 		max_ptes = VF2PF_UPDATE_GGTT_MAX_PTES;
 
@@ -246,21 +493,193 @@ void intel_iov_ggtt_vf_update_pte(struct intel_iov *iov, u32 offset, gen8_pte_t
 
 	return;
 flush:
-	intel_iov_ggtt_vf_flush_ptes(iov);
+	vf_queue_ptes(iov);
 	intel_iov_ggtt_vf_update_pte(iov, offset, pte);
 }
 
+/**
+ * intel_iov_ggtt_vf_flush_ptes - Send all buffered PTEs and wait for PF acks
+ * @iov: the &struct intel_iov
+ *
+ * Must be called with ptes_buffer.lock held. Once this function returns, all
+ * PTEs passed to intel_iov_ggtt_vf_update_pte() were written by the PF and
+ * the caller can invalidate the GGTT.
+ */
 void intel_iov_ggtt_vf_flush_ptes(struct intel_iov *iov)
 {
 	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
 
 	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	lockdep_assert_held(&buffer->lock);
+
+	vf_queue_ptes(iov);
+
+	while (buffer->num_inflight)
+		vf_complete_oldest_ptes(iov);
+}
+
+/* common sizes of the scanout, context and GuC objects */
+static const u64 vf_ggtt_classes[IOV_VF_GGTT_NUM_CLASSES] = { SZ_4K, SZ_64K, SZ_2M };
+
+static int vf_ggtt_size_class(u64 size)
+{
+	unsigned int n;
+
+	for (n = 0; n < ARRAY_SIZE(vf_ggtt_classes); n++)
+		if (size == vf_ggtt_classes[n])
+			return n;
+
+	return -1;
+}
 
-	if (!buffer->count)
+static void vf_ggtt_class_drop(struct intel_iov_vf_ggtt_alloc *alloc, unsigned int class,
+			       unsigned int n)
+{
+	u64 *offsets = alloc->offsets[class];
+
+	GEM_BUG_ON(n >= alloc->count[class]);
+
+	alloc->count[class]--;
+	memmove(&offsets[n], &offsets[n + 1], (alloc->count[class] - n) * sizeof(*offsets));
+}
+
+static void vf_ggtt_class_put(struct intel_iov_vf_ggtt_alloc *alloc, u64 offset, u64 size)
+{
+	int class = vf_ggtt_size_class(size);
+
+	if (class < 0)
 		return;
 
-	intel_iov_query_update_ggtt_ptes(iov);
-	buffer->count = 0;
+	/* forget the oldest hint */
+	if (alloc->count[class] == IOV_VF_GGTT_CLASS_CACHE_SIZE)
+		vf_ggtt_class_drop(alloc, class, 0);
+
+	alloc->offsets[class][alloc->count[class]++] = offset;
+}
+
+static int vf_ggtt_class_get(struct intel_iov_vf_ggtt_alloc *alloc, struct drm_mm *mm,
+			     struct drm_mm_node *node, u64 size, u64 alignment,
+			     unsigned long color, u64 start, u64 end)
+{
+	int class = vf_ggtt_size_class(size);
+	unsigned int n;
+	u64 offset;
+	int err;
+
+	if (class < 0)
+		return -ENOSPC;
+
+	/* most recently freed first, it is the most likely to still be free */
+	for (n = alloc->count[class]; n--; ) {
+		offset = alloc->offsets[class][n];
+		if (offset < start || offset + size > end)
+			continue;
+		if (alignment && !IS_ALIGNED(offset, alignment))
+			continue;
+
+		node->start = offset;
+		node->size = size;
+		node->color = color;
+		err = drm_mm_reserve_node(mm, node);
+
+		/* either reused now or already taken by someone else */
+		vf_ggtt_class_drop(alloc, class, n);
+		if (!err)
+			return 0;
+	}
+
+	return -ENOSPC;
+}
+
+/**
+ * intel_iov_ggtt_vf_alloc_init - Set the VF GGTT window used by the allocator.
+ * @iov: the &struct intel_iov
+ * @start: start of the VF GGTT window
+ * @size: size of the VF GGTT window
+ */
+void intel_iov_ggtt_vf_alloc_init(struct intel_iov *iov, u64 start, u64 size)
+{
+	struct intel_iov_vf_ggtt_alloc *alloc = &iov->vf.ggtt_alloc;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+
+	memset(alloc, 0, sizeof(*alloc));
+	alloc->start = start;
+	alloc->end = start + size;
+}
+
+/**
+ * intel_iov_ggtt_vf_alloc_fini - Forget the VF GGTT window and cached offsets.
+ * @iov: the &struct intel_iov
+ */
+void intel_iov_ggtt_vf_alloc_fini(struct intel_iov *iov)
+{
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+
+	memset(&iov->vf.ggtt_alloc, 0, sizeof(iov->vf.ggtt_alloc));
+}
+
+/**
+ * intel_iov_ggtt_vf_insert - Allocate GGTT space within the VF window.
+ * @iov: the &struct intel_iov
+ * @mm: the GGTT &struct drm_mm
+ * @node: the &struct drm_mm_node to insert
+ * @size: size of the allocation
+ * @alignment: required alignment of the allocation, may be 0
+ * @color: color of the node
+ * @start: start of the range restriction, clamped to the VF window
+ * @end: end of the range restriction, clamped to the VF window
+ *
+ * The rest of the GGTT is ballooned, so any search or eviction outside
+ * of the VF window is wasted. Restrict the range to the window and try
+ * to reuse a recently freed offset of the same size class.
+ *
+ * Must be called with the GGTT vm->mutex held.
+ *
+ * Return: 0 if @node was inserted, -ENOSPC if caller shall search the
+ * (clamped) range on its own.
+ */
+int intel_iov_ggtt_vf_insert(struct intel_iov *iov, struct drm_mm *mm,
+			     struct drm_mm_node *node, u64 size, u64 alignment,
+			     unsigned long color, u64 *start, u64 *end)
+{
+	struct intel_iov_vf_ggtt_alloc *alloc = &iov->vf.ggtt_alloc;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+
+	if (!alloc->end)
+		return -ENOSPC;
+
+	*start = max(*start, alloc->start);
+	*end = min(*end, alloc->end);
+	if (*start >= *end)
+		return -ENOSPC;
+
+	return vf_ggtt_class_get(alloc, mm, node, size, alignment, color, *start, *end);
+}
+
+/**
+ * intel_iov_ggtt_vf_remove - Release GGTT space within the VF window.
+ * @iov: the &struct intel_iov
+ * @node: the &struct drm_mm_node that is about to be removed
+ *
+ * Remember the offset of the @node if it matches one of the size classes,
+ * so that next allocation of the same size can reuse it.
+ *
+ * Must be called with the GGTT vm->mutex held.
+ */
+void intel_iov_ggtt_vf_remove(struct intel_iov *iov, const struct drm_mm_node *node)
+{
+	struct intel_iov_vf_ggtt_alloc *alloc = &iov->vf.ggtt_alloc;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	GEM_BUG_ON(!drm_mm_node_allocated(node));
+
+	if (!alloc->end || node->start < alloc->start ||
+	    node->start + node->size > alloc->end)
+		return;
+
+	vf_ggtt_class_put(alloc, node->start, node->size);
 }
 
 /**
@@ -306,7 +725,9 @@ void intel_iov_ggtt_shadow_fini(struct intel_iov *iov)
 int intel_iov_ggtt_shadow_vf_alloc(struct intel_iov *iov, unsigned int vfid,
 				   struct drm_mm_node *ggtt_region)
 {
-	gen8_pte_t *ptes;
+	gen8_pte_t *ptes, *staging;
+	unsigned long *dirty;
+	u32 num_ptes;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 
@@ -320,7 +741,25 @@ int intel_iov_ggtt_shadow_vf_alloc(struct intel_iov *iov, unsigned int vfid,
 	if (unlikely(!ptes))
 		return -ENOMEM;
 
+	staging = kvmalloc_array(IOV_GGTT_STAGING_PTES, sizeof(gen8_pte_t), GFP_KERNEL);
+	if (unlikely(!staging)) {
+		kvfree(ptes);
+		return -ENOMEM;
+	}
+
+	/* all PTEs start dirty, until first save or clear */
+	num_ptes = ggtt_size_to_ptes_size(ggtt_region->size) / sizeof(gen8_pte_t);
+	dirty = kvmalloc_array(BITS_TO_LONGS(num_ptes), sizeof(unsigned long), GFP_KERNEL);
+	if (unlikely(!dirty)) {
+		kvfree(staging);
+		kvfree(ptes);
+		return -ENOMEM;
+	}
+	bitmap_fill(dirty, num_ptes);
+
 	iov->pf.ggtt.shadows_ggtt[vfid].ptes = ptes;
+	iov->pf.ggtt.shadows_ggtt[vfid].staging = staging;
+	iov->pf.ggtt.shadows_ggtt[vfid].dirty = dirty;
 	iov->pf.ggtt.shadows_ggtt[vfid].ggtt_region = ggtt_region;
 	iov->pf.ggtt.shadows_ggtt[vfid].vfid = vfid;
 
@@ -341,6 +780,10 @@ void intel_iov_ggtt_shadow_vf_free(struct intel_iov *iov, unsigned int vfid)
 	if (!iov->pf.ggtt.shadows_ggtt)
 		return;
 
+	kvfree(iov->pf.ggtt.shadows_ggtt[vfid].dirty);
+	iov->pf.ggtt.shadows_ggtt[vfid].dirty = NULL;
+	kvfree(iov->pf.ggtt.shadows_ggtt[vfid].staging);
+	iov->pf.ggtt.shadows_ggtt[vfid].staging = NULL;
 	kvfree(iov->pf.ggtt.shadows_ggtt[vfid].ptes);
 	iov->pf.ggtt.shadows_ggtt[vfid].ptes = NULL;
 }
@@ -377,6 +820,22 @@ static gen8_pte_t *ggtt_shadow_get_pte_ptr(struct intel_iov *iov, unsigned int v
 	return &iov->pf.ggtt.shadows_ggtt[vfid].ptes[pte_idx];
 }
 
+/*
+ * Dirty bits are set after the PTE is written and cleared before the PTE
+ * is read by intel_iov_ggtt_shadow_save_dirty(), so a concurrent update
+ * is either captured by the current save or left dirty for the next one.
+ */
+static void ggtt_shadow_mark_dirty(struct intel_iov *iov, unsigned int vfid, u64 ggtt_addr,
+				   u32 count)
+{
+	unsigned long *dirty = iov->pf.ggtt.shadows_ggtt[vfid].dirty;
+	u32 idx = pf_ggtt_addr_to_vf_pte_offset(iov, vfid, ggtt_addr) / sizeof(gen8_pte_t);
+
+	smp_mb__before_atomic();
+	while (count--)
+		set_bit(idx++, dirty);
+}
+
 /**
  * intel_iov_ggtt_shadow_set_pte - set VF GGTT PTE in shadow GGTT
  * @iov: the &struct intel_iov
@@ -394,6 +853,32 @@ void intel_iov_ggtt_shadow_set_pte(struct intel_iov *iov, unsigned int vfid, u64
 		return;
 
 	memset64(ggtt_shadow_get_pte_ptr(iov, vfid, ggtt_addr), pte, 1);
+	ggtt_shadow_mark_dirty(iov, vfid, ggtt_addr, 1);
+}
+
+/**
+ * intel_iov_ggtt_shadow_set_ptes - set consecutive VF GGTT PTEs in shadow GGTT
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ * @ggtt_addr: GGTT address of the first PTE
+ * @ptes: PTE values to save
+ * @count: number of PTEs
+ */
+void intel_iov_ggtt_shadow_set_ptes(struct intel_iov *iov, unsigned int vfid, u64 ggtt_addr,
+				    const gen8_pte_t *ptes, u32 count)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!iov->pf.ggtt.shadows_ggtt || !count)
+		return;
+
+	GEM_BUG_ON(!IS_ALIGNED(ggtt_addr, I915_GTT_PAGE_SIZE_4K));
+	GEM_BUG_ON(ggtt_addr + count * I915_GTT_PAGE_SIZE_4K >
+		   iov->pf.ggtt.shadows_ggtt[vfid].ggtt_region->start +
+		   iov->pf.ggtt.shadows_ggtt[vfid].ggtt_region->size);
+
+	memcpy(ggtt_shadow_get_pte_ptr(iov, vfid, ggtt_addr), ptes, count * sizeof(*ptes));
+	ggtt_shadow_mark_dirty(iov, vfid, ggtt_addr, count);
 }
 
 /**
@@ -415,42 +900,42 @@ gen8_pte_t intel_iov_ggtt_shadow_get_pte(struct intel_iov *iov, unsigned int vfi
 }
 
 /**
- * intel_iov_ggtt_shadow_save - copy VF GGTT PTEs to preallocated buffer
+ * intel_iov_ggtt_shadow_save_chunk - copy part of VF GGTT PTEs to preallocated buffer
  * @iov: the &struct intel_iov
  * @vfid: VF id
+ * @offset: offset (in bytes) within the VF PTEs from which to start
+ *          - must be sizeof(gen8_pte_t) aligned
  * @buf: preallocated buffer in which PTEs will be saved
  * @size: size of preallocated buffer (in bytes)
  *        - must be sizeof(gen8_pte_t) aligned
  * @flags: function flags:
  *         - #I915_GGTT_SAVE_PTES_NO_VFID BIT - save PTEs without VFID
  *
- * Returns: size of the buffer used (or needed if both @buf and @size are (0)) to store all PTEs
- *          for a given vfid, -EINVAL if one of @buf or @size is 0.
+ * Returns: size of the buffer used on success, -EINVAL if one of @buf or @size is 0,
+ *          -ENOSPC if requested chunk exceeds VF PTEs.
  */
-int intel_iov_ggtt_shadow_save(struct intel_iov *iov, unsigned int vfid, void *buf, size_t size,
-			       unsigned int flags)
+int intel_iov_ggtt_shadow_save_chunk(struct intel_iov *iov, unsigned int vfid, u64 offset,
+				     void *buf, size_t size, unsigned int flags)
 {
 	struct drm_mm_node *ggtt_region;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(!IS_ALIGNED(offset, sizeof(gen8_pte_t)));
 
 	if (!iov->pf.ggtt.shadows_ggtt)
 		return 0;
 
 	ggtt_region = iov->pf.ggtt.shadows_ggtt[vfid].ggtt_region;
 
-	if (!buf && !size)
-		return ggtt_size_to_ptes_size(ggtt_region->size);
-
 	if (!buf || !size)
 		return -EINVAL;
 
-	if (size > ggtt_size_to_ptes_size(ggtt_region->size))
+	if (offset + size > ggtt_size_to_ptes_size(ggtt_region->size))
 		return -ENOSPC;
 
 	GEM_BUG_ON(!IS_ALIGNED(size, sizeof(gen8_pte_t)));
 
-	memcpy(buf, iov->pf.ggtt.shadows_ggtt[vfid].ptes, size);
+	memcpy(buf, (void *)iov->pf.ggtt.shadows_ggtt[vfid].ptes + offset, size);
 
 	if (flags & I915_GGTT_SAVE_PTES_NO_VFID)
 		ggtt_pte_clear_vfid(buf, size);
@@ -458,6 +943,33 @@ int intel_iov_ggtt_shadow_save(struct intel_iov *iov, unsigned int vfid, void *b
 	return size;
 }
 
+/**
+ * intel_iov_ggtt_shadow_save - copy VF GGTT PTEs to preallocated buffer
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ * @buf: preallocated buffer in which PTEs will be saved
+ * @size: size of preallocated buffer (in bytes)
+ *        - must be sizeof(gen8_pte_t) aligned
+ * @flags: function flags:
+ *         - #I915_GGTT_SAVE_PTES_NO_VFID BIT - save PTEs without VFID
+ *
+ * Returns: size of the buffer used (or needed if both @buf and @size are (0)) to store all PTEs
+ *          for a given vfid, -EINVAL if one of @buf or @size is 0.
+ */
+int intel_iov_ggtt_shadow_save(struct intel_iov *iov, unsigned int vfid, void *buf, size_t size,
+			       unsigned int flags)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!iov->pf.ggtt.shadows_ggtt)
+		return 0;
+
+	if (!buf && !size)
+		return ggtt_size_to_ptes_size(iov->pf.ggtt.shadows_ggtt[vfid].ggtt_region->size);
+
+	return intel_iov_ggtt_shadow_save_chunk(iov, vfid, 0, buf, size, flags);
+}
+
 static int pf_ggtt_shadow_restore_ggtt(struct intel_iov *iov, unsigned int vfid)
 {
 	struct i915_ggtt *ggtt = iov_to_gt(iov)->ggtt;
@@ -527,30 +1039,35 @@ out_free_st:
 }
 
 /**
- * intel_iov_ggtt_shadow_restore() - restore GGTT PTEs from buffer
+ * intel_iov_ggtt_shadow_load_chunk() - load part of VF GGTT PTEs into shadow
  * @iov: the &struct intel_iov
  * @vfid: VF id
- * @buf: buffer from which PTEs will be restored
- * @size: size of preallocated buffer (in bytes)
+ * @offset: offset (in bytes) within the VF PTEs at which to start
+ *          - must be sizeof(gen8_pte_t) aligned
+ * @buf: buffer from which PTEs will be loaded
+ * @size: size of the buffer (in bytes)
  *        - must be sizeof(gen8_pte_t) aligned
  * @flags: function flags:
  *         - #I915_GGTT_RESTORE_PTES_VFID_MASK - VFID for restored PTEs
  *         - #I915_GGTT_RESTORE_PTES_NEW_VFID - restore PTEs with new VFID
  *           (from #I915_GGTT_RESTORE_PTES_VFID_MASK)
  *
- * Returns: size of restored PTES on success, or negative error code.
+ * Only the shadow is updated, use intel_iov_ggtt_shadow_sync() to write it
+ * back to the GGTT once all chunks were loaded.
+ *
+ * Returns: size of loaded PTEs on success, or negative error code.
  */
-int intel_iov_ggtt_shadow_restore(struct intel_iov *iov, unsigned int vfid, const void *buf,
-				       size_t size, unsigned int flags)
+int intel_iov_ggtt_shadow_load_chunk(struct intel_iov *iov, unsigned int vfid, u64 offset,
+				     const void *buf, size_t size, unsigned int flags)
 {
 	struct drm_mm_node *ggtt_region;
 	u64 ggtt_addr;
 	size_t remain_size;
-	int err;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 	GEM_BUG_ON(flags & I915_GGTT_RESTORE_PTES_NEW_VFID &&
 		   vfid != FIELD_GET(I915_GGTT_RESTORE_PTES_VFID_MASK, flags));
+	GEM_BUG_ON(!IS_ALIGNED(offset, sizeof(gen8_pte_t)));
 	GEM_BUG_ON(!IS_ALIGNED(size, sizeof(gen8_pte_t)));
 
 	if (!iov->pf.ggtt.shadows_ggtt)
@@ -558,13 +1075,13 @@ int intel_iov_ggtt_shadow_restore(struct intel_iov *iov, unsigned int vfid, cons
 
 	ggtt_region = iov->pf.ggtt.shadows_ggtt[vfid].ggtt_region;
 
-	if (size > ggtt_size_to_ptes_size(ggtt_region->size))
+	if (offset + size > ggtt_size_to_ptes_size(ggtt_region->size))
 		return -ENOSPC;
 
 	if (!buf || !size)
 		return -EINVAL;
 
-	ggtt_addr = ggtt_region->start;
+	ggtt_addr = ggtt_region->start + offset / sizeof(gen8_pte_t) * I915_GTT_PAGE_SIZE_4K;
 	remain_size = size;
 
 	while (remain_size) {
@@ -580,11 +1097,243 @@ int intel_iov_ggtt_shadow_restore(struct intel_iov *iov, unsigned int vfid, cons
 		remain_size -= sizeof(gen8_pte_t);
 	}
 
+	return size;
+}
+
+/**
+ * intel_iov_ggtt_shadow_sync() - write VF shadow PTEs to the GGTT
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ *
+ * Returns: 0 on success, or negative error code.
+ */
+int intel_iov_ggtt_shadow_sync(struct intel_iov *iov, unsigned int vfid)
+{
+	return pf_ggtt_shadow_restore_ggtt(iov, vfid);
+}
+
+/**
+ * intel_iov_ggtt_shadow_restore() - restore GGTT PTEs from buffer
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ * @buf: buffer from which PTEs will be restored
+ * @size: size of preallocated buffer (in bytes)
+ *        - must be sizeof(gen8_pte_t) aligned
+ * @flags: function flags:
+ *         - #I915_GGTT_RESTORE_PTES_VFID_MASK - VFID for restored PTEs
+ *         - #I915_GGTT_RESTORE_PTES_NEW_VFID - restore PTEs with new VFID
+ *           (from #I915_GGTT_RESTORE_PTES_VFID_MASK)
+ *
+ * Returns: size of restored PTES on success, or negative error code.
+ */
+int intel_iov_ggtt_shadow_restore(struct intel_iov *iov, unsigned int vfid, const void *buf,
+				       size_t size, unsigned int flags)
+{
+	int err;
+
+	err = intel_iov_ggtt_shadow_load_chunk(iov, vfid, 0, buf, size, flags);
+	if (err <= 0)
+		return err;
+
 	err = pf_ggtt_shadow_restore_ggtt(iov, vfid);
 
 	return err ?: size;
 }
 
+/* header of each run of PTEs in the buffer filled by intel_iov_ggtt_shadow_save_dirty() */
+struct iov_ggtt_dirty_run {
+	u32 offset;
+	u32 count;
+} __packed;
+
+/**
+ * intel_iov_ggtt_shadow_save_dirty - copy dirty VF GGTT PTEs to preallocated buffer
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ * @buf: preallocated buffer in which runs of dirty PTEs will be saved
+ * @size: size of preallocated buffer (in bytes)
+ * @flags: function flags:
+ *         - #I915_GGTT_SAVE_PTES_NO_VFID BIT - save PTEs without VFID
+ *
+ * Each run of dirty PTEs is saved as its offset and count followed by the PTEs.
+ * Dirty bits of saved PTEs are cleared, so the function can be called until
+ * it returns 0 to drain all PTEs modified since the last save or clear.
+ *
+ * Returns: size of the buffer used, -EOPNOTSUPP if the shadow GGTT is not used,
+ *          -EINVAL if @buf is too small.
+ */
+int intel_iov_ggtt_shadow_save_dirty(struct intel_iov *iov, unsigned int vfid, void *buf,
+				     size_t size, unsigned int flags)
+{
+	const size_t min_size = sizeof(struct iov_ggtt_dirty_run) + sizeof(gen8_pte_t);
+	struct intel_iov_ggtt_shadow *shadow;
+	struct iov_ggtt_dirty_run run;
+	u32 num_ptes, idx, end, i;
+	size_t used = 0;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!iov->pf.ggtt.shadows_ggtt)
+		return -EOPNOTSUPP;
+
+	shadow = &iov->pf.ggtt.shadows_ggtt[vfid];
+	if (!shadow->ptes)
+		return 0;
+
+	if (!buf || size < min_size)
+		return -EINVAL;
+
+	num_ptes = ggtt_size_to_ptes_size(shadow->ggtt_region->size) / sizeof(gen8_pte_t);
+
+	for (idx = 0; size - used >= min_size; idx = end) {
+		idx = find_next_bit(shadow->dirty, num_ptes, idx);
+		if (idx >= num_ptes)
+			break;
+
+		end = find_next_zero_bit(shadow->dirty, num_ptes, idx);
+		end = min_t(u32, end, idx + (size - used - sizeof(run)) / sizeof(gen8_pte_t));
+
+		for (i = idx; i < end; i++)
+			clear_bit(i, shadow->dirty);
+		smp_mb__after_atomic();
+
+		run.offset = idx;
+		run.count = end - idx;
+		memcpy(buf + used, &run, sizeof(run));
+		used += sizeof(run);
+
+		memcpy(buf + used, &shadow->ptes[idx], run.count * sizeof(gen8_pte_t));
+		if (flags & I915_GGTT_SAVE_PTES_NO_VFID)
+			ggtt_pte_clear_vfid(buf + used, run.count * sizeof(gen8_pte_t));
+		used += run.count * sizeof(gen8_pte_t);
+	}
+
+	return used;
+}
+
+/**
+ * intel_iov_ggtt_shadow_clear_dirty - mark all VF GGTT PTEs as clean
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ *
+ * Shall be called before the full save of VF GGTT PTEs that starts
+ * the dirty tracking.
+ *
+ * Returns: 0 on success, -EOPNOTSUPP if the shadow GGTT is not used.
+ */
+int intel_iov_ggtt_shadow_clear_dirty(struct intel_iov *iov, unsigned int vfid)
+{
+	struct intel_iov_ggtt_shadow *shadow;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!iov->pf.ggtt.shadows_ggtt)
+		return -EOPNOTSUPP;
+
+	shadow = &iov->pf.ggtt.shadows_ggtt[vfid];
+	if (!shadow->ptes)
+		return 0;
+
+	bitmap_zero(shadow->dirty,
+		    ggtt_size_to_ptes_size(shadow->ggtt_region->size) / sizeof(gen8_pte_t));
+	smp_mb();
+
+	return 0;
+}
+
+static int ggtt_dirty_validate(const void *buf, size_t size, u32 num_ptes)
+{
+	struct iov_ggtt_dirty_run run;
+	size_t pos = 0;
+
+	while (pos < size) {
+		if (size - pos < sizeof(run))
+			return -EPROTO;
+
+		memcpy(&run, buf + pos, sizeof(run));
+		pos += sizeof(run);
+
+		if (!run.count || run.offset >= num_ptes || run.count > num_ptes - run.offset ||
+		    run.count > (size - pos) / sizeof(gen8_pte_t))
+			return -EPROTO;
+
+		pos += run.count * sizeof(gen8_pte_t);
+	}
+
+	return 0;
+}
+
+/**
+ * intel_iov_ggtt_shadow_load_dirty - restore runs of VF GGTT PTEs
+ * @iov: the &struct intel_iov
+ * @vfid: VF id
+ * @buf: buffer filled by intel_iov_ggtt_shadow_save_dirty()
+ * @size: size of the buffer (in bytes)
+ * @flags: function flags:
+ *         - #I915_GGTT_RESTORE_PTES_VFID_MASK - VFID for restored PTEs
+ *         - #I915_GGTT_RESTORE_PTES_NEW_VFID - restore PTEs with new VFID
+ *           (from #I915_GGTT_RESTORE_PTES_VFID_MASK)
+ *
+ * Returns: 0 on success, -EOPNOTSUPP if the shadow GGTT is not used,
+ *          -EPROTO if @buf is malformed, or other negative error code.
+ */
+int intel_iov_ggtt_shadow_load_dirty(struct intel_iov *iov, unsigned int vfid, const void *buf,
+				     size_t size, unsigned int flags)
+{
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[vfid].ggtt_region;
+	struct iov_ggtt_dirty_run run;
+	struct pf_ggtt_batch batch;
+	size_t pos = 0;
+	int err;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(flags & I915_GGTT_RESTORE_PTES_NEW_VFID &&
+		   vfid != FIELD_GET(I915_GGTT_RESTORE_PTES_VFID_MASK, flags));
+
+	if (!iov->pf.ggtt.shadows_ggtt)
+		return -EOPNOTSUPP;
+
+	err = pf_ggtt_batch_init(&batch, iov, vfid, 0, 1);
+	if (unlikely(err))
+		return err;
+
+	err = ggtt_dirty_validate(buf, size, node->size / I915_GTT_PAGE_SIZE_4K);
+	if (unlikely(err))
+		return err;
+
+	while (pos < size) {
+		memcpy(&run, buf + pos, sizeof(run));
+		pos += sizeof(run);
+
+		err = pf_ggtt_batch_write(&batch);
+		if (unlikely(err))
+			return err;
+		batch.ggtt_addr = node->start + (u64)run.offset * I915_GTT_PAGE_SIZE_4K;
+
+		while (run.count--) {
+			gen8_pte_t pte;
+
+			if (batch.count == IOV_GGTT_STAGING_PTES) {
+				err = pf_ggtt_batch_write(&batch);
+				if (unlikely(err))
+					return err;
+			}
+
+			memcpy(&pte, buf + pos, sizeof(pte));
+			pos += sizeof(pte);
+
+			if (flags & I915_GGTT_RESTORE_PTES_NEW_VFID)
+				pte |= i915_ggtt_prepare_vf_pte(vfid);
+
+			batch.ptes[batch.count++] = pte;
+		}
+	}
+
+	err = pf_ggtt_batch_finish(&batch);
+
+	return err < 0 ? err : 0;
+}
+
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
 #include "selftests/selftest_mock_iov_ggtt.c"
 #endif
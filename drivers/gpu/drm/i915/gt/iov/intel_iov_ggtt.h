@@ -10,15 +10,26 @@
 #include "abi/iov_actions_mmio_abi.h"
 
 struct intel_iov;
+struct intel_iov_ggtt_range;
 
 int intel_iov_ggtt_pf_update_vf_ptes(struct intel_iov *iov, u32 vfid, u32 pte_offset, u8 mode,
 				     u16 num_copies, gen8_pte_t *ptes, u16 count);
+int intel_iov_ggtt_pf_update_vf_ranges(struct intel_iov *iov, u32 vfid, u32 pte_offset,
+				       const struct intel_iov_ggtt_range *ranges,
+				       u16 num_ranges);
 void intel_iov_ggtt_vf_init_early(struct intel_iov *iov);
 void intel_iov_ggtt_vf_release(struct intel_iov *iov);
 
 void intel_iov_ggtt_vf_update_pte(struct intel_iov *iov, u32 offset, gen8_pte_t pte);
 void intel_iov_ggtt_vf_flush_ptes(struct intel_iov *iov);
 
+void intel_iov_ggtt_vf_alloc_init(struct intel_iov *iov, u64 start, u64 size);
+void intel_iov_ggtt_vf_alloc_fini(struct intel_iov *iov);
+int intel_iov_ggtt_vf_insert(struct intel_iov *iov, struct drm_mm *mm,
+			     struct drm_mm_node *node, u64 size, u64 alignment,
+			     unsigned long color, u64 *start, u64 *end);
+void intel_iov_ggtt_vf_remove(struct intel_iov *iov, const struct drm_mm_node *node);
+
 int intel_iov_ggtt_shadow_init(struct intel_iov *iov);
 void intel_iov_ggtt_shadow_fini(struct intel_iov *iov);
 
@@ -28,11 +39,24 @@ void intel_iov_ggtt_shadow_vf_free(struct intel_iov *iov, unsigned int vfid);
 
 void intel_iov_ggtt_shadow_set_pte(struct intel_iov *iov, unsigned int vfid, u64 pte_offset,
 				   gen8_pte_t pte);
+void intel_iov_ggtt_shadow_set_ptes(struct intel_iov *iov, unsigned int vfid, u64 ggtt_addr,
+				    const gen8_pte_t *ptes, u32 count);
 gen8_pte_t intel_iov_ggtt_shadow_get_pte(struct intel_iov *iov, unsigned int vfid, u64 pte_offset);
 
 int intel_iov_ggtt_shadow_save(struct intel_iov *iov, unsigned int vfid, void *buf, size_t size,
 			       unsigned int flags);
+int intel_iov_ggtt_shadow_save_chunk(struct intel_iov *iov, unsigned int vfid, u64 offset,
+				     void *buf, size_t size, unsigned int flags);
 int intel_iov_ggtt_shadow_restore(struct intel_iov *iov, unsigned int vfid, const void *buf,
 				  size_t size, unsigned int flags);
+int intel_iov_ggtt_shadow_load_chunk(struct intel_iov *iov, unsigned int vfid, u64 offset,
+				     const void *buf, size_t size, unsigned int flags);
+int intel_iov_ggtt_shadow_sync(struct intel_iov *iov, unsigned int vfid);
+
+int intel_iov_ggtt_shadow_save_dirty(struct intel_iov *iov, unsigned int vfid, void *buf,
+				     size_t size, unsigned int flags);
+int intel_iov_ggtt_shadow_clear_dirty(struct intel_iov *iov, unsigned int vfid);
+int intel_iov_ggtt_shadow_load_dirty(struct intel_iov *iov, unsigned int vfid, const void *buf,
+				     size_t size, unsigned int flags);
 
 #endif /* __INTEL_IOV_GGTT_H__ */
@@ -266,6 +266,51 @@ static void __guc_mem_irq_handler(struct intel_guc *guc, u8 *status)
 	}
 }
 
+static bool vf_uses_memirq(struct drm_i915_private *i915)
+{
+	return IS_SRIOV_VF(i915) && HAS_MEMORY_IRQ_STATUS(i915);
+}
+
+/**
+ * intel_iov_memirq_engine_unpark - Start checking engine interrupts.
+ * @engine: the engine that is being unparked
+ *
+ * Include the engine in the set of interrupt sources checked by the
+ * intel_iov_memirq_handler(). Must be called before any work is submitted.
+ */
+void intel_iov_memirq_engine_unpark(struct intel_engine_cs *engine)
+{
+	struct intel_iov_memirq *irq = &engine->gt->iov.vf.irq;
+
+	if (!vf_uses_memirq(engine->i915))
+		return;
+
+	GEM_BUG_ON(engine->irq_offset >= ARRAY_SIZE(irq->engines));
+	GEM_BUG_ON(engine->irq_offset == GEN11_GUC);
+
+	WRITE_ONCE(irq->engines[engine->irq_offset], engine);
+	set_bit(engine->irq_offset, irq->active);
+	smp_mb__after_atomic();
+}
+
+/**
+ * intel_iov_memirq_engine_park - Stop checking engine interrupts.
+ * @engine: the engine that is being parked
+ *
+ * Exclude idle engine from the set of interrupt sources checked by the
+ * intel_iov_memirq_handler(). Any stale interrupt left in the source page
+ * will be handled once the engine is unparked again.
+ */
+void intel_iov_memirq_engine_park(struct intel_engine_cs *engine)
+{
+	struct intel_iov_memirq *irq = &engine->gt->iov.vf.irq;
+
+	if (!vf_uses_memirq(engine->i915))
+		return;
+
+	clear_bit(engine->irq_offset, irq->active);
+}
+
 /**
  * intel_iov_memirq_handler - TBD
  * @iov: the IOV struct
@@ -278,9 +323,12 @@ void intel_iov_memirq_handler(struct intel_iov *iov)
 	u8 *irq = iov->vf.irq.vaddr;
 	u8 * const source_base = irq + I915_VF_IRQ_SOURCE;
 	u8 * const status_base = irq + I915_VF_IRQ_STATUS;
+	__le64 * const source_words = (__le64 *)source_base;
+	DECLARE_BITMAP(active, I915_VF_IRQ_SOURCE_COUNT);
+	unsigned int w = UINT_MAX;
+	unsigned int offset;
+	u64 word = 0;
 	u8 *source, value;
-	struct intel_engine_cs *engine;
-	enum intel_engine_id id;
 
 	GEM_BUG_ON(!intel_iov_is_vf(iov));
 
@@ -290,15 +338,23 @@ void intel_iov_memirq_handler(struct intel_iov *iov)
 	MEMIRQ_DEBUG(gt, "SOURCE %*ph\n", 32, source_base);
 	MEMIRQ_DEBUG(gt, "SOURCE %*ph\n", 32, source_base + 32);
 
-	/* TODO: Only check active engines */
-	for_each_engine(engine, gt, id) {
-		source = source_base + engine->irq_offset;
-		value = READ_ONCE(*source);
-		if (value == 0xff) {
-			WRITE_ONCE(*source, 0x00);
-			__engine_mem_irq_handler(engine, status_base +
-						 engine->irq_offset * SZ_16);
+	/*
+	 * Only check source bytes of unparked engines, reading each source
+	 * word just once for all engines that share it.
+	 */
+	bitmap_copy(active, iov->vf.irq.active, I915_VF_IRQ_SOURCE_COUNT);
+	for_each_set_bit(offset, active, I915_VF_IRQ_SOURCE_COUNT) {
+		if (offset / sizeof(u64) != w) {
+			w = offset / sizeof(u64);
+			word = le64_to_cpu(READ_ONCE(source_words[w]));
 		}
+
+		if ((u8)(word >> (offset % sizeof(u64) * BITS_PER_BYTE)) != 0xff)
+			continue;
+
+		WRITE_ONCE(source_base[offset], 0x00);
+		__engine_mem_irq_handler(READ_ONCE(iov->vf.irq.engines[offset]),
+					 status_base + offset * SZ_16);
 	}
 
 	/* GuC must be check separately */
@@ -6,6 +6,7 @@
 #ifndef __INTEL_IOV_MEMIRQ_H__
 #define __INTEL_IOV_MEMIRQ_H__
 
+struct intel_engine_cs;
 struct intel_iov;
 
 int intel_iov_memirq_init(struct intel_iov *iov);
@@ -17,4 +18,7 @@ void intel_iov_memirq_reset(struct intel_iov *iov);
 void intel_iov_memirq_postinstall(struct intel_iov *iov);
 void intel_iov_memirq_handler(struct intel_iov *iov);
 
+void intel_iov_memirq_engine_unpark(struct intel_engine_cs *engine);
+void intel_iov_memirq_engine_park(struct intel_engine_cs *engine);
+
 #endif /* __INTEL_IOV_MEMIRQ_H__ */
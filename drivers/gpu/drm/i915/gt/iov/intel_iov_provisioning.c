@@ -3,6 +3,8 @@
  * Copyright © 2022 Intel Corporation
  */
 
+#include <linux/sort.h>
+
 #include "intel_iov.h"
 #include "intel_iov_ggtt.h"
 #include "intel_iov_provisioning.h"
@@ -73,8 +75,14 @@ void intel_iov_provisioning_init_early(struct intel_iov *iov)
  */
 void intel_iov_provisioning_release(struct intel_iov *iov)
 {
+	unsigned int n;
+
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 
+	iov->pf.provisioning.profile = NULL;
+	for (n = 0; n < IOV_MAX_PROFILES; n++)
+		kfree(fetch_and_zero(&iov->pf.provisioning.profiles[n]));
+
 	mutex_destroy(&iov->pf.provisioning.lock);
 	kfree(fetch_and_zero(&iov->pf.provisioning.configs));
 }
@@ -378,9 +386,26 @@ static bool pf_is_config_pushed(struct intel_iov *iov, unsigned int id)
 	return id <= iov->pf.provisioning.num_pushed;
 }
 
+/*
+ * While VF provisioning changes are staged, they are only recorded in the
+ * local configs and then pushed to the GuC all at once on commit.
+ * Staging always applies to all GTs, as the root tile also pushes the GGTT
+ * config to the media GT, so the flag is kept by the root tile.
+ */
+static bool *pf_staging_flag(struct intel_iov *iov)
+{
+	return &iov_get_root(iov)->pf.provisioning.staging;
+}
+
+static bool pf_is_staging_config(struct intel_iov *iov, unsigned int id)
+{
+	return id != PFID && *pf_staging_flag(iov);
+}
+
 static bool pf_needs_push_config(struct intel_iov *iov, unsigned int id)
 {
-	return id != PFID && pf_is_vf_enabled(iov, id) && pf_is_config_pushed(iov, id);
+	return id != PFID && pf_is_vf_enabled(iov, id) && pf_is_config_pushed(iov, id) &&
+	       !pf_is_staging_config(iov, id);
 }
 
 /*
@@ -633,6 +658,154 @@ static int pf_push_config_ggtt(struct intel_iov *iov, unsigned int id, u64 start
 	return err ?: err2;
 }
 
+/*
+ * GGTT regions of VFs that are not enabled can still be moved, as their
+ * configuration is pushed to the GuC only when VFs are enabled. Regions of
+ * enabled VFs, even paused ones, stay in place since the VF driver has no
+ * way to learn that its GGTT base has changed.
+ */
+static bool pf_is_vf_relocatable(struct intel_iov *iov, unsigned int id)
+{
+	return id != PFID && !pf_is_vf_enabled(iov, id);
+}
+
+struct pf_ggtt_move {
+	unsigned int id;
+	u64 start;
+	u64 size;
+};
+
+static int pf_ggtt_move_cmp(const void *a, const void *b)
+{
+	const struct pf_ggtt_move *ma = a, *mb = b;
+
+	/* largest regions first, then by VF id */
+	if (ma->size != mb->size)
+		return ma->size < mb->size ? 1 : -1;
+
+	return ma->id < mb->id ? -1 : 1;
+}
+
+static int pf_ggtt_insert_compact(struct i915_ggtt *ggtt, struct drm_mm_node *node,
+				  u64 size, u64 alignment)
+{
+	return i915_gem_gtt_insert(&ggtt->vm, NULL, node, size, alignment,
+				   I915_COLOR_UNEVICTABLE,
+				   ggtt->pin_bias, GUC_GGTT_TOP,
+				   PIN_HIGH | PIN_NOEVICT);
+}
+
+/*
+ * Make room for a new GGTT region of @size by repacking regions of all
+ * relocatable VFs. The requested space is claimed first, then the moved
+ * regions are placed again, largest first. VF PTEs are rewritten at the
+ * new location from the shadow GGTT. If the regions can't be packed, all
+ * of them are restored at their original location.
+ *
+ * Return: 0 on success, -ENOSPC if regions can't be packed, or -EIO if
+ *         any of the regions could not be restored.
+ */
+static int pf_compact_ggtt(struct intel_iov *iov, unsigned int id, u64 size)
+{
+	struct intel_iov_config *configs = iov->pf.provisioning.configs;
+	unsigned int n, i, placed = 0, count = 0, total_vfs = pf_get_totalvfs(iov);
+	struct i915_ggtt *ggtt = iov_to_gt(iov)->ggtt;
+	u64 alignment = pf_get_ggtt_alignment(iov);
+	struct drm_mm_node hole = {};
+	struct pf_ggtt_move *moves;
+	struct drm_mm_node *node;
+	int err;
+
+	lockdep_assert_held(pf_provisioning_mutex(iov));
+	GEM_BUG_ON(drm_mm_node_allocated(&configs[id].ggtt_region));
+
+	moves = kcalloc(total_vfs, sizeof(*moves), GFP_KERNEL);
+	if (unlikely(!moves))
+		return -ENOMEM;
+
+	for (n = VFID(1); n <= total_vfs; n++) {
+		node = &configs[n].ggtt_region;
+		if (n == id || !drm_mm_node_allocated(node) || !pf_is_vf_relocatable(iov, n))
+			continue;
+
+		moves[count].id = n;
+		moves[count].start = node->start;
+		moves[count].size = node->size;
+		count++;
+	}
+
+	err = -ENOSPC;
+	if (!count)
+		goto out;
+
+	sort(moves, count, sizeof(*moves), pf_ggtt_move_cmp, NULL);
+
+	for (i = 0; i < count; i++)
+		i915_ggtt_set_space_owner(ggtt, 0, &configs[moves[i].id].ggtt_region);
+
+	mutex_lock(&ggtt->vm.mutex);
+
+	for (i = 0; i < count; i++)
+		drm_mm_remove_node(&configs[moves[i].id].ggtt_region);
+
+	err = pf_ggtt_insert_compact(ggtt, &hole, size, alignment);
+	while (!err && placed < count) {
+		node = &configs[moves[placed].id].ggtt_region;
+		err = pf_ggtt_insert_compact(ggtt, node, moves[placed].size, alignment);
+		if (!err)
+			placed++;
+	}
+
+	if (unlikely(err)) {
+		int restored;
+
+		/* original regions may overlap the hole */
+		if (drm_mm_node_allocated(&hole))
+			drm_mm_remove_node(&hole);
+
+		for (i = 0; i < placed; i++)
+			drm_mm_remove_node(&configs[moves[i].id].ggtt_region);
+
+		for (i = 0; i < count; i++) {
+			node = &configs[moves[i].id].ggtt_region;
+			node->start = moves[i].start;
+			node->size = moves[i].size;
+			node->color = I915_COLOR_UNEVICTABLE;
+			restored = drm_mm_reserve_node(&ggtt->vm.mm, node);
+			if (GEM_WARN_ON(restored)) {
+				IOV_ERROR(iov, "Failed to restore VF%u GGTT region %llx-%llx (%pe)\n",
+					  moves[i].id, moves[i].start,
+					  moves[i].start + moves[i].size - 1, ERR_PTR(restored));
+				err = -EIO;
+			}
+		}
+	}
+
+	if (drm_mm_node_allocated(&hole))
+		drm_mm_remove_node(&hole);
+
+	mutex_unlock(&ggtt->vm.mutex);
+
+	for (i = 0; i < count; i++) {
+		n = moves[i].id;
+		node = &configs[n].ggtt_region;
+		if (!drm_mm_node_allocated(node))
+			continue;
+
+		i915_ggtt_set_space_owner(ggtt, n, node);
+		if (unlikely(intel_iov_ggtt_shadow_sync(iov, n)))
+			IOV_ERROR(iov, "Failed to restore VF%u GGTT PTEs\n", n);
+
+		if (node->start != moves[i].start)
+			IOV_DEBUG(iov, "VF%u GGTT moved %llx -> %llx (%lluK)\n",
+				  n, moves[i].start, node->start, node->size / SZ_1K);
+	}
+
+out:
+	kfree(moves);
+	return err;
+}
+
 static int pf_provision_ggtt(struct intel_iov *iov, unsigned int id, u64 size)
 {
 	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
@@ -672,8 +845,17 @@ release:
 	if (size > ggtt->vm.total)
 		return -E2BIG;
 
-	if (size > pf_get_max_ggtt(iov))
-		return -EDQUOT;
+	if (size > pf_get_max_ggtt(iov)) {
+		if (size > pf_get_free_ggtt(iov))
+			return -EDQUOT;
+
+		err = pf_compact_ggtt(iov, id, size);
+		if (unlikely(err && err != -ENOSPC))
+			return err;
+
+		if (err || size > pf_get_max_ggtt(iov))
+			return -EDQUOT;
+	}
 
 	mutex_lock(&ggtt->vm.mutex);
 	err = i915_gem_gtt_insert(&ggtt->vm, NULL, node, size, alignment,
@@ -1080,6 +1262,93 @@ static int __pf_provision_ctxs(struct intel_iov *iov, unsigned int id, u16 start
 }
 
 static u16 pf_get_ctxs_max_quota(struct intel_iov *iov);
+static u16 pf_get_ctxs_free(struct intel_iov *iov);
+
+struct pf_ctxs_move {
+	unsigned int id;
+	u16 begin_ctx;
+	u16 num_ctxs;
+};
+
+static int pf_ctxs_move_cmp(const void *a, const void *b)
+{
+	const struct pf_ctxs_move *ma = a, *mb = b;
+
+	/* largest ranges first, then by VF id */
+	if (ma->num_ctxs != mb->num_ctxs)
+		return ma->num_ctxs < mb->num_ctxs ? 1 : -1;
+
+	return ma->id < mb->id ? -1 : 1;
+}
+
+/*
+ * Make room for a new range of @num_ctxs contexts by repacking context
+ * ranges of all relocatable VFs, like pf_compact_ggtt() does for GGTT.
+ * New ranges of moved VFs are pushed to the GuC when VFs are enabled.
+ */
+static int pf_compact_ctxs(struct intel_iov *iov, unsigned int id, u16 num_ctxs)
+{
+	struct intel_iov_config *configs = iov->pf.provisioning.configs;
+	unsigned int n, i, count = 0, total_vfs = pf_get_totalvfs(iov);
+	struct pf_ctxs_move *moves;
+	int ret;
+
+	lockdep_assert_held(pf_provisioning_mutex(iov));
+	GEM_BUG_ON(configs[id].num_ctxs);
+
+	moves = kcalloc(total_vfs, sizeof(*moves), GFP_KERNEL);
+	if (unlikely(!moves))
+		return -ENOMEM;
+
+	for (n = VFID(1); n <= total_vfs; n++) {
+		if (n == id || !configs[n].num_ctxs || !pf_is_vf_relocatable(iov, n))
+			continue;
+
+		moves[count].id = n;
+		moves[count].begin_ctx = configs[n].begin_ctx;
+		moves[count].num_ctxs = configs[n].num_ctxs;
+		count++;
+	}
+
+	ret = -ENOSPC;
+	if (!count)
+		goto out;
+
+	sort(moves, count, sizeof(*moves), pf_ctxs_move_cmp, NULL);
+
+	for (i = 0; i < count; i++)
+		__pf_provision_vf_ctxs(iov, moves[i].id, 0, 0);
+
+	/* claim the requested range first, it is released again below */
+	ret = pf_alloc_vf_ctxs_range(iov, id, num_ctxs);
+	if (ret >= 0) {
+		__pf_provision_vf_ctxs(iov, id, ret, num_ctxs);
+
+		for (i = 0; i < count; i++) {
+			ret = pf_alloc_vf_ctxs_range(iov, moves[i].id, moves[i].num_ctxs);
+			if (ret < 0)
+				break;
+			__pf_provision_vf_ctxs(iov, moves[i].id, ret, moves[i].num_ctxs);
+
+			if (ret != moves[i].begin_ctx)
+				IOV_DEBUG(iov, "VF%u contexts moved %u -> %u (%u)\n",
+					  moves[i].id, moves[i].begin_ctx, ret,
+					  moves[i].num_ctxs);
+		}
+
+		__pf_provision_vf_ctxs(iov, id, 0, 0);
+	}
+
+	if (ret < 0) {
+		for (i = 0; i < count; i++)
+			__pf_provision_vf_ctxs(iov, moves[i].id, moves[i].begin_ctx,
+					       moves[i].num_ctxs);
+	}
+
+out:
+	kfree(moves);
+	return ret < 0 ? ret : 0;
+}
 
 static int pf_provision_ctxs(struct intel_iov *iov, unsigned int id, u16 num_ctxs)
 {
@@ -1101,8 +1370,12 @@ static int pf_provision_ctxs(struct intel_iov *iov, unsigned int id, u16 num_ctx
 	if (!num_ctxs || ret)
 		return ret;
 
-	if (ctxs_quota > pf_get_ctxs_max_quota(iov))
-		return -EDQUOT;
+	if (ctxs_quota > pf_get_ctxs_max_quota(iov)) {
+		if (ctxs_quota > pf_get_ctxs_free(iov) ||
+		    pf_compact_ctxs(iov, id, ctxs_quota) ||
+		    ctxs_quota > pf_get_ctxs_max_quota(iov))
+			return -EDQUOT;
+	}
 
 	ret = pf_alloc_ctxs_range(iov, id, ctxs_quota);
 	if (ret >= 0)
@@ -1568,6 +1841,9 @@ static const char *exec_quantum_unit(u32 exec_quantum)
 
 static int pf_push_config_exec_quantum(struct intel_iov *iov, unsigned int id, u32 exec_quantum)
 {
+	if (pf_is_staging_config(iov, id))
+		return 0;
+
 	return guc_update_vf_klv32(iov_to_guc(iov), id,
 				   GUC_KLV_VF_CFG_EXEC_QUANTUM_KEY, exec_quantum);
 }
@@ -1581,7 +1857,7 @@ static int pf_provision_exec_quantum(struct intel_iov *iov, unsigned int id,
 
 	lockdep_assert_held(pf_provisioning_mutex(iov));
 
-	if (exec_quantum == config->exec_quantum)
+	if (exec_quantum == config->exec_quantum && !config->exec_quantum_tuned)
 		return 0;
 
 	err = pf_push_config_exec_quantum(iov, id, exec_quantum);
@@ -1589,18 +1865,24 @@ static int pf_provision_exec_quantum(struct intel_iov *iov, unsigned int id,
 		return err;
 
 	config->exec_quantum = exec_quantum;
+	config->exec_quantum_tuned = 0;
 
 	IOV_DEBUG(iov, "VF%u provisioned with %u%s execution quantum\n",
 		  id, exec_quantum, exec_quantum_unit(exec_quantum));
 	return 0;
 }
 
+static u32 config_exec_quantum(const struct intel_iov_config *config)
+{
+	return config->exec_quantum_tuned ?: config->exec_quantum;
+}
+
 static int pf_reprovision_exec_quantum(struct intel_iov *iov, unsigned int id)
 {
 	lockdep_assert_held(pf_provisioning_mutex(iov));
 
 	return pf_push_config_exec_quantum(iov, id,
-					   iov->pf.provisioning.configs[id].exec_quantum);
+					   config_exec_quantum(&iov->pf.provisioning.configs[id]));
 }
 
 /**
@@ -1657,6 +1939,92 @@ u32 intel_iov_provisioning_get_exec_quantum(struct intel_iov *iov, unsigned int
 	return exec_quantum;
 }
 
+/**
+ * intel_iov_provisioning_get_tuned_exec_quantum - Get VF effective execution quantum.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ *
+ * This function can only be called on PF.
+ *
+ * Return: execution quantum set by intel_iov_provisioning_tune_exec_quanta(),
+ * or the provisioned one if it was not tuned.
+ */
+u32 intel_iov_provisioning_get_tuned_exec_quantum(struct intel_iov *iov, unsigned int id)
+{
+	u32 exec_quantum;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id > pf_get_totalvfs(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	exec_quantum = config_exec_quantum(&iov->pf.provisioning.configs[id]);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return exec_quantum;
+}
+
+/**
+ * intel_iov_provisioning_tune_exec_quanta - Update VFs execution quanta.
+ * @iov: the IOV struct
+ * @exec_quanta: new execution quanta indexed by VF id, 0 to use provisioned one,
+ *               or NULL to use provisioned execution quanta for all VFs
+ * @num_vfs: number of VFs to update
+ *
+ * Unlike intel_iov_provisioning_set_exec_quantum(), tuned values don't replace
+ * the provisioned ones, which are used again once tuning is reverted.
+ * Only execution quanta of the changed VFs are pushed to the GuC, and only if
+ * the device is awake, otherwise they will be pushed with the full config.
+ * Nothing is updated while provisioning changes are staged.
+ *
+ * This function can only be called on PF.
+ */
+void intel_iov_provisioning_tune_exec_quanta(struct intel_iov *iov, const u32 *exec_quanta,
+					     unsigned int num_vfs)
+{
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
+	intel_wakeref_t wakeref;
+	unsigned int n;
+	u32 exec_quantum;
+	int err;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(num_vfs > pf_get_totalvfs(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	if (*pf_staging_flag(iov))
+		goto out;
+
+	for (n = VFID(1); n <= num_vfs; n++) {
+		struct intel_iov_config *config = &provisioning->configs[n];
+		u32 tuned = exec_quanta ? exec_quanta[n] : 0;
+
+		if (tuned == config->exec_quantum_tuned)
+			continue;
+
+		exec_quantum = tuned ?: config->exec_quantum;
+		if (exec_quantum != config_exec_quantum(config)) {
+			err = 0;
+			with_intel_runtime_pm_if_active(rpm, wakeref)
+				err = pf_push_config_exec_quantum(iov, n, exec_quantum);
+			if (unlikely(err)) {
+				IOV_ERROR(iov, "Failed to tune VF%u execution quantum to %u%s (%pe)\n",
+					  n, exec_quantum, exec_quantum_unit(exec_quantum),
+					  ERR_PTR(err));
+				continue;
+			}
+		}
+
+		IOV_DEBUG(iov, "VF%u execution quantum tuned %u -> %u%s\n", n,
+			  config_exec_quantum(config), exec_quantum,
+			  exec_quantum_unit(exec_quantum));
+		config->exec_quantum_tuned = tuned;
+	}
+out:
+	mutex_unlock(pf_provisioning_mutex(iov));
+}
+
 static const char *preempt_timeout_unit(u32 preempt_timeout)
 {
 	return preempt_timeout ? "us" : "(inifinity)";
@@ -1665,6 +2033,9 @@ static const char *preempt_timeout_unit(u32 preempt_timeout)
 static int pf_push_config_preempt_timeout(struct intel_iov *iov, unsigned int id,
 					  u32 preempt_timeout)
 {
+	if (pf_is_staging_config(iov, id))
+		return 0;
+
 	return guc_update_vf_klv32(iov_to_guc(iov), id,
 				   GUC_KLV_VF_CFG_PREEMPT_TIMEOUT_KEY, preempt_timeout);
 }
@@ -1763,6 +2134,16 @@ static u32 intel_iov_threshold_to_klv_key(enum intel_iov_threshold threshold)
 	return 0; /* unreachable */
 }
 
+static int pf_push_config_threshold(struct intel_iov *iov, unsigned int id,
+				    enum intel_iov_threshold threshold, u32 value)
+{
+	if (pf_is_staging_config(iov, id))
+		return 0;
+
+	return guc_update_vf_klv32(iov_to_guc(iov), id,
+				   intel_iov_threshold_to_klv_key(threshold), value);
+}
+
 static int pf_provision_threshold(struct intel_iov *iov, unsigned int id,
 				  enum intel_iov_threshold threshold, u32 value)
 {
@@ -1775,8 +2156,7 @@ static int pf_provision_threshold(struct intel_iov *iov, unsigned int id,
 	if (value == config->thresholds[threshold])
 		return 0;
 
-	err = guc_update_vf_klv32(iov_to_guc(iov), id,
-				  intel_iov_threshold_to_klv_key(threshold), value);
+	err = pf_push_config_threshold(iov, id, threshold, value);
 	if (unlikely(err))
 		return err;
 
@@ -1928,12 +2308,51 @@ static void pf_auto_unprovision(struct intel_iov *iov)
 	pf_set_auto_provisioning(iov, false);
 }
 
+static struct intel_iov_profile *pf_auto_profile(struct intel_iov *iov)
+{
+	lockdep_assert_held(pf_provisioning_mutex(iov));
+
+	return iov_get_root(iov)->pf.provisioning.profile;
+}
+
+static const char *profile_name(const struct intel_iov_profile *profile)
+{
+	return profile ? profile->name : "fair";
+}
+
+static u16 profile_vf_weight(const struct intel_iov_profile *profile, unsigned int id)
+{
+	GEM_BUG_ON(id == PFID);
+
+	return profile && id <= profile->num_vfs ? profile->vfs[id - 1].weight : 1;
+}
+
+static u32 profile_total_weight(const struct intel_iov_profile *profile, unsigned int num_vfs)
+{
+	u32 total = 0;
+	unsigned int n;
+
+	for (n = 1; n <= num_vfs; n++)
+		total += profile_vf_weight(profile, n);
+
+	return total;
+}
+
+/* without profile all VFs get weight 1 and this is the same as a fair split */
+static u64 profile_vf_share(const struct intel_iov_profile *profile, unsigned int id,
+			    unsigned int num_vfs, u64 available)
+{
+	return mul_u64_u32_div(available, profile_vf_weight(profile, id),
+			       profile_total_weight(profile, num_vfs));
+}
+
 static int pf_auto_provision_ggtt(struct intel_iov *iov, unsigned int num_vfs)
 {
+	struct intel_iov_profile *profile = pf_auto_profile(iov);
 	u64 __maybe_unused free = pf_get_free_ggtt(iov);
 	u64 available = pf_get_max_ggtt(iov);
 	u64 alignment = pf_get_ggtt_alignment(iov);
-	u64 fair;
+	u64 share;
 	unsigned int n;
 	int err;
 
@@ -1943,19 +2362,19 @@ static int pf_auto_provision_ggtt(struct intel_iov *iov, unsigned int num_vfs)
 	 * and both already accounts for the spare GGTT
 	 */
 
-	fair = div_u64(available, num_vfs);
-	fair = ALIGN_DOWN(fair, alignment);
-
-	IOV_DEBUG(iov, "GGTT available(%llu/%llu) fair(%u x %llu)\n",
-		  available, free, num_vfs, fair);
-	if (!fair)
-		return -ENOSPC;
+	IOV_DEBUG(iov, "GGTT available(%llu/%llu) profile(%s)\n",
+		  available, free, profile_name(profile));
 
 	for (n = 1; n <= num_vfs; n++) {
+		share = profile_vf_share(profile, n, num_vfs, available);
+		share = ALIGN_DOWN(share, alignment);
+		if (!share)
+			return -ENOSPC;
+
 		if (pf_is_valid_config_ggtt(iov, n))
 			return -EUCLEAN;
 
-		err = pf_provision_ggtt(iov, n, fair);
+		err = pf_provision_ggtt(iov, n, share);
 		if (unlikely(err))
 			return err;
 	}
@@ -1965,25 +2384,28 @@ static int pf_auto_provision_ggtt(struct intel_iov *iov, unsigned int num_vfs)
 
 static int pf_auto_provision_ctxs(struct intel_iov *iov, unsigned int num_vfs)
 {
-	u16 n, fair;
+	struct intel_iov_profile *profile = pf_auto_profile(iov);
+	u16 n, share;
 	u16 available;
 	int err;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 
 	available = pf_get_ctxs_free(iov);
-	fair = ALIGN_DOWN(available / num_vfs, CTXS_GRANULARITY);
-
-	if (!fair)
-		return -ENOSPC;
 
-	IOV_DEBUG(iov, "contexts available(%hu) fair(%u x %hu)\n", available, num_vfs, fair);
+	IOV_DEBUG(iov, "contexts available(%hu) profile(%s)\n",
+		  available, profile_name(profile));
 
 	for (n = 1; n <= num_vfs; n++) {
+		share = profile_vf_share(profile, n, num_vfs, available);
+		share = ALIGN_DOWN(share, CTXS_GRANULARITY);
+		if (!share)
+			return -ENOSPC;
+
 		if (pf_is_valid_config_ctxs(iov, n))
 			return -EUCLEAN;
 
-		err = pf_provision_ctxs(iov, n, fair);
+		err = pf_provision_ctxs(iov, n, share);
 		if (unlikely(err))
 			return err;
 	}
@@ -1994,23 +2416,47 @@ static int pf_auto_provision_ctxs(struct intel_iov *iov, unsigned int num_vfs)
 static int pf_auto_provision_dbs(struct intel_iov *iov, unsigned int num_vfs)
 {
 	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
-	u16 available, fair;
+	struct intel_iov_profile *profile = pf_auto_profile(iov);
+	u16 available, share;
 	unsigned int n;
 	int err;
 
 	available = GUC_NUM_DOORBELLS - provisioning->configs[0].num_dbs;
-	fair = available / num_vfs;
 
-	IOV_DEBUG(iov, "doorbells available(%hu) fair(%u x %hu)\n",
-		  available, num_vfs, fair);
-	if (!fair)
-		return -ENOSPC;
+	IOV_DEBUG(iov, "doorbells available(%hu) profile(%s)\n",
+		  available, profile_name(profile));
 
 	for (n = 1; n <= num_vfs; n++) {
+		share = profile_vf_share(profile, n, num_vfs, available);
+		if (!share)
+			return -ENOSPC;
+
 		if (pf_is_valid_config_dbs(iov, n))
 			return -EUCLEAN;
 
-		err = pf_provision_dbs(iov, n, fair);
+		err = pf_provision_dbs(iov, n, share);
+		if (unlikely(err))
+			return err;
+	}
+
+	return 0;
+}
+
+static int pf_auto_provision_sched(struct intel_iov *iov, unsigned int num_vfs)
+{
+	struct intel_iov_profile *profile = pf_auto_profile(iov);
+	unsigned int n;
+	int err;
+
+	if (!profile)
+		return 0;
+
+	for (n = 1; n <= min(num_vfs, profile->num_vfs); n++) {
+		err = pf_provision_exec_quantum(iov, n, profile->vfs[n - 1].exec_quantum);
+		if (unlikely(err))
+			return err;
+
+		err = pf_provision_preempt_timeout(iov, n, profile->vfs[n - 1].preempt_timeout);
 		if (unlikely(err))
 			return err;
 	}
@@ -2047,6 +2493,10 @@ static int pf_auto_provision(struct intel_iov *iov, unsigned int num_vfs)
 	if (unlikely(err))
 		goto fail;
 
+	err = pf_auto_provision_sched(iov, num_vfs);
+	if (unlikely(err))
+		goto fail;
+
 	return 0;
 fail:
 	IOV_ERROR(iov, "Failed to auto provision %u VFs (%pe)",
@@ -2061,7 +2511,8 @@ fail:
  * @num_vfs: number of VFs to auto configure or 0 to unprovision
  *
  * Perform auto provisioning by allocating fair amount of available
- * resources for each VF that are to be enabled.
+ * resources for each VF that are to be enabled, or amount proportional
+ * to the VF weight if a provisioning profile was selected.
  *
  * This function shall be called only on PF.
  *
@@ -2083,44 +2534,301 @@ int intel_iov_provisioning_auto(struct intel_iov *iov, unsigned int num_vfs)
 	return err;
 }
 
-static int pf_validate_config(struct intel_iov *iov, unsigned int id)
+static int pf_find_profile(struct intel_iov *iov, const char *name)
 {
-	bool valid_ggtt = pf_is_valid_config_ggtt(iov, id);
-	bool valid_ctxs = pf_is_valid_config_ctxs(iov, id);
-	bool valid_dbs = pf_is_valid_config_dbs(iov, id);
-	bool valid_any = valid_ggtt || valid_ctxs || valid_dbs;
-	bool valid_all = valid_ggtt && valid_ctxs;
+	struct intel_iov_profile **profiles = iov->pf.provisioning.profiles;
+	unsigned int n;
 
-	/* we don't require doorbells, but will check if were assigned */
+	GEM_BUG_ON(!iov_is_root(iov));
+	lockdep_assert_held(pf_provisioning_mutex(iov));
 
-	if (iov_to_gt(iov)->type == GT_MEDIA) {
-		struct intel_iov *root = iov_get_root(iov);
+	for (n = 0; n < IOV_MAX_PROFILES; n++)
+		if (profiles[n] && !strcmp(profiles[n]->name, name))
+			return n;
 
-		GEM_BUG_ON(iov_is_root(iov));
-		valid_ggtt = pf_is_valid_config_ggtt(root, id);
-		valid_any = valid_ctxs || valid_dbs;
-		valid_all = valid_any && valid_ggtt && valid_ctxs &&
-			    pf_validate_config(root, id) == 0;
-	}
+	return -ENOENT;
+}
 
-	if (!valid_all) {
-		IOV_DEBUG(iov, "%u: invalid config: %s%s%s\n", id,
-			  valid_ggtt ? "" : "GGTT ",
-			  valid_ctxs ? "" : "contexts ",
-			  valid_dbs ? "" : "doorbells ");
-		return valid_any ? -ENOKEY : -ENODATA;
+static int parse_profile_vf(char *tok, struct intel_iov_profile_vf *vf)
+{
+	char *field = strsep(&tok, ":");
+	int err;
+
+	err = kstrtou16(field, 0, &vf->weight);
+	if (err)
+		return err;
+	if (!vf->weight)
+		return -EINVAL;
+
+	field = strsep(&tok, ":");
+	if (field) {
+		err = kstrtou32(field, 0, &vf->exec_quantum);
+		if (err)
+			return err;
 	}
 
+	if (tok)
+		return kstrtou32(tok, 0, &vf->preempt_timeout);
+
 	return 0;
 }
 
-/**
- * intel_iov_provisioning_verify() - TBD
- * @iov: the IOV struct
- * @num_vfs: number of VFs configurations to verify
- *
- * Verify that VFs configurations are valid.
- *
+static struct intel_iov_profile *pf_parse_profile(struct intel_iov *iov, char *spec)
+{
+	unsigned int totalvfs = pf_get_totalvfs(iov);
+	struct intel_iov_profile *profile;
+	char *name, *tok;
+	int err;
+
+	name = strsep(&spec, " \t");
+	if (!*name || strlen(name) >= IOV_PROFILE_NAME_LEN || !strcmp(name, profile_name(NULL)))
+		return ERR_PTR(-EINVAL);
+
+	profile = kzalloc(struct_size(profile, vfs, totalvfs), GFP_KERNEL);
+	if (!profile)
+		return ERR_PTR(-ENOMEM);
+
+	strscpy(profile->name, name, sizeof(profile->name));
+
+	while ((tok = strsep(&spec, " \t"))) {
+		if (!*tok)
+			continue;
+
+		if (profile->num_vfs == totalvfs) {
+			err = -E2BIG;
+			goto fail;
+		}
+
+		err = parse_profile_vf(tok, &profile->vfs[profile->num_vfs++]);
+		if (err)
+			goto fail;
+	}
+
+	return profile;
+
+fail:
+	kfree(profile);
+	return ERR_PTR(err);
+}
+
+static int pf_set_profile(struct intel_iov *iov, struct intel_iov_profile *profile)
+{
+	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
+	int slot;
+
+	slot = pf_find_profile(iov, profile->name);
+
+	/* profile without VFs removes the existing one */
+	if (!profile->num_vfs) {
+		kfree(profile);
+
+		if (slot < 0)
+			return slot;
+		if (provisioning->profiles[slot] == provisioning->profile)
+			return -EBUSY;
+
+		kfree(fetch_and_zero(&provisioning->profiles[slot]));
+		return 0;
+	}
+
+	if (slot < 0) {
+		for (slot = 0; slot < IOV_MAX_PROFILES; slot++)
+			if (!provisioning->profiles[slot])
+				break;
+		if (slot == IOV_MAX_PROFILES) {
+			kfree(profile);
+			return -ENOSPC;
+		}
+	}
+
+	if (provisioning->profiles[slot] == provisioning->profile && provisioning->profile)
+		provisioning->profile = profile;
+
+	kfree(provisioning->profiles[slot]);
+	provisioning->profiles[slot] = profile;
+	return 0;
+}
+
+/**
+ * intel_iov_provisioning_set_profile() - Define auto-provisioning profile.
+ * @iov: the IOV struct
+ * @spec: profile definition
+ *
+ * Define (or replace) named profile that can be later selected to drive
+ * auto-provisioning. Definition is a name followed by space separated
+ * list of VF parameters as "weight[:exec_quantum_ms[:preempt_timeout_us]]".
+ * Definition without any VF parameters removes the profile.
+ *
+ * This function can only be called on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_provisioning_set_profile(struct intel_iov *iov, const char *spec)
+{
+	struct intel_iov_profile *profile;
+	char *buf;
+	int err;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(!iov_is_root(iov));
+
+	buf = kstrdup(spec, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	profile = pf_parse_profile(iov, strim(buf));
+	kfree(buf);
+	if (IS_ERR(profile))
+		return PTR_ERR(profile);
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	err = pf_set_profile(iov, profile);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return err;
+}
+
+/**
+ * intel_iov_provisioning_select_profile() - Select auto-provisioning profile.
+ * @iov: the IOV struct
+ * @name: name of the profile or "fair"
+ *
+ * Select profile that will be used by the next auto-provisioning.
+ *
+ * This function can only be called on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_provisioning_select_profile(struct intel_iov *iov, const char *name)
+{
+	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
+	int slot = 0;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(!iov_is_root(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	if (!strcmp(name, profile_name(NULL))) {
+		provisioning->profile = NULL;
+	} else {
+		slot = pf_find_profile(iov, name);
+		if (slot >= 0)
+			provisioning->profile = provisioning->profiles[slot];
+	}
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return slot < 0 ? slot : 0;
+}
+
+/**
+ * intel_iov_provisioning_show_profile() - Show selected auto-provisioning profile.
+ * @iov: the IOV struct
+ * @buf: the sysfs buffer
+ *
+ * This function can only be called on PF.
+ *
+ * Return: number of bytes written to @buf.
+ */
+ssize_t intel_iov_provisioning_show_profile(struct intel_iov *iov, char *buf)
+{
+	ssize_t ret;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(!iov_is_root(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	ret = sysfs_emit(buf, "%s\n", profile_name(iov->pf.provisioning.profile));
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return ret;
+}
+
+/**
+ * intel_iov_provisioning_show_profiles() - Show defined auto-provisioning profiles.
+ * @iov: the IOV struct
+ * @buf: the sysfs buffer
+ *
+ * Profiles are listed one per line, in the same format as they are defined.
+ * Profiles that don't fit into @buf are not listed.
+ *
+ * This function can only be called on PF.
+ *
+ * Return: number of bytes written to @buf.
+ */
+ssize_t intel_iov_provisioning_show_profiles(struct intel_iov *iov, char *buf)
+{
+	struct intel_iov_profile *profile;
+	unsigned int n, i;
+	ssize_t len = 0, start;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(!iov_is_root(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	for (n = 0; n < IOV_MAX_PROFILES; n++) {
+		profile = iov->pf.provisioning.profiles[n];
+		if (!profile)
+			continue;
+
+		start = len;
+		len += sysfs_emit_at(buf, len, "%s", profile->name);
+		for (i = 0; i < profile->num_vfs; i++)
+			len += sysfs_emit_at(buf, len, " %hu:%u:%u",
+					     profile->vfs[i].weight,
+					     profile->vfs[i].exec_quantum,
+					     profile->vfs[i].preempt_timeout);
+		len += sysfs_emit_at(buf, len, "\n");
+
+		/* buffer is full, drop the truncated profile and stop */
+		if (len == start || buf[len - 1] != '\n') {
+			buf[start] = '\0';
+			len = start;
+			break;
+		}
+	}
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return len;
+}
+
+static int pf_validate_config(struct intel_iov *iov, unsigned int id)
+{
+	bool valid_ggtt = pf_is_valid_config_ggtt(iov, id);
+	bool valid_ctxs = pf_is_valid_config_ctxs(iov, id);
+	bool valid_dbs = pf_is_valid_config_dbs(iov, id);
+	bool valid_any = valid_ggtt || valid_ctxs || valid_dbs;
+	bool valid_all = valid_ggtt && valid_ctxs;
+
+	/* we don't require doorbells, but will check if were assigned */
+
+	if (iov_to_gt(iov)->type == GT_MEDIA) {
+		struct intel_iov *root = iov_get_root(iov);
+
+		GEM_BUG_ON(iov_is_root(iov));
+		valid_ggtt = pf_is_valid_config_ggtt(root, id);
+		valid_any = valid_ctxs || valid_dbs;
+		valid_all = valid_any && valid_ggtt && valid_ctxs &&
+			    pf_validate_config(root, id) == 0;
+	}
+
+	if (!valid_all) {
+		IOV_DEBUG(iov, "%u: invalid config: %s%s%s\n", id,
+			  valid_ggtt ? "" : "GGTT ",
+			  valid_ctxs ? "" : "contexts ",
+			  valid_dbs ? "" : "doorbells ");
+		return valid_any ? -ENOKEY : -ENODATA;
+	}
+
+	return 0;
+}
+
+/**
+ * intel_iov_provisioning_verify() - TBD
+ * @iov: the IOV struct
+ * @num_vfs: number of VFs configurations to verify
+ *
+ * Verify that VFs configurations are valid.
+ *
  * This function shall be called only on PF.
  *
  * Return: 0 on success or a negative error code on failure.
@@ -2198,7 +2906,7 @@ static u32 encode_config(u32 *cfg, const struct intel_iov_config *config)
 	cfg[n++] = config->num_dbs;
 
 	cfg[n++] = MAKE_GUC_KLV(VF_CFG_EXEC_QUANTUM);
-	cfg[n++] = config->exec_quantum;
+	cfg[n++] = config_exec_quantum(config);
 
 	cfg[n++] = MAKE_GUC_KLV(VF_CFG_PREEMPT_TIMEOUT);
 	cfg[n++] = config->preempt_timeout;
@@ -2246,32 +2954,130 @@ static int pf_verify_config_klvs(struct intel_iov *iov, const u32 *cfg, u32 cfg_
 	return 0;
 }
 
+/*
+ * Return: number of configuration dwords written
+ *
+ * Releases all resources of the VF, in the same order as they are released
+ * by the per-resource pushes.
+ */
+static u32 encode_config_released(u32 *cfg)
+{
+	u32 n = 0;
+
+	cfg[n++] = MAKE_GUC_KLV(VF_CFG_GGTT_SIZE);
+	cfg[n++] = 0;
+	cfg[n++] = 0;
+
+	cfg[n++] = MAKE_GUC_KLV(VF_CFG_GGTT_START);
+	cfg[n++] = 0;
+	cfg[n++] = 0;
+
+	cfg[n++] = MAKE_GUC_KLV(VF_CFG_BEGIN_CONTEXT_ID);
+	cfg[n++] = 0;
+
+	cfg[n++] = MAKE_GUC_KLV(VF_CFG_NUM_CONTEXTS);
+	cfg[n++] = 0;
+
+	cfg[n++] = MAKE_GUC_KLV(VF_CFG_BEGIN_DOORBELL_ID);
+	cfg[n++] = 0;
+
+	cfg[n++] = MAKE_GUC_KLV(VF_CFG_NUM_DOORBELLS);
+	cfg[n++] = 0;
+
+	return n;
+}
+
+/* space for KLVs of the single VF configuration */
+#define PF_CONFIG_SLOT_SIZE	SZ_512
+
+static int pf_alloc_configs_blob(struct intel_iov *iov, u32 size, struct i915_vma **vma,
+				 void **blob)
+{
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+	if (iov->pf.provisioning.selftest.mock_push_config) {
+		*vma = NULL;
+		*blob = kzalloc(size, GFP_KERNEL);
+		return *blob ? 0 : -ENOMEM;
+	}
+#endif
+
+	return intel_guc_allocate_and_map_vma(iov_to_guc(iov), size, vma, blob);
+}
+
+static void pf_release_configs_blob(struct i915_vma *vma, void *blob)
+{
+	if (vma)
+		i915_vma_unpin_and_release(&vma, I915_VMA_RELEASE_MAP);
+	else
+		kfree(blob);
+}
+
+static int pf_send_configs(struct intel_iov *iov, struct intel_guc_ct_msg *msgs,
+			   unsigned int count, void *blob)
+{
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+	if (iov->pf.provisioning.selftest.mock_push_config) {
+		unsigned int n;
+		u32 vfid;
+		int err;
+
+		for (n = 0; n < count; n++) {
+			vfid = msgs[n].action[1];
+			err = iov->pf.provisioning.selftest.mock_push_config(iov, vfid,
+				blob + (vfid - 1) * PF_CONFIG_SLOT_SIZE, msgs[n].action[4]);
+			if (unlikely(err < 0))
+				return err;
+		}
+		return 0;
+	}
+#endif
+
+	return intel_guc_send_batch(iov_to_guc(iov), msgs, count);
+}
+
 static int pf_push_configs(struct intel_iov *iov, unsigned int num)
 {
 	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
 	struct intel_guc *guc = iov_to_guc(iov);
+	struct intel_guc_ct_msg *msgs;
+	u32 (*requests)[5];
 	struct i915_vma *vma;
-	unsigned int n;
+	unsigned int n, count = 0;
 	u32 cfg_size;
 	u32 cfg_addr;
+	void *blob;
 	u32 *cfg;
 	int err;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 	lockdep_assert_held(pf_provisioning_mutex(iov));
 
-	err = intel_guc_allocate_and_map_vma(guc, SZ_4K, &vma, (void **)&cfg);
-	if (unlikely(err))
-		return err;
+	msgs = kcalloc(num, sizeof(*msgs), GFP_KERNEL);
+	requests = kcalloc(num, sizeof(*requests), GFP_KERNEL);
+	if (!msgs || !requests) {
+		err = -ENOMEM;
+		goto out;
+	}
 
-	cfg_addr = intel_guc_ggtt_offset(guc, vma);
+	err = pf_alloc_configs_blob(iov, num * PF_CONFIG_SLOT_SIZE, &vma, &blob);
+	if (unlikely(err))
+		goto out;
 
 	for (n = 1; n <= num; n++) {
+		cfg = blob + (n - 1) * PF_CONFIG_SLOT_SIZE;
+		cfg_addr = (vma ? intel_guc_ggtt_offset(guc, vma) : 0) +
+			   (n - 1) * PF_CONFIG_SLOT_SIZE;
 		cfg_size = 0;
 
+		/*
+		 * VF that was unprovisioned since its config was pushed, like
+		 * while changes were staged, must release its resources in GuC.
+		 */
 		err = pf_validate_config(iov, n);
 		if (err != -ENODATA)
 			cfg_size = encode_config(cfg, &provisioning->configs[n]);
+		else if (n <= provisioning->num_pushed)
+			cfg_size = encode_config_released(cfg);
 
 		if (iov_to_gt(iov)->type == GT_MEDIA) {
 			struct intel_iov *root = iov_get_root(iov);
@@ -2280,7 +3086,7 @@ static int pf_push_configs(struct intel_iov *iov, unsigned int num)
 			cfg_size += encode_config_ggtt(cfg + cfg_size, config);
 		}
 
-		GEM_BUG_ON(cfg_size * sizeof(u32) > SZ_4K);
+		GEM_BUG_ON(cfg_size * sizeof(u32) > PF_CONFIG_SLOT_SIZE);
 		if (IS_ENABLED(CONFIG_DRM_I915_SELFTEST)) {
 			err = pf_verify_config_klvs(iov, cfg, cfg_size);
 			if (unlikely(err < 0))
@@ -2288,16 +3094,34 @@ static int pf_push_configs(struct intel_iov *iov, unsigned int num)
 		}
 
 		if (cfg_size) {
-			err = guc_action_update_vf_cfg(guc, n, cfg_addr, cfg_size);
-			if (unlikely(err < 0))
-				goto fail;
+			requests[count][0] = GUC_ACTION_PF2GUC_UPDATE_VF_CFG;
+			requests[count][1] = n;
+			requests[count][2] = lower_32_bits(cfg_addr);
+			requests[count][3] = upper_32_bits(cfg_addr);
+			requests[count][4] = cfg_size;
+			msgs[count].action = requests[count];
+			msgs[count].len = ARRAY_SIZE(requests[count]);
+			count++;
 		}
 	}
+
+	/*
+	 * VF configurations are sent as one batch, which the CT layer splits
+	 * into chunks that fit in G2H space, with one H2G doorbell per chunk
+	 */
+	err = pf_send_configs(iov, msgs, count, blob);
+	if (unlikely(err < 0))
+		goto fail;
+
 	err = 0;
 	provisioning->num_pushed = num;
+	provisioning->num_deferred = 0;
 
 fail:
-	i915_vma_unpin_and_release(&vma, I915_VMA_RELEASE_MAP);
+	pf_release_configs_blob(vma, blob);
+out:
+	kfree(requests);
+	kfree(msgs);
 	return err;
 }
 
@@ -2326,7 +3150,8 @@ static int pf_push_no_configs(struct intel_iov *iov)
  * @num: number of configurations to push
  *
  * Push provisioning configs for @num VFs or reset configs for previously
- * configured VFs.
+ * configured VFs. While provisioning changes are staged, configs are pushed
+ * only on intel_iov_provisioning_commit().
  *
  * This function shall be called only on PF.
  *
@@ -2344,10 +3169,17 @@ int intel_iov_provisioning_push(struct intel_iov *iov, unsigned int num)
 		goto fail;
 
 	mutex_lock(pf_provisioning_mutex(iov));
-	if (num)
+	if (num && *pf_staging_flag(iov)) {
+		/* don't push half-staged configs, commit will push them */
+		IOV_DEBUG(iov, "push of %u config(s) deferred until commit\n", num);
+		iov->pf.provisioning.num_deferred = num;
+		err = 0;
+	} else if (num) {
 		err = pf_push_configs(iov, num);
-	else
+	} else {
+		iov->pf.provisioning.num_deferred = 0;
 		err = pf_push_no_configs(iov);
+	}
 	mutex_unlock(pf_provisioning_mutex(iov));
 
 	if (unlikely(err))
@@ -2359,6 +3191,125 @@ fail:
 	return err;
 }
 
+/**
+ * intel_iov_provisioning_stage() - Start staging VF provisioning changes.
+ * @iov: the IOV struct
+ *
+ * Until intel_iov_provisioning_commit() is called, VF provisioning changes
+ * on all GTs are still validated and recorded, but are not pushed to the GuC.
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: 0 on success or -EALREADY if changes are already being staged.
+ */
+int intel_iov_provisioning_stage(struct intel_iov *iov)
+{
+	int err = 0;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	if (*pf_staging_flag(iov))
+		err = -EALREADY;
+	else
+		*pf_staging_flag(iov) = true;
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return err;
+}
+
+static int pf_validate_staged_configs(struct intel_iov *iov, unsigned int num_vfs)
+{
+	unsigned int n;
+
+	for (n = 1; n <= num_vfs; n++) {
+		if (pf_validate_config(iov, n) == -ENOKEY) {
+			IOV_ERROR(iov, "VF%u staged config is incomplete\n", n);
+			return -ENOKEY;
+		}
+	}
+
+	return 0;
+}
+
+static int pf_commit_staged_configs(struct intel_iov *iov)
+{
+	struct intel_iov_provisioning *provisioning;
+	intel_wakeref_t wakeref;
+	struct intel_gt *gt;
+	unsigned int gtid, num;
+	int err, ret = 0;
+
+	lockdep_assert_held(pf_provisioning_mutex(iov));
+
+	if (!*pf_staging_flag(iov))
+		return -EALREADY;
+
+	for_each_gt(gt, iov_to_i915(iov), gtid) {
+		err = pf_validate_staged_configs(&gt->iov, pf_get_numvfs(&gt->iov));
+		if (unlikely(err))
+			return err;
+	}
+
+	*pf_staging_flag(iov) = false;
+
+	for_each_gt(gt, iov_to_i915(iov), gtid) {
+		provisioning = &gt->iov.pf.provisioning;
+		num = max(provisioning->num_pushed, provisioning->num_deferred);
+		if (!num)
+			continue;
+
+		err = -ENONET;
+		with_intel_runtime_pm(gt->uncore->rpm, wakeref)
+			err = pf_push_configs(&gt->iov, num);
+		ret = ret ?: err;
+	}
+
+	return ret;
+}
+
+/**
+ * intel_iov_provisioning_commit() - Commit staged VF provisioning changes.
+ * @iov: the IOV struct
+ *
+ * Validate all VF configurations on all GTs and push them to the GuC, using
+ * a single config update per VF. If validation fails, changes remain staged.
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_provisioning_commit(struct intel_iov *iov)
+{
+	int err;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	err = pf_commit_staged_configs(iov);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	if (unlikely(err && err != -EALREADY))
+		IOV_ERROR(iov, "Failed to commit staged configurations (%pe)\n", ERR_PTR(err));
+
+	return err;
+}
+
+/**
+ * intel_iov_provisioning_is_staging() - Check if VF provisioning is staged.
+ * @iov: the IOV struct
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: true if VF provisioning changes are being staged.
+ */
+bool intel_iov_provisioning_is_staging(struct intel_iov *iov)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	return READ_ONCE(*pf_staging_flag(iov));
+}
+
 /**
  * intel_iov_provisioning_fini - Unprovision all resources.
  * @iov: the IOV struct
@@ -2426,6 +3377,7 @@ static void pf_do_reprovisioning(struct intel_iov *iov)
 	if (!numvfs)
 		return;
 
+	/* while changes are staged, the push is deferred until commit */
 	IOV_DEBUG(iov, "reprovisioning %u VFs\n", numvfs);
 	with_intel_runtime_pm(rpm, wakeref)
 		intel_iov_provisioning_push(iov, numvfs);
@@ -2536,7 +3488,8 @@ int intel_iov_provisioning_print_ggtt(struct intel_iov *iov, struct drm_printer
  * @iov: the IOV struct
  * @p: the DRM printer
  *
- * Print GGTT ranges that are available for the provisioning.
+ * Print GGTT ranges that are available for the provisioning, followed by
+ * the largest range and how fragmented the available space is.
  *
  * This function can only be called on PF.
  */
@@ -2549,7 +3502,8 @@ int intel_iov_provisioning_print_available_ggtt(struct intel_iov *iov, struct dr
 	u64 spare = pf_get_spare_ggtt(iov);
 	u64 hole_min_start = ggtt->pin_bias;
 	u64 hole_start, hole_end, hole_size;
-	u64 avail, total = 0;
+	u64 avail, largest = 0, total = 0;
+	unsigned int fragmentation;
 
 	mutex_lock(&ggtt->vm.mutex);
 
@@ -2560,6 +3514,7 @@ int intel_iov_provisioning_print_available_ggtt(struct intel_iov *iov, struct dr
 		if (hole_start >= hole_end)
 			continue;
 		hole_size = hole_end - hole_start;
+		largest = max(largest, hole_size);
 		total += hole_size;
 
 		drm_printf(p, "range:\t%#08llx-%#08llx\t(%lluK)\n",
@@ -2573,6 +3528,11 @@ int intel_iov_provisioning_print_available_ggtt(struct intel_iov *iov, struct dr
 	drm_printf(p, "total:\t%llu\t(%lluK)\n", total, total / SZ_1K);
 	drm_printf(p, "avail:\t%llu\t(%lluK)\n", avail, avail / SZ_1K);
 
+	/* share of free space that is not part of the largest hole */
+	fragmentation = total ? 100 - div64_u64(largest * 100, total) : 0;
+	drm_printf(p, "largest:\t%llu\t(%lluK)\n", largest, largest / SZ_1K);
+	drm_printf(p, "fragmentation:\t%u%%\n", fragmentation);
+
 	return 0;
 }
 
@@ -2648,6 +3608,116 @@ int intel_iov_provisioning_print_dbs(struct intel_iov *iov, struct drm_printer *
 	return 0;
 }
 
+/**
+ * intel_iov_provisioning_snapshot_size - Size of the provisioning snapshot.
+ * @iov: the IOV struct
+ *
+ * This function can only be called on PF.
+ *
+ * Return: size (in bytes) of the buffer needed by intel_iov_provisioning_snapshot().
+ */
+size_t intel_iov_provisioning_snapshot_size(struct intel_iov *iov)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	return sizeof(struct intel_iov_snapshot_header) +
+	       (1 + pf_get_totalvfs(iov)) * sizeof(struct intel_iov_snapshot_entry);
+}
+
+static void pf_snapshot_entry(struct intel_iov *iov, unsigned int id,
+			      struct intel_iov_snapshot_entry *entry)
+{
+	const struct intel_iov_config *config = &iov->pf.provisioning.configs[id];
+	const struct intel_iov_data *data = iov->pf.state.data ? &iov->pf.state.data[id] : NULL;
+	unsigned int n;
+
+	if (drm_mm_node_allocated(&config->ggtt_region)) {
+		entry->ggtt_start = config->ggtt_region.start;
+		entry->ggtt_size = config->ggtt_region.size;
+	}
+	entry->begin_ctx = config->begin_ctx;
+	entry->num_ctxs = config->num_ctxs;
+	entry->begin_db = config->begin_db;
+	entry->num_dbs = config->num_dbs;
+	entry->exec_quantum = config->exec_quantum;
+	entry->preempt_timeout = config->preempt_timeout;
+
+	for (n = 0; n < IOV_THRESHOLD_MAX; n++) {
+		entry->thresholds[n] = config->thresholds[n];
+		if (data)
+			entry->adverse_events[n] = READ_ONCE(data->adverse_events[n]);
+	}
+
+	if (data)
+		for (n = 0; n < IOV_VF_STAT_MAX; n++)
+			entry->stats[n] = READ_ONCE(data->stats[n]);
+}
+
+/**
+ * intel_iov_provisioning_snapshot - Take a binary snapshot of the provisioning.
+ * @iov: the IOV struct
+ * @buf: the buffer to fill
+ * @size: size of the buffer
+ *
+ * Fill @buf with &intel_iov_snapshot_header followed by one
+ * &intel_iov_snapshot_entry for the PF and for each of the possible VFs.
+ * All data is captured under a single provisioning lock, so the snapshot
+ * is consistent and can be consumed by the monitoring agents with one read.
+ *
+ * This function can only be called on PF.
+ *
+ * Return: number of bytes written on success or a negative error code on failure.
+ */
+ssize_t intel_iov_provisioning_snapshot(struct intel_iov *iov, void *buf, size_t size)
+{
+	struct intel_iov_provisioning *provisioning = &iov->pf.provisioning;
+	struct intel_iov_snapshot_header *header = buf;
+	struct intel_iov_snapshot_entry *entries = buf + sizeof(*header);
+	unsigned int n, total_vfs = pf_get_totalvfs(iov);
+	size_t needed = intel_iov_provisioning_snapshot_size(iov);
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (size < needed)
+		return -ENOSPC;
+
+	if (unlikely(!provisioning->configs))
+		return -ENODATA;
+
+	memset(buf, 0, needed);
+
+	header->magic = IOV_SNAPSHOT_MAGIC;
+	header->version = IOV_SNAPSHOT_VERSION;
+	header->header_size = sizeof(*header);
+	header->entry_size = sizeof(*entries);
+	header->num_entries = 1 + total_vfs;
+	header->gt_id = iov_to_gt(iov)->info.id;
+	header->num_thresholds = IOV_THRESHOLD_MAX;
+	header->num_stats = IOV_VF_STAT_MAX;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	header->num_vfs = pf_get_numvfs(iov);
+	header->num_pushed = provisioning->num_pushed;
+	header->flags = (provisioning->auto_mode ? IOV_SNAPSHOT_FLAG_AUTO_MODE : 0) |
+			(*pf_staging_flag(iov) ? IOV_SNAPSHOT_FLAG_STAGING : 0) |
+			(provisioning->policies.sched_if_idle ? IOV_SNAPSHOT_FLAG_SCHED_IF_IDLE : 0) |
+			(provisioning->policies.reset_engine ? IOV_SNAPSHOT_FLAG_RESET_ENGINE : 0);
+	header->sample_period = provisioning->policies.sample_period;
+	header->spare_ggtt = pf_get_spare_ggtt(iov);
+	header->spare_ctxs = pf_get_spare_ctxs(iov);
+	header->spare_dbs = pf_get_spare_dbs(iov);
+
+	for (n = 0; n <= total_vfs; n++)
+		pf_snapshot_entry(iov, n, &entries[n]);
+
+	header->timestamp = ktime_get_ns();
+
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return needed;
+}
+
 static int pf_push_self_config(struct intel_iov *iov)
 {
 	struct intel_guc *guc = iov_to_guc(iov);
@@ -2706,5 +3776,6 @@ int intel_iov_provisioning_force_vgt_mode(struct intel_iov *iov)
 }
 
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+#include "selftests/selftest_mock_iov_provisioning.c"
 #include "selftests/selftest_live_iov_provisioning.c"
 #endif /* CONFIG_DRM_I915_SELFTEST */
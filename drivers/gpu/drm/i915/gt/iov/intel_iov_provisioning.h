@@ -26,8 +26,15 @@ u32 intel_iov_provisioning_get_sample_period(struct intel_iov *iov);
 
 void intel_iov_provisioning_restart(struct intel_iov *iov);
 int intel_iov_provisioning_auto(struct intel_iov *iov, unsigned int num_vfs);
+int intel_iov_provisioning_set_profile(struct intel_iov *iov, const char *spec);
+int intel_iov_provisioning_select_profile(struct intel_iov *iov, const char *name);
+ssize_t intel_iov_provisioning_show_profile(struct intel_iov *iov, char *buf);
+ssize_t intel_iov_provisioning_show_profiles(struct intel_iov *iov, char *buf);
 int intel_iov_provisioning_verify(struct intel_iov *iov, unsigned int num_vfs);
 int intel_iov_provisioning_push(struct intel_iov *iov, unsigned int num);
+int intel_iov_provisioning_stage(struct intel_iov *iov);
+int intel_iov_provisioning_commit(struct intel_iov *iov);
+bool intel_iov_provisioning_is_staging(struct intel_iov *iov);
 
 int intel_iov_provisioning_set_ggtt(struct intel_iov *iov, unsigned int id, u64 size);
 u64 intel_iov_provisioning_get_ggtt(struct intel_iov *iov, unsigned int id);
@@ -52,6 +59,9 @@ u16 intel_iov_provisioning_query_max_dbs(struct intel_iov *iov);
 
 int intel_iov_provisioning_set_exec_quantum(struct intel_iov *iov, unsigned int id, u32 exec_quantum);
 u32 intel_iov_provisioning_get_exec_quantum(struct intel_iov *iov, unsigned int id);
+u32 intel_iov_provisioning_get_tuned_exec_quantum(struct intel_iov *iov, unsigned int id);
+void intel_iov_provisioning_tune_exec_quanta(struct intel_iov *iov, const u32 *exec_quanta,
+					     unsigned int num_vfs);
 
 int intel_iov_provisioning_set_preempt_timeout(struct intel_iov *iov, unsigned int id, u32 preempt_timeout);
 u32 intel_iov_provisioning_get_preempt_timeout(struct intel_iov *iov, unsigned int id);
@@ -69,6 +79,9 @@ int intel_iov_provisioning_print_dbs(struct intel_iov *iov, struct drm_printer *
 
 int intel_iov_provisioning_print_available_ggtt(struct intel_iov *iov, struct drm_printer *p);
 
+size_t intel_iov_provisioning_snapshot_size(struct intel_iov *iov);
+ssize_t intel_iov_provisioning_snapshot(struct intel_iov *iov, void *buf, size_t size);
+
 int intel_iov_provisioning_force_vgt_mode(struct intel_iov *iov);
 
 #endif /* __INTEL_IOV_PROVISIONING_H__ */
@@ -409,6 +409,14 @@ static int vf_handshake_with_pf(struct intel_iov *iov)
 	if (unlikely(err))
 		goto failed;
 
+	if (unlikely(major != major_wanted || minor > minor_wanted)) {
+		err = -ENOPKG;
+		goto failed;
+	}
+
+	iov->vf.config.iov_abi.major = major;
+	iov->vf.config.iov_abi.minor = minor;
+
 	IOV_DEBUG(iov, "Using ABI %u.%02u\n", major, minor);
 	return 0;
 
@@ -497,6 +505,7 @@ static void vf_cleanup_runtime_info(struct intel_iov *iov)
 	kfree(iov->vf.runtime.regs);
 	iov->vf.runtime.regs = NULL;
 	iov->vf.runtime.regs_size = 0;
+	iov->vf.runtime.generation = 0;
 }
 
 static int vf_prepare_runtime_info(struct intel_iov *iov, unsigned int regs_size,
@@ -514,6 +523,7 @@ static int vf_prepare_runtime_info(struct intel_iov *iov, unsigned int regs_size
 		return -ENOMEM;
 
 	iov->vf.runtime.regs_size = regs_size;
+	iov->vf.runtime.generation = 0;
 
 	return regs_size_up;
 }
@@ -593,11 +603,14 @@ static int vf_handshake_with_pf_mmio(struct intel_iov *iov)
 
 	major = FIELD_GET(VF2PF_MMIO_HANDSHAKE_RESPONSE_MSG_1_MAJOR, response[1]);
 	minor = FIELD_GET(VF2PF_MMIO_HANDSHAKE_RESPONSE_MSG_1_MINOR, response[1]);
-	if (unlikely(major != major_wanted || minor != minor_wanted)) {
+	if (unlikely(major != major_wanted || minor > minor_wanted)) {
 		ret = -ENOPKG;
 		goto failed;
 	}
 
+	iov->vf.config.iov_abi.major = major;
+	iov->vf.config.iov_abi.minor = minor;
+
 	IOV_DEBUG(iov, "Using ABI %u.%02u\n", major, minor);
 	return 0;
 
@@ -637,24 +650,14 @@ static int intel_iov_query_update_ggtt_pte_mmio(struct intel_iov *iov, u32 pte_o
 	return updated;
 }
 
-static int intel_iov_query_update_ggtt_pte_relay(struct intel_iov *iov, u32 pte_offset, u8 mode,
-						 u16 num_copies, gen8_pte_t *ptes, u16 count)
+static u32 prepare_update_ggtt_request(u32 *request, u32 pte_offset, u8 mode,
+				       u16 num_copies, const gen8_pte_t *ptes, u16 count)
 {
-	struct drm_i915_private *i915 = iov_to_i915(iov);
-	u32 request[VF2PF_UPDATE_GGTT32_REQUEST_MSG_MAX_LEN];
-	u32 response[VF2PF_UPDATE_GGTT32_RESPONSE_MSG_LEN];
-	u16 expected = num_copies + count;
-	u16 updated;
 	int i;
-	int ret;
 
-	GEM_BUG_ON(!intel_iov_is_vf(iov));
 	GEM_BUG_ON(FIELD_MAX(VF2PF_UPDATE_GGTT32_REQUEST_MSG_1_MODE) < mode);
 	GEM_BUG_ON(FIELD_MAX(VF2PF_UPDATE_GGTT32_REQUEST_MSG_1_NUM_COPIES) < num_copies);
-	assert_rpm_wakelock_held(&i915->runtime_pm);
-
-	if (count < 1)
-		return -EINVAL;
+	GEM_BUG_ON(count > VF2PF_UPDATE_GGTT_MAX_PTES);
 
 	request[0] = FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
 		     FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_REQUEST) |
@@ -671,8 +674,62 @@ static int intel_iov_query_update_ggtt_pte_relay(struct intel_iov *iov, u32 pte_
 						upper_32_bits(ptes[i]));
 	}
 
+	return count * 2 + 2;
+}
+
+static u32 prepare_update_ggtt_ranges_request(u32 *request, u32 pte_offset,
+					      const struct intel_iov_ggtt_range *ranges,
+					      u16 num_ranges)
+{
+	u32 *range = &request[2];
+	int i;
+
+	GEM_BUG_ON(!num_ranges);
+	GEM_BUG_ON(num_ranges > VF2PF_UPDATE_GGTT_MAX_RANGES);
+
+	request[0] = FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		     FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_REQUEST) |
+		     FIELD_PREP(GUC_HXG_REQUEST_MSG_0_ACTION, IOV_ACTION_VF2PF_UPDATE_GGTT_RANGES);
+
+	request[1] = FIELD_PREP(VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_1_OFFSET, pte_offset);
+
+	for (i = 0; i < num_ranges; i++, range += VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN) {
+		GEM_BUG_ON(!ranges[i].count);
+
+		range[0] = FIELD_PREP(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_PTE_LO,
+				      lower_32_bits(ranges[i].pte));
+		range[1] = FIELD_PREP(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_PTE_HI,
+				      upper_32_bits(ranges[i].pte));
+		range[2] = FIELD_PREP(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_COUNT,
+				      ranges[i].count) |
+			   FIELD_PREP(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_INCREMENT,
+				      ranges[i].increment);
+	}
+
+	return num_ranges * VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN + 2;
+}
+
+static int intel_iov_query_update_ggtt_pte_relay(struct intel_iov *iov, u32 pte_offset, u8 mode,
+						 u16 num_copies, gen8_pte_t *ptes, u16 count)
+{
+	struct drm_i915_private *i915 = iov_to_i915(iov);
+	u32 request[VF2PF_UPDATE_GGTT32_REQUEST_MSG_MAX_LEN];
+	u32 response[VF2PF_UPDATE_GGTT32_RESPONSE_MSG_LEN];
+	u16 expected = num_copies + count;
+	u16 updated;
+	u32 len;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	assert_rpm_wakelock_held(&i915->runtime_pm);
+
+	if (count < 1)
+		return -EINVAL;
+
+	len = prepare_update_ggtt_request(request, pte_offset, mode, num_copies, ptes, count);
+
 	ret = intel_iov_relay_send_to_pf(&iov->relay,
-					 request, count * 2 + 2,
+					 request, len,
 					 response, ARRAY_SIZE(response));
 	if (unlikely(ret < 0))
 		return ret;
@@ -682,19 +739,8 @@ static int intel_iov_query_update_ggtt_pte_relay(struct intel_iov *iov, u32 pte_
 	return updated;
 }
 
-/**
- * intel_iov_query_update_ggtt_ptes - Send buffered PTEs to PF to update GGTT
- * @iov: the IOV struct
- *
- * This function is for VF use only.
- *
- * Return: Number of successfully updated PTEs on success or a negative error code on failure.
- */
-int intel_iov_query_update_ggtt_ptes(struct intel_iov *iov)
+static void vf_sanitize_ptes_buffer_mode(struct intel_iov_vf_ggtt_ptes *buffer)
 {
-	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
-	int ret;
-
 	BUILD_BUG_ON(MMIO_UPDATE_GGTT_MODE_DUPLICATE != VF2PF_UPDATE_GGTT32_MODE_DUPLICATE);
 	BUILD_BUG_ON(MMIO_UPDATE_GGTT_MODE_REPLICATE != VF2PF_UPDATE_GGTT32_MODE_REPLICATE);
 	BUILD_BUG_ON(MMIO_UPDATE_GGTT_MODE_DUPLICATE_LAST !=
@@ -702,7 +748,6 @@ int intel_iov_query_update_ggtt_ptes(struct intel_iov *iov)
 	BUILD_BUG_ON(MMIO_UPDATE_GGTT_MODE_REPLICATE_LAST !=
 		     VF2PF_UPDATE_GGTT32_MODE_REPLICATE_LAST);
 
-	GEM_BUG_ON(!intel_iov_is_vf(iov));
 	GEM_BUG_ON(buffer->mode == VF_RELAY_UPDATE_GGTT_MODE_INVALID && buffer->num_copies);
 
 	/*
@@ -714,6 +759,24 @@ int intel_iov_query_update_ggtt_ptes(struct intel_iov *iov)
 	 */
 	if (buffer->mode == VF_RELAY_UPDATE_GGTT_MODE_INVALID && !buffer->num_copies)
 		buffer->mode = 0;
+}
+
+/**
+ * intel_iov_query_update_ggtt_ptes - Send buffered PTEs to PF to update GGTT
+ * @iov: the IOV struct
+ *
+ * This function is for VF use only.
+ *
+ * Return: Number of successfully updated PTEs on success or a negative error code on failure.
+ */
+int intel_iov_query_update_ggtt_ptes(struct intel_iov *iov)
+{
+	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+
+	vf_sanitize_ptes_buffer_mode(buffer);
 
 	if (!intel_guc_ct_enabled(&iov_to_guc(iov)->ct))
 		ret = intel_iov_query_update_ggtt_pte_mmio(iov, buffer->offset, buffer->mode,
@@ -728,6 +791,86 @@ int intel_iov_query_update_ggtt_ptes(struct intel_iov *iov)
 	return ret;
 }
 
+/**
+ * intel_iov_query_update_ggtt_ptes_submit - Send buffered PTEs to PF without waiting
+ * @iov: the IOV struct
+ * @inflight: placeholder used to track the request until it is completed
+ *
+ * Encodes buffered PTEs into the @inflight request and sends it to the PF over
+ * the GuC relay. Successfully submitted request must be later completed with
+ * intel_iov_query_update_ggtt_ptes_wait().
+ *
+ * This function is for VF use only and requires CTB to be enabled.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_query_update_ggtt_ptes_submit(struct intel_iov *iov,
+					    struct intel_iov_vf_ggtt_inflight *inflight)
+{
+	struct intel_iov_vf_ggtt_ptes *buffer = &iov->vf.ptes_buffer;
+	u32 len;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	GEM_BUG_ON(!intel_guc_ct_enabled(&iov_to_guc(iov)->ct));
+	assert_rpm_wakelock_held(&iov_to_i915(iov)->runtime_pm);
+
+	if (buffer->num_ranges) {
+		GEM_BUG_ON(buffer->count);
+		len = prepare_update_ggtt_ranges_request(inflight->request, buffer->offset,
+							 buffer->ranges, buffer->num_ranges);
+		inflight->expected = buffer->num_range_ptes;
+	} else if (buffer->count) {
+		vf_sanitize_ptes_buffer_mode(buffer);
+		len = prepare_update_ggtt_request(inflight->request, buffer->offset,
+						  buffer->mode, buffer->num_copies,
+						  buffer->ptes, buffer->count);
+		inflight->expected = buffer->num_copies + buffer->count;
+	} else {
+		return -EINVAL;
+	}
+
+	ret = intel_iov_relay_submit_to_pf(&iov->relay, &inflight->pending,
+					   inflight->request, len,
+					   inflight->response, ARRAY_SIZE(inflight->response));
+	if (unlikely(ret < 0))
+		IOV_ERROR(iov, "Failed to update VFs PTE by PF (%pe)\n", ERR_PTR(ret));
+
+	return ret;
+}
+
+/**
+ * intel_iov_query_update_ggtt_ptes_wait - Wait for PF to ack submitted PTEs
+ * @iov: the IOV struct
+ * @inflight: request submitted with intel_iov_query_update_ggtt_ptes_submit()
+ *
+ * This function is for VF use only.
+ *
+ * Return: Number of successfully updated PTEs on success or a negative error code on failure.
+ */
+int intel_iov_query_update_ggtt_ptes_wait(struct intel_iov *iov,
+					  struct intel_iov_vf_ggtt_inflight *inflight)
+{
+	u32 updated;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	BUILD_BUG_ON(VF2PF_UPDATE_GGTT32_RESPONSE_MSG_0_NUM_PTES !=
+		     VF2PF_UPDATE_GGTT_RANGES_RESPONSE_MSG_0_NUM_PTES);
+	BUILD_BUG_ON(VF2PF_UPDATE_GGTT32_REQUEST_MSG_MAX_LEN <
+		     VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_MAX_LEN);
+
+	ret = intel_iov_relay_wait_for_pf(&iov->relay, &inflight->pending);
+	if (unlikely(ret < 0)) {
+		IOV_ERROR(iov, "Failed to update VFs PTE by PF (%pe)\n", ERR_PTR(ret));
+		return ret;
+	}
+
+	updated = FIELD_GET(VF2PF_UPDATE_GGTT32_RESPONSE_MSG_0_NUM_PTES, inflight->response[0]);
+	WARN_ON(updated != inflight->expected);
+	return updated;
+}
+
 static int vf_get_runtime_info_mmio(struct intel_iov *iov)
 {
 	u32 request[VF2GUC_MMIO_RELAY_SERVICE_REQUEST_MSG_MAX_LEN];
@@ -868,6 +1011,89 @@ failed:
 	return ret;
 }
 
+static bool abi_supports_runtime_snapshot(struct intel_iov *iov)
+{
+	struct intel_iov_vf_config *config = &iov->vf.config;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+
+	/* version 1.2+ is required to use VF2PF_QUERY_RUNTIME_SNAPSHOT */
+	return config->iov_abi.major > 1 ||
+	       (config->iov_abi.major == 1 && config->iov_abi.minor >= 2);
+}
+
+static int vf_get_runtime_snapshot_relay(struct intel_iov *iov)
+{
+	struct drm_i915_private *i915 = iov_to_i915(iov);
+	u32 request[VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_LEN];
+	u32 generation, count, num, i;
+	u32 *response;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_vf(iov));
+	assert_rpm_wakelock_held(&i915->runtime_pm);
+
+	response = kmalloc_array(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MAX_LEN,
+				 sizeof(u32), GFP_KERNEL);
+	if (!response)
+		return -ENOMEM;
+
+	request[0] = FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		     FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_REQUEST) |
+		     FIELD_PREP(GUC_HXG_REQUEST_MSG_0_ACTION,
+				IOV_ACTION_VF2PF_QUERY_RUNTIME_SNAPSHOT);
+	request[1] = FIELD_PREP(VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_1_GENERATION,
+				iov->vf.runtime.generation);
+
+	ret = intel_iov_relay_send_to_pf(&iov->relay,
+					 request, ARRAY_SIZE(request), response,
+					 VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MAX_LEN);
+	if (unlikely(ret < 0))
+		goto out;
+
+	if (unlikely(ret < VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN ||
+		     (ret - VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN) % 2)) {
+		ret = -EPROTO;
+		goto out;
+	}
+
+	num = (ret - VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN) / 2;
+	count = FIELD_GET(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_0_COUNT, response[0]);
+	generation = FIELD_GET(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_1_GENERATION,
+			       response[1]);
+
+	IOV_DEBUG(iov, "count=%u num=%u generation=%#x cached=%#x\n",
+		  count, num, generation, iov->vf.runtime.generation);
+
+	if (unlikely(count != num || !generation)) {
+		ret = -EPROTO;
+		goto out;
+	}
+
+	if (!count) {
+		/* our cached copy is still current */
+		ret = generation == iov->vf.runtime.generation ? 0 : -EPROTO;
+		goto out;
+	}
+
+	ret = vf_prepare_runtime_info(iov, count, 1);
+	if (unlikely(ret < 0))
+		goto out;
+
+	for (i = 0; i < count; i++) {
+		struct vf_runtime_reg *reg = &iov->vf.runtime.regs[i];
+
+		reg->offset = response[VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN + 2 * i];
+		reg->value = response[VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN + 2 * i + 1];
+	}
+	iov->vf.runtime.generation = generation;
+	ret = 0;
+
+out:
+	kfree(response);
+	return ret;
+}
+
 /**
  * intel_iov_query_runtime - Query IOV runtime data.
  * @iov: the IOV struct
@@ -889,10 +1115,15 @@ int intel_iov_query_runtime(struct intel_iov *iov, bool early)
 			goto failed;
 	}
 
-	if (early)
+	if (early) {
 		err = vf_get_runtime_info_mmio(iov);
-	else
-		err = vf_get_runtime_info_relay(iov);
+	} else {
+		err = -EOPNOTSUPP;
+		if (abi_supports_runtime_snapshot(iov))
+			err = vf_get_runtime_snapshot_relay(iov);
+		if (err)
+			err = vf_get_runtime_info_relay(iov);
+	}
 	if (unlikely(err))
 		goto failed;
 
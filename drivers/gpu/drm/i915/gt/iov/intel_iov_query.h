@@ -10,12 +10,17 @@
 
 struct drm_printer;
 struct intel_iov;
+struct intel_iov_vf_ggtt_inflight;
 
 int intel_iov_query_bootstrap(struct intel_iov *iov);
 int intel_iov_query_config(struct intel_iov *iov);
 int intel_iov_query_version(struct intel_iov *iov);
 int intel_iov_query_runtime(struct intel_iov *iov, bool early);
 int intel_iov_query_update_ggtt_ptes(struct intel_iov *iov);
+int intel_iov_query_update_ggtt_ptes_submit(struct intel_iov *iov,
+					    struct intel_iov_vf_ggtt_inflight *inflight);
+int intel_iov_query_update_ggtt_ptes_wait(struct intel_iov *iov,
+					  struct intel_iov_vf_ggtt_inflight *inflight);
 void intel_iov_query_fini(struct intel_iov *iov);
 
 void intel_iov_query_print_config(struct intel_iov *iov, struct drm_printer *p);
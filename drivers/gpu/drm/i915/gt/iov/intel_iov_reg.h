@@ -10,6 +10,7 @@
 #define I915_VF_IRQ_STATUS 0x0
 /* IIR */
 #define I915_VF_IRQ_SOURCE 0x400
+#define I915_VF_IRQ_SOURCE_COUNT 64
 /* IMR */
 #define I915_VF_IRQ_ENABLE 0x440
 
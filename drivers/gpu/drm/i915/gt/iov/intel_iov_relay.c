@@ -4,6 +4,7 @@
  */
 
 #include <linux/bitfield.h>
+#include <linux/wait_bit.h>
 
 #include "abi/iov_actions_abi.h"
 #include "abi/iov_actions_selftest_abi.h"
@@ -70,23 +71,21 @@ static u32 relay_get_next_fence(struct intel_iov_relay *relay)
 {
 	u32 fence;
 
-	spin_lock(&relay->lock);
-	fence = ++relay->last_fence;
-	if (unlikely(!fence))
-		fence = relay->last_fence = 1;
-	spin_unlock(&relay->lock);
+	do {
+		fence = atomic_inc_return(&relay->last_fence);
+	} while (unlikely(!fence));
+
 	return fence;
 }
 
-struct pending_relay {
-	struct list_head link;
-	struct completion done;
-	u32 target;
-	u32 fence;
-	int reply;
-	u32 *response; /* can't be null */
-	u32 response_size;
-};
+/*
+ * Both -EAGAIN and -EBUSY replies keep the request pending, the requester
+ * will either resend it or continue waiting for the final response.
+ */
+static bool relay_reply_is_final(int reply)
+{
+	return reply != -EAGAIN && reply != -EBUSY;
+}
 
 static int pf_relay_send(struct intel_iov_relay *relay, u32 target,
 			 u32 relay_id, const u32 *msg, u32 len)
@@ -324,81 +323,141 @@ int intel_iov_relay_reply_error_to_vf(struct intel_iov_relay *relay, u32 target,
 				 sanitize_iov_error_hint(hint));
 }
 
-static int relay_send_and_wait(struct intel_iov_relay *relay, u32 target,
-			       u32 relay_id, const u32 *msg, u32 len,
-			       u32 *buf, u32 buf_size)
+static void relay_unlink(struct intel_iov_relay *relay,
+			 struct intel_iov_relay_pending *pending, int ret)
+{
+	const u32 *msg = pending->msg;
+
+	/*
+	 * Reply handler looks up pending requests under RCU only. If we were
+	 * the one who removed the request then wait until any concurrent
+	 * lookup is done, otherwise the handler already claimed the request
+	 * and we must wait until it marks the request as final, which is its
+	 * last access to the request.
+	 */
+	if (xa_erase(&relay->pending_relays, pending->fence))
+		synchronize_rcu();
+	else
+		wait_var_event(pending, smp_load_acquire(&pending->final));
+
+	if (unlikely(ret < 0)) {
+		RELAY_PROBE_ERROR(relay, "Unsuccessful %s.%u %#x:%u to %u (%pe) %*ph\n",
+				  hxg_type_to_string(FIELD_GET(GUC_HXG_MSG_0_TYPE, msg[0])),
+				  pending->fence,
+				  FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, msg[0]),
+				  FIELD_GET(GUC_HXG_REQUEST_MSG_0_DATA0, msg[0]),
+				  pending->target, ERR_PTR(ret), 4 * pending->len, msg);
+	}
+}
+
+static int relay_submit(struct intel_iov_relay *relay,
+			struct intel_iov_relay_pending *pending, u32 target,
+			u32 relay_id, const u32 *msg, u32 len,
+			u32 *buf, u32 buf_size)
 {
-	unsigned long timeout = msecs_to_jiffies(RELAY_TIMEOUT);
-	u32 action;
-	u32 data0;
-	struct pending_relay pending;
 	int ret;
-	long n;
 
 	GEM_BUG_ON(!len);
 	GEM_BUG_ON(FIELD_GET(GUC_HXG_MSG_0_ORIGIN, msg[0]) != GUC_HXG_ORIGIN_HOST);
 	GEM_BUG_ON(FIELD_GET(GUC_HXG_MSG_0_TYPE, msg[0]) != GUC_HXG_TYPE_REQUEST);
 
-	action = FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, msg[0]);
-	data0 = FIELD_GET(GUC_HXG_REQUEST_MSG_0_DATA0, msg[0]);
 	RELAY_DEBUG(relay, "%s.%u to %u action %#x:%u\n",
 		    hxg_type_to_string(FIELD_GET(GUC_HXG_MSG_0_TYPE, msg[0])),
-		    relay_id, target, action, data0);
-
-	init_completion(&pending.done);
-	pending.target = target;
-	pending.fence = relay_id;
-	pending.reply = -ENOMSG;
-	pending.response = buf;
-	pending.response_size = buf_size;
-
-	/* list ordering does not need to match fence ordering */
-	spin_lock(&relay->lock);
-	list_add_tail(&pending.link, &relay->pending_relays);
-	spin_unlock(&relay->lock);
+		    relay_id, target,
+		    FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, msg[0]),
+		    FIELD_GET(GUC_HXG_REQUEST_MSG_0_DATA0, msg[0]));
+
+	pending->replies = 0;
+	pending->final = false;
+	pending->target = target;
+	pending->fence = relay_id;
+	pending->reply = -ENOMSG;
+	pending->response = buf;
+	pending->response_size = buf_size;
+	pending->msg = msg;
+	pending->len = len;
+
+	ret = xa_insert(&relay->pending_relays, relay_id, pending, GFP_KERNEL);
+	if (unlikely(ret)) {
+		RELAY_ERROR(relay, "Failed to track %u.%u (%pe)\n", target, relay_id, ERR_PTR(ret));
+		return ret;
+	}
 
-retry:
 	ret = relay_send(relay, target, relay_id, msg, len);
 	if (unlikely(ret < 0))
-		goto unlink;
+		relay_unlink(relay, pending, ret);
+
+	return ret;
+}
+
+static int relay_wait(struct intel_iov_relay *relay,
+		      struct intel_iov_relay_pending *pending)
+{
+	unsigned long timeout = msecs_to_jiffies(RELAY_TIMEOUT);
+	u32 buf_size = pending->response_size;
+	u32 target = pending->target;
+	u32 relay_id = pending->fence;
+	unsigned int replies = 0;
+	int ret;
+	long n;
 
+	/*
+	 * Each non-final reply bumps the reply counter, so none of them can
+	 * be missed, and the final reply can't be overwritten by a stale one.
+	 */
 wait:
-	n = wait_for_completion_timeout(&pending.done, timeout);
+	n = wait_var_event_timeout(pending,
+				   smp_load_acquire(&pending->final) ||
+				   smp_load_acquire(&pending->replies) != replies,
+				   timeout);
 	RELAY_DEBUG(relay, "%u.%u wait n=%ld\n", target, relay_id, n);
 	if (unlikely(n == 0)) {
 		ret = -ETIME;
 		goto unlink;
 	}
 
-	RELAY_DEBUG(relay, "%u.%u reply=%d\n", target, relay_id, pending.reply);
-	if (unlikely(pending.reply != 0)) {
-		reinit_completion(&pending.done);
-		ret = pending.reply;
-		if (ret == -EAGAIN)
-			goto retry;
-		if (ret == -EBUSY)
-			goto wait;
+	if (unlikely(!smp_load_acquire(&pending->final))) {
+		replies = smp_load_acquire(&pending->replies);
+		ret = READ_ONCE(pending->reply);
+		RELAY_DEBUG(relay, "%u.%u reply=%d\n", target, relay_id, ret);
+		if (ret == -EAGAIN) {
+			ret = relay_send(relay, target, relay_id, pending->msg, pending->len);
+			if (unlikely(ret < 0))
+				goto unlink;
+		}
+		goto wait;
+	}
+
+	RELAY_DEBUG(relay, "%u.%u reply=%d\n", target, relay_id, pending->reply);
+	if (unlikely(pending->reply != 0)) {
+		ret = pending->reply;
 		if (ret > 0)
 			ret = -ret;
 		goto unlink;
 	}
 
-	GEM_BUG_ON(pending.response_size > buf_size);
-	ret = pending.response_size;
-	RELAY_DEBUG(relay, "%u.%u response %*ph\n", target, relay_id, 4 * ret, buf);
+	GEM_BUG_ON(pending->response_size > buf_size);
+	ret = pending->response_size;
+	RELAY_DEBUG(relay, "%u.%u response %*ph\n", target, relay_id, 4 * ret,
+		    pending->response);
 
 unlink:
-	spin_lock(&relay->lock);
-	list_del(&pending.link);
-	spin_unlock(&relay->lock);
+	relay_unlink(relay, pending, ret);
+	return ret;
+}
 
-	if (unlikely(ret < 0)) {
-		RELAY_PROBE_ERROR(relay, "Unsuccessful %s.%u %#x:%u to %u (%pe) %*ph\n",
-				  hxg_type_to_string(FIELD_GET(GUC_HXG_MSG_0_TYPE, msg[0])),
-				  relay_id, action, data0, target, ERR_PTR(ret), 4 * len, msg);
-	}
+static int relay_send_and_wait(struct intel_iov_relay *relay, u32 target,
+			       u32 relay_id, const u32 *msg, u32 len,
+			       u32 *buf, u32 buf_size)
+{
+	struct intel_iov_relay_pending pending;
+	int ret;
 
-	return ret;
+	ret = relay_submit(relay, &pending, target, relay_id, msg, len, buf, buf_size);
+	if (unlikely(ret < 0))
+		return ret;
+
+	return relay_wait(relay, &pending);
 }
 
 /**
@@ -475,36 +534,104 @@ int intel_iov_relay_send_to_pf(struct intel_iov_relay *relay,
 	return relay_send_and_wait(relay, 0, relay_id, msg, len, buf, buf_size);
 }
 
+/**
+ * intel_iov_relay_submit_to_pf - Send request message to PF without waiting.
+ * @relay: the Relay struct
+ * @pending: placeholder used to track the request until it is completed
+ * @msg: request message (must remain valid until request is completed)
+ * @len: length of the message (in dwords, can't be 0)
+ * @buf: placeholder for the response message
+ * @buf_size: size of the response message placeholder (in dwords)
+ *
+ * This function embeds provided `IOV Message`_ into GuC relay but, unlike
+ * intel_iov_relay_send_to_pf(), it does not wait for the response.
+ * Each successfully submitted request must be completed with a call to
+ * intel_iov_relay_wait_for_pf(), which allows to keep several requests
+ * in flight at the same time.
+ *
+ * This function can only be used by driver running in SR-IOV VF mode.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_relay_submit_to_pf(struct intel_iov_relay *relay,
+				 struct intel_iov_relay_pending *pending,
+				 const u32 *msg, u32 len, u32 *buf, u32 buf_size)
+{
+	GEM_BUG_ON(!IS_SRIOV_VF(relay_to_i915(relay)) &&
+		   !I915_SELFTEST_ONLY(relay->selftest.disable_strict));
+	GEM_BUG_ON(len < GUC_HXG_MSG_MIN_LEN);
+	GEM_BUG_ON(FIELD_GET(GUC_HXG_MSG_0_TYPE, msg[0]) != GUC_HXG_TYPE_REQUEST);
+
+	return relay_submit(relay, pending, 0, relay_get_next_fence(relay),
+			    msg, len, buf, buf_size);
+}
+
+/**
+ * intel_iov_relay_wait_for_pf - Wait for response to the submitted request.
+ * @relay: the Relay struct
+ * @pending: request tracking data used in intel_iov_relay_submit_to_pf()
+ *
+ * This function can only be used by driver running in SR-IOV VF mode.
+ *
+ * Return: Non-negative response length (in dwords) or
+ *         a negative error code on failure.
+ */
+int intel_iov_relay_wait_for_pf(struct intel_iov_relay *relay,
+				struct intel_iov_relay_pending *pending)
+{
+	GEM_BUG_ON(!IS_SRIOV_VF(relay_to_i915(relay)) &&
+		   !I915_SELFTEST_ONLY(relay->selftest.disable_strict));
+	GEM_BUG_ON(pending->target);
+
+	return relay_wait(relay, pending);
+}
+
 static int relay_handle_reply(struct intel_iov_relay *relay, u32 origin,
 			      u32 relay_id, int reply, const u32 *msg, u32 len)
 {
-	struct pending_relay *pending;
-	int err = -ESRCH;
+	struct intel_iov_relay_pending *pending;
+	int err = 0;
 
-	spin_lock(&relay->lock);
-	list_for_each_entry(pending, &relay->pending_relays, link) {
-		if (pending->target != origin || pending->fence != relay_id) {
-			RELAY_DEBUG(relay, "%u.%u still awaits response\n",
-				    pending->target, pending->fence);
-			continue;
-		}
-		err = 0;
-		if (reply == 0) {
-			if (unlikely(len > pending->response_size)) {
-				reply = -ENOBUFS;
-				err = -ENOBUFS;
-			} else {
-				pending->response[0] = FIELD_GET(GUC_HXG_RESPONSE_MSG_0_DATA0, msg[0]);
-				memcpy(pending->response + 1, msg + 1, 4 * (len - 1));
-				pending->response_size = len;
-			}
+	rcu_read_lock();
+
+	pending = xa_load(&relay->pending_relays, relay_id);
+	if (unlikely(!pending || pending->target != origin)) {
+		RELAY_DEBUG(relay, "%u.%u is not awaiting response\n", origin, relay_id);
+		err = -ESRCH;
+		goto unlock;
+	}
+
+	/* claim final response, requester will not wait for RCU then */
+	if (relay_reply_is_final(reply) &&
+	    xa_cmpxchg(&relay->pending_relays, relay_id, pending, NULL, 0) != pending) {
+		RELAY_DEBUG(relay, "%u.%u is no longer awaiting response\n", origin, relay_id);
+		err = -ESRCH;
+		goto unlock;
+	}
+
+	if (reply == 0) {
+		if (unlikely(len > pending->response_size)) {
+			reply = -ENOBUFS;
+			err = -ENOBUFS;
+		} else {
+			pending->response[0] = FIELD_GET(GUC_HXG_RESPONSE_MSG_0_DATA0, msg[0]);
+			memcpy(pending->response + 1, msg + 1, 4 * (len - 1));
+			pending->response_size = len;
 		}
-		pending->reply = reply;
-		complete_all(&pending->done);
-		break;
 	}
-	spin_unlock(&relay->lock);
 
+	WRITE_ONCE(pending->reply, reply);
+	if (relay_reply_is_final(reply))
+		smp_store_release(&pending->final, true); /* last access to claimed request */
+	else
+		smp_store_release(&pending->replies, pending->replies + 1);
+
+	/* pairs with wait_var_event() in relay_wait() and relay_unlink() */
+	smp_mb();
+	wake_up_var(pending);
+
+unlock:
+	rcu_read_unlock();
 	return err;
 }
 
@@ -10,8 +10,13 @@
 
 static inline void intel_iov_relay_init_early(struct intel_iov_relay *relay)
 {
-	spin_lock_init(&relay->lock);
-	INIT_LIST_HEAD(&relay->pending_relays);
+	xa_init(&relay->pending_relays);
+	atomic_set(&relay->last_fence, 0);
+}
+
+static inline void intel_iov_relay_release(struct intel_iov_relay *relay)
+{
+	xa_destroy(&relay->pending_relays);
 }
 
 int intel_iov_relay_send_to_vf(struct intel_iov_relay *relay, u32 target,
@@ -27,6 +32,11 @@ int intel_iov_relay_reply_error_to_vf(struct intel_iov_relay *relay, u32 target,
 
 int intel_iov_relay_send_to_pf(struct intel_iov_relay *relay,
 			       const u32 *msg, u32 len, u32 *buf, u32 buf_size);
+int intel_iov_relay_submit_to_pf(struct intel_iov_relay *relay,
+				 struct intel_iov_relay_pending *pending,
+				 const u32 *msg, u32 len, u32 *buf, u32 buf_size);
+int intel_iov_relay_wait_for_pf(struct intel_iov_relay *relay,
+				struct intel_iov_relay_pending *pending);
 
 int intel_iov_relay_process_guc2pf(struct intel_iov_relay *relay,
 				   const u32 *msg, u32 len);
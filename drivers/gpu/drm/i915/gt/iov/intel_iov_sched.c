@@ -0,0 +1,488 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright © 2024 Intel Corporation
+ */
+
+#include <linux/iosys-map.h>
+
+#include "intel_iov.h"
+#include "intel_iov_provisioning.h"
+#include "intel_iov_sched.h"
+#include "intel_iov_utils.h"
+#include "gt/intel_gt.h"
+#include "gt/intel_gt_pm.h"
+#include "gt/uc/intel_guc_ads.h"
+#include "gt/uc/intel_guc_fwif.h"
+
+/*
+ * The scheduling controller periodically samples which context the GuC is
+ * running on each engine, attributes it to the VF owning that context ID,
+ * and at the end of each period adjusts execution quanta of the controlled
+ * VFs towards their target share of the engines time:
+ *
+ *  - idle VFs are given their minimal execution quantum, so they don't hold
+ *    back busy VFs when time-slicing,
+ *  - busy VFs that got less than their target share get longer execution
+ *    quantum, those that got more get shorter one.
+ *
+ * The period follows the 'sample_period' policy, if set. The controller
+ * stays idle while no VFs are enabled.
+ */
+
+#define IOV_SCHED_TICK_MS		10
+#define IOV_SCHED_DEFAULT_PERIOD_MS	100
+#define IOV_SCHED_MIN_EXEC_QUANTUM	1
+
+static unsigned int pf_sched_ctx_owner(struct intel_iov *iov, u32 ctx_id)
+{
+	const struct intel_iov_sched_vf *vfs = iov->pf.sched.vfs;
+	unsigned int n, num_vfs = pf_get_numvfs(iov);
+
+	for (n = VFID(1); n <= num_vfs; n++)
+		if (ctx_id - (u32)vfs[n].begin_ctx < vfs[n].num_ctxs)
+			return n;
+
+	return PFID;
+}
+
+static void pf_sched_sample(struct intel_iov *iov)
+{
+	struct intel_iov_sched *sched = &iov->pf.sched;
+	struct intel_gt *gt = iov_to_gt(iov);
+	struct intel_engine_cs *engine;
+	enum intel_engine_id id;
+	unsigned int vfid;
+	u32 ctx_id;
+
+	/* parked GT means all engines are idle */
+	if (!intel_gt_pm_get_if_awake(gt)) {
+		sched->samples += gt->info.num_engines;
+		return;
+	}
+
+	for_each_engine(engine, gt, id) {
+		struct iosys_map map = intel_guc_engine_usage_record_map(engine);
+
+		sched->samples++;
+
+		ctx_id = iosys_map_rd_field(&map, 0, struct guc_engine_usage_record,
+					    current_context_index);
+		if (ctx_id == ~0U)
+			continue;
+
+		vfid = pf_sched_ctx_owner(iov, ctx_id);
+		if (vfid != PFID)
+			sched->vfs[vfid].busy++;
+	}
+
+	intel_gt_pm_put_async(gt);
+}
+
+/*
+ * Scale current execution quantum by the ratio of the target share to the
+ * measured busyness, but move only half way there to damp oscillations.
+ */
+static u32 sched_next_exec_quantum(u32 exec_quantum, u32 busyness, u32 target,
+				   u32 min_exec_quantum, u32 max_exec_quantum)
+{
+	u64 next;
+
+	GEM_BUG_ON(min_exec_quantum > max_exec_quantum);
+
+	if (!busyness)
+		return min_exec_quantum;
+
+	/* 0 means infinite execution quantum */
+	if (!exec_quantum)
+		exec_quantum = max_exec_quantum;
+	exec_quantum = clamp(exec_quantum, min_exec_quantum, max_exec_quantum);
+
+	next = div_u64((u64)exec_quantum * target, busyness);
+	next = (next + exec_quantum) / 2;
+
+	return clamp_t(u64, next, min_exec_quantum, max_exec_quantum);
+}
+
+static void pf_sched_adjust(struct intel_iov *iov)
+{
+	struct intel_iov_sched *sched = &iov->pf.sched;
+	unsigned int n, num_vfs = pf_get_numvfs(iov);
+	unsigned int num_busy = 0;
+	u32 min_eq, max_eq, target;
+	u32 *exec_quanta;
+
+	if (!num_vfs)
+		return;
+
+	for (n = VFID(1); n <= num_vfs; n++) {
+		struct intel_iov_sched_vf *vf = &sched->vfs[n];
+
+		vf->busyness = sched->samples ? vf->busy * 100 / sched->samples : 0;
+		if (vf->busyness && READ_ONCE(vf->max_exec_quantum))
+			num_busy++;
+	}
+
+	exec_quanta = kcalloc(1 + num_vfs, sizeof(*exec_quanta), GFP_KERNEL);
+	if (unlikely(!exec_quanta))
+		return;
+
+	for (n = VFID(1); n <= num_vfs; n++) {
+		struct intel_iov_sched_vf *vf = &sched->vfs[n];
+
+		max_eq = READ_ONCE(vf->max_exec_quantum);
+		if (!max_eq)
+			continue;
+
+		min_eq = clamp_t(u32, READ_ONCE(vf->min_exec_quantum),
+				 IOV_SCHED_MIN_EXEC_QUANTUM, max_eq);
+		target = READ_ONCE(vf->share) ?: DIV_ROUND_UP(100, max(num_busy, 1u));
+
+		exec_quanta[n] =
+			sched_next_exec_quantum(intel_iov_provisioning_get_tuned_exec_quantum(iov, n),
+						vf->busyness, target, min_eq, max_eq);
+	}
+
+	intel_iov_provisioning_tune_exec_quanta(iov, exec_quanta, num_vfs);
+	kfree(exec_quanta);
+}
+
+static void pf_sched_start_period(struct intel_iov *iov)
+{
+	struct intel_iov_sched *sched = &iov->pf.sched;
+	unsigned int n, num_vfs = pf_get_numvfs(iov);
+	u32 period = intel_iov_provisioning_get_sample_period(iov) ?: IOV_SCHED_DEFAULT_PERIOD_MS;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	for (n = VFID(1); n <= num_vfs; n++) {
+		const struct intel_iov_config *config = &iov->pf.provisioning.configs[n];
+
+		sched->vfs[n].begin_ctx = config->begin_ctx;
+		sched->vfs[n].num_ctxs = config->num_ctxs;
+		sched->vfs[n].busy = 0;
+	}
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	sched->samples = 0;
+	sched->period_end = jiffies + msecs_to_jiffies(max_t(u32, period, IOV_SCHED_TICK_MS));
+}
+
+static void pf_sched_worker_func(struct work_struct *w)
+{
+	struct intel_iov *iov = container_of(w, typeof(*iov), pf.sched.worker.work);
+	struct intel_iov_sched *sched = &iov->pf.sched;
+
+	/* restarted by intel_iov_sched_update() once VFs are enabled */
+	if (!pf_get_numvfs(iov)) {
+		intel_iov_provisioning_tune_exec_quanta(iov, NULL, pf_get_totalvfs(iov));
+		return;
+	}
+
+	pf_sched_sample(iov);
+
+	if (time_after_eq(jiffies, sched->period_end)) {
+		pf_sched_adjust(iov);
+		pf_sched_start_period(iov);
+	}
+
+	queue_delayed_work(system_unbound_wq, &sched->worker,
+			   msecs_to_jiffies(IOV_SCHED_TICK_MS));
+}
+
+/**
+ * intel_iov_sched_init_early - Allocate scheduling controller data.
+ * @iov: the IOV struct
+ *
+ * This function can only be called on PF.
+ */
+void intel_iov_sched_init_early(struct intel_iov *iov)
+{
+	struct intel_iov_sched_vf *vfs;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(iov->pf.sched.vfs);
+
+	INIT_DELAYED_WORK(&iov->pf.sched.worker, pf_sched_worker_func);
+
+	vfs = kcalloc(1 + pf_get_totalvfs(iov), sizeof(*vfs), GFP_KERNEL);
+	if (unlikely(!vfs)) {
+		pf_update_status(iov, -ENOMEM, "sched");
+		return;
+	}
+
+	iov->pf.sched.vfs = vfs;
+}
+
+/**
+ * intel_iov_sched_release - Release scheduling controller data.
+ * @iov: the IOV struct
+ *
+ * This function can only be called on PF.
+ */
+void intel_iov_sched_release(struct intel_iov *iov)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	kfree(fetch_and_zero(&iov->pf.sched.vfs));
+}
+
+static void pf_sched_stop(struct intel_iov *iov)
+{
+	iov->pf.sched.enabled = false;
+	cancel_delayed_work_sync(&iov->pf.sched.worker);
+}
+
+/**
+ * intel_iov_sched_fini - Stop scheduling controller.
+ * @iov: the IOV struct
+ *
+ * This function can only be called on PF.
+ */
+void intel_iov_sched_fini(struct intel_iov *iov)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	pf_sched_stop(iov);
+}
+
+/**
+ * intel_iov_sched_update - Resume scheduling controller after VFs enabling.
+ * @iov: the IOV struct
+ *
+ * This function can only be called on PF.
+ */
+void intel_iov_sched_update(struct intel_iov *iov)
+{
+	struct intel_iov_sched *sched = &iov->pf.sched;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!sched->enabled || delayed_work_pending(&sched->worker))
+		return;
+
+	pf_sched_start_period(iov);
+	queue_delayed_work(system_unbound_wq, &sched->worker,
+			   msecs_to_jiffies(IOV_SCHED_TICK_MS));
+}
+
+/**
+ * intel_iov_sched_set_enabled - Start or stop scheduling controller.
+ * @iov: the IOV struct
+ * @enable: whether to run the controller
+ *
+ * Once stopped, VFs get back their provisioned execution quanta.
+ *
+ * VF busyness is estimated from the context index reported in the GuC engine
+ * usage records, assuming that it is a global GuC context ID. Until the GuC
+ * ABI confirms that, the controller is only available in IOV debug builds.
+ *
+ * This function can only be called on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_sched_set_enabled(struct intel_iov *iov, bool enable)
+{
+	struct intel_iov_sched *sched = &iov->pf.sched;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (unlikely(!sched->vfs))
+		return -ENODEV;
+
+	if (!enable) {
+		pf_sched_stop(iov);
+		intel_iov_provisioning_tune_exec_quanta(iov, NULL, pf_get_totalvfs(iov));
+		return 0;
+	}
+
+	if (!IS_ENABLED(CONFIG_DRM_I915_DEBUG_IOV))
+		return -EOPNOTSUPP;
+
+	if (sched->enabled)
+		return 0;
+
+	pf_sched_start_period(iov);
+	sched->enabled = true;
+	queue_delayed_work(system_unbound_wq, &sched->worker,
+			   msecs_to_jiffies(IOV_SCHED_TICK_MS));
+
+	return 0;
+}
+
+/**
+ * intel_iov_sched_is_enabled - Check if scheduling controller is running.
+ * @iov: the IOV struct
+ *
+ * This function can only be called on PF.
+ *
+ * Return: true if scheduling controller is running.
+ */
+bool intel_iov_sched_is_enabled(struct intel_iov *iov)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	return iov->pf.sched.enabled;
+}
+
+static int pf_sched_set_bounds(struct intel_iov *iov, unsigned int id, u32 min, u32 max)
+{
+	struct intel_iov_sched_vf *vf = &iov->pf.sched.vfs[id];
+
+	if (max && min > max)
+		return -EINVAL;
+
+	WRITE_ONCE(vf->min_exec_quantum, min);
+	WRITE_ONCE(vf->max_exec_quantum, max);
+
+	return 0;
+}
+
+/**
+ * intel_iov_sched_set_min_exec_quantum - Set lower bound of VF execution quantum.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ * @value: execution quantum in milliseconds
+ *
+ * This function can only be called on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_sched_set_min_exec_quantum(struct intel_iov *iov, unsigned int id, u32 value)
+{
+	int err;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	if (unlikely(!iov->pf.sched.vfs))
+		return -ENODEV;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	err = pf_sched_set_bounds(iov, id, value, iov->pf.sched.vfs[id].max_exec_quantum);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return err;
+}
+
+/**
+ * intel_iov_sched_get_min_exec_quantum - Get lower bound of VF execution quantum.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ *
+ * This function can only be called on PF.
+ *
+ * Return: execution quantum in milliseconds.
+ */
+u32 intel_iov_sched_get_min_exec_quantum(struct intel_iov *iov, unsigned int id)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	return iov->pf.sched.vfs ? READ_ONCE(iov->pf.sched.vfs[id].min_exec_quantum) : 0;
+}
+
+/**
+ * intel_iov_sched_set_max_exec_quantum - Set upper bound of VF execution quantum.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ * @value: execution quantum in milliseconds, 0 to exclude VF from the control
+ *
+ * This function can only be called on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_sched_set_max_exec_quantum(struct intel_iov *iov, unsigned int id, u32 value)
+{
+	int err;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	if (unlikely(!iov->pf.sched.vfs))
+		return -ENODEV;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	err = pf_sched_set_bounds(iov, id, iov->pf.sched.vfs[id].min_exec_quantum, value);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return err;
+}
+
+/**
+ * intel_iov_sched_get_max_exec_quantum - Get upper bound of VF execution quantum.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ *
+ * This function can only be called on PF.
+ *
+ * Return: execution quantum in milliseconds.
+ */
+u32 intel_iov_sched_get_max_exec_quantum(struct intel_iov *iov, unsigned int id)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	return iov->pf.sched.vfs ? READ_ONCE(iov->pf.sched.vfs[id].max_exec_quantum) : 0;
+}
+
+/**
+ * intel_iov_sched_set_share - Set VF target share of the engines time.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ * @value: share in percent, 0 for fair share among busy VFs
+ *
+ * This function can only be called on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_sched_set_share(struct intel_iov *iov, unsigned int id, u32 value)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	if (unlikely(!iov->pf.sched.vfs))
+		return -ENODEV;
+
+	if (value > 100)
+		return -EINVAL;
+
+	WRITE_ONCE(iov->pf.sched.vfs[id].share, value);
+	return 0;
+}
+
+/**
+ * intel_iov_sched_get_share - Get VF target share of the engines time.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ *
+ * This function can only be called on PF.
+ *
+ * Return: share in percent.
+ */
+u32 intel_iov_sched_get_share(struct intel_iov *iov, unsigned int id)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	return iov->pf.sched.vfs ? READ_ONCE(iov->pf.sched.vfs[id].share) : 0;
+}
+
+/**
+ * intel_iov_sched_get_busyness - Get VF share of the engines time.
+ * @iov: the IOV struct
+ * @id: VF identifier
+ *
+ * This function can only be called on PF.
+ *
+ * Return: share of the engines time used by VF in last period (in percent).
+ */
+u32 intel_iov_sched_get_busyness(struct intel_iov *iov, unsigned int id)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(id == PFID || id > pf_get_totalvfs(iov));
+
+	return iov->pf.sched.vfs ? READ_ONCE(iov->pf.sched.vfs[id].busyness) : 0;
+}
+
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+#include "selftests/selftest_mock_iov_sched.c"
+#endif
@@ -0,0 +1,29 @@
+/* SPDX-License-Identifier: MIT */
+/*
+ * Copyright © 2024 Intel Corporation
+ */
+
+#ifndef __INTEL_IOV_SCHED_H__
+#define __INTEL_IOV_SCHED_H__
+
+#include <linux/types.h>
+
+struct intel_iov;
+
+void intel_iov_sched_init_early(struct intel_iov *iov);
+void intel_iov_sched_release(struct intel_iov *iov);
+void intel_iov_sched_fini(struct intel_iov *iov);
+void intel_iov_sched_update(struct intel_iov *iov);
+
+int intel_iov_sched_set_enabled(struct intel_iov *iov, bool enable);
+bool intel_iov_sched_is_enabled(struct intel_iov *iov);
+
+int intel_iov_sched_set_min_exec_quantum(struct intel_iov *iov, unsigned int id, u32 value);
+u32 intel_iov_sched_get_min_exec_quantum(struct intel_iov *iov, unsigned int id);
+int intel_iov_sched_set_max_exec_quantum(struct intel_iov *iov, unsigned int id, u32 value);
+u32 intel_iov_sched_get_max_exec_quantum(struct intel_iov *iov, unsigned int id);
+int intel_iov_sched_set_share(struct intel_iov *iov, unsigned int id, u32 value);
+u32 intel_iov_sched_get_share(struct intel_iov *iov, unsigned int id);
+u32 intel_iov_sched_get_busyness(struct intel_iov *iov, unsigned int id);
+
+#endif /* __INTEL_IOV_SCHED_H__ */
@@ -5,6 +5,7 @@
 
 #include <linux/bitfield.h>
 #include <linux/bsearch.h>
+#include <linux/random.h>
 
 #include "abi/iov_actions_abi.h"
 #include "abi/iov_actions_mmio_abi.h"
@@ -126,13 +127,80 @@ static int pf_alloc_runtime_info(struct intel_iov *iov)
 	iov->pf.service.runtime.regs = regs;
 	iov->pf.service.runtime.values = values;
 
+	/* don't let a VF match a generation cached from an earlier PF instance */
+	atomic_set(&iov->pf.service.runtime.generation, get_random_u32());
+
 	return 0;
 }
 
+static void pf_replace_runtime_snapshot(struct intel_iov *iov,
+					struct intel_iov_runtime_snapshot *snap)
+{
+	struct intel_iov_runtime_snapshot *old;
+
+	old = unrcu_pointer(xchg(&iov->pf.service.runtime.snapshot, RCU_INITIALIZER(snap)));
+	if (old)
+		kfree_rcu(old, rcu);
+}
+
+static bool runtime_snapshot_equal(const struct intel_iov_runtime_snapshot *a,
+				   const struct intel_iov_runtime_snapshot *b)
+{
+	return a && b && a->count == b->count &&
+	       !memcmp(a->data, b->data, 2 * a->count * sizeof(u32));
+}
+
+/*
+ * Publish current register values as a new immutable snapshot. A new
+ * generation is only stamped if any value has changed, so VFs that already
+ * hold the current values can skip the transfer.
+ */
+static void pf_publish_runtime_snapshot(struct intel_iov *iov)
+{
+	struct intel_iov_runtime_regs *runtime = &iov->pf.service.runtime;
+	struct intel_iov_runtime_snapshot *snap;
+	bool same;
+	u32 i;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!runtime->size || runtime->size > VF2PF_QUERY_RUNTIME_SNAPSHOT_MAX_REGS)
+		return;
+
+	snap = kmalloc(struct_size(snap, data, 2 * runtime->size), GFP_KERNEL);
+	if (unlikely(!snap)) {
+		/* VFs will fall back to VF2PF_QUERY_RUNTIME */
+		pf_replace_runtime_snapshot(iov, NULL);
+		return;
+	}
+
+	snap->count = runtime->size;
+	for (i = 0; i < runtime->size; i++) {
+		snap->data[2 * i] = i915_mmio_reg_offset(runtime->regs[i]);
+		snap->data[2 * i + 1] = runtime->values[i];
+	}
+
+	rcu_read_lock();
+	same = runtime_snapshot_equal(rcu_dereference(runtime->snapshot), snap);
+	rcu_read_unlock();
+	if (same) {
+		kfree(snap);
+		return;
+	}
+
+	do {
+		snap->generation = atomic_inc_return(&runtime->generation);
+	} while (!snap->generation);
+
+	IOV_DEBUG(iov, "publishing runtime snapshot generation %#x\n", snap->generation);
+	pf_replace_runtime_snapshot(iov, snap);
+}
+
 static void pf_release_runtime_info(struct intel_iov *iov)
 {
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 
+	pf_replace_runtime_snapshot(iov, NULL);
 	kfree(iov->pf.service.runtime.values);
 	iov->pf.service.runtime.values = NULL;
 	iov->pf.service.runtime.regs = NULL;
@@ -160,6 +228,8 @@ static void pf_prepare_runtime_info(struct intel_iov *iov)
 		IOV_DEBUG(iov, "reg[%#x] = %#x\n",
 			  i915_mmio_reg_offset(*regs++), *values++);
 	}
+
+	pf_publish_runtime_snapshot(iov);
 }
 
 static void pf_reset_runtime_info(struct intel_iov *iov)
@@ -177,6 +247,8 @@ static void pf_reset_runtime_info(struct intel_iov *iov)
 
 	while (size--)
 		*values++ = 0;
+
+	pf_replace_runtime_snapshot(iov, NULL);
 }
 
 /**
@@ -306,6 +378,55 @@ static int reply_handshake(struct intel_iov *iov, u32 origin,
 					   response, ARRAY_SIZE(response));
 }
 
+static void pf_stat_add(struct intel_iov *iov, u32 vfid, enum intel_iov_vf_stat stat, u64 value)
+{
+	u64 *counter;
+
+	if (unlikely(!iov->pf.state.data || vfid > pf_get_totalvfs(iov)))
+		return;
+
+	/* only updated from the relay worker, readers may run concurrently */
+	counter = &iov->pf.state.data[vfid].stats[stat];
+	WRITE_ONCE(*counter, *counter + value);
+}
+
+static void pf_stat_latency(struct intel_iov *iov, u32 vfid, s64 delta_us)
+{
+	enum intel_iov_vf_stat stat;
+
+	if (delta_us < 10)
+		stat = IOV_VF_STAT_LATENCY_10US;
+	else if (delta_us < 100)
+		stat = IOV_VF_STAT_LATENCY_100US;
+	else if (delta_us < USEC_PER_MSEC)
+		stat = IOV_VF_STAT_LATENCY_1MS;
+	else
+		stat = IOV_VF_STAT_LATENCY_SLOW;
+
+	pf_stat_add(iov, vfid, stat, 1);
+}
+
+/**
+ * intel_iov_service_read_vf_stat - Read VF control-plane traffic counter.
+ * @iov: the IOV struct
+ * @vfid: VF identifier
+ * @stat: counter to read
+ *
+ * This function is for PF only.
+ *
+ * Return: current value of the counter.
+ */
+u64 intel_iov_service_read_vf_stat(struct intel_iov *iov, u32 vfid, enum intel_iov_vf_stat stat)
+{
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(stat >= IOV_VF_STAT_MAX);
+
+	if (unlikely(!iov->pf.state.data || vfid > pf_get_totalvfs(iov)))
+		return 0;
+
+	return READ_ONCE(iov->pf.state.data[vfid].stats[stat]);
+}
+
 static int pf_reply_runtime_query(struct intel_iov *iov, u32 origin,
 				  u32 relay_id, const u32 *msg, u32 len)
 {
@@ -350,6 +471,57 @@ static int pf_reply_runtime_query(struct intel_iov *iov, u32 origin,
 					   response, 2 + 2 * chunk);
 }
 
+static int pf_reply_runtime_snapshot(struct intel_iov *iov, u32 origin,
+				     u32 relay_id, const u32 *msg, u32 len)
+{
+	struct intel_iov_runtime_snapshot *snap;
+	u32 generation, count;
+	u32 *response;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (unlikely(len > VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_LEN))
+		return -EMSGSIZE;
+	if (unlikely(len < VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_LEN))
+		return -EPROTO;
+	if (unlikely(FIELD_GET(VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_0_MBZ, msg[0])))
+		return -EINVAL;
+
+	generation = FIELD_GET(VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_1_GENERATION, msg[1]);
+
+	response = kmalloc_array(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MAX_LEN,
+				 sizeof(u32), GFP_KERNEL);
+	if (!response)
+		return -ENOMEM;
+
+	rcu_read_lock();
+	snap = rcu_dereference(iov->pf.service.runtime.snapshot);
+	if (snap) {
+		count = snap->generation == generation ? 0 : snap->count;
+
+		response[0] = FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+			      FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS) |
+			      FIELD_PREP(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_0_COUNT, count);
+		response[1] = FIELD_PREP(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_1_GENERATION,
+					 snap->generation);
+		memcpy(response + VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN,
+		       snap->data, 2 * count * sizeof(u32));
+
+		ret = VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN + 2 * count;
+	} else {
+		ret = -ENODATA;
+	}
+	rcu_read_unlock();
+
+	if (ret > 0)
+		ret = intel_iov_relay_reply_to_vf(&iov->relay, origin, relay_id,
+						  response, ret);
+
+	kfree(response);
+	return ret;
+}
+
 static gen8_pte_t get_pte_from_msg(const u32 *msg, u16 id)
 {
 	u32 pte_lo = FIELD_GET(VF2PF_UPDATE_GGTT32_REQUEST_DATAn_PTE_LO, msg[id * 2 + 2]);
@@ -367,9 +539,6 @@ static int pf_reply_update_ggtt(struct intel_iov *iov, u32 origin,
 	u32 pte_offset;
 	u16 count;
 	gen8_pte_t ptes[VF2PF_UPDATE_GGTT_MAX_PTES];
-	gen8_pte_t *start_range;
-	u16 range_size;
-	u16 updated = 0;
 	int ret;
 	int i;
 
@@ -387,44 +556,77 @@ static int pf_reply_update_ggtt(struct intel_iov *iov, u32 origin,
 	if (count > VF2PF_UPDATE_GGTT_MAX_PTES)
 		return -EMSGSIZE;
 
-	ptes[0] = get_pte_from_msg(msg, 0);
-	start_range = &ptes[0];
-	range_size = 1;
-
-	for (i = 1; i < count; i++) {
+	for (i = 0; i < count; i++)
 		ptes[i] = get_pte_from_msg(msg, i);
 
-		if ((ptes[i - 1] & ~GEN12_GGTT_PTE_ADDR_MASK) !=
-		    (ptes[i] & ~GEN12_GGTT_PTE_ADDR_MASK)) {
-			u16 local_num_copies = (VF2PF_UPDATE_GGTT32_IS_LAST_MODE(mode)) ?
-					       0 : num_copies;
-
-			ret = intel_iov_ggtt_pf_update_vf_ptes(iov, origin, pte_offset, mode,
-							       local_num_copies, start_range, range_size);
-			if (ret < 0) {
-				return ret;
-			} else {
-				updated += ret;
-				start_range = &ptes[i];
-				pte_offset += range_size;
-				range_size = 0;
-				if (!VF2PF_UPDATE_GGTT32_IS_LAST_MODE(mode))
-					num_copies = 0;
-			}
-		}
-		range_size++;
+	/* PTE flags are applied per PTE, no need to split the request */
+	ret = intel_iov_ggtt_pf_update_vf_ptes(iov, origin, pte_offset, mode, num_copies,
+					       ptes, count);
+	if (ret < 0)
+		return ret;
+
+	pf_stat_add(iov, origin, IOV_VF_STAT_GGTT_PTES, ret);
+
+	response[0] = FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		      FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS) |
+		      FIELD_PREP(VF2PF_UPDATE_GGTT32_RESPONSE_MSG_0_NUM_PTES, ret);
+
+	return intel_iov_relay_reply_to_vf(&iov->relay, origin, relay_id,
+					   response, ARRAY_SIZE(response));
+}
+
+static int pf_reply_update_ggtt_ranges(struct intel_iov *iov, u32 origin,
+				       u32 relay_id, const u32 *msg, u32 len)
+{
+	struct intel_iov_ggtt_range ranges[VF2PF_UPDATE_GGTT_MAX_RANGES];
+	u32 response[VF2PF_UPDATE_GGTT_RANGES_RESPONSE_MSG_LEN];
+	const u32 *range = &msg[2];
+	u32 num_ranges, pte_offset;
+	u32 i;
+	int ret;
+
+	if (!i915_ggtt_require_binder(iov_to_i915(iov)))
+		return -EOPNOTSUPP;
+
+	if (unlikely(len > VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_MAX_LEN))
+		return -EMSGSIZE;
+	if (unlikely(len < VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_MIN_LEN))
+		return -EPROTO;
+	if (unlikely((len - 2) % VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN))
+		return -EPROTO;
+
+	if (unlikely(FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_0_MBZ, msg[0])) ||
+	    unlikely(FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_1_MBZ, msg[1])))
+		return -EPROTO;
+
+	num_ranges = (len - 2) / VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN;
+	if (unlikely(num_ranges > VF2PF_UPDATE_GGTT_MAX_RANGES))
+		return -EMSGSIZE;
+
+	for (i = 0; i < num_ranges; i++, range += VF2PF_UPDATE_GGTT_RANGES_REQUEST_RANGE_LEN) {
+		u32 pte_lo = FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_PTE_LO, range[0]);
+		u32 pte_hi = FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_PTE_HI, range[1]);
+
+		ranges[i].pte = make_u64(pte_hi, pte_lo);
+		ranges[i].count = FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_COUNT,
+					    range[2]);
+		ranges[i].increment = FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_DATAn_INCREMENT,
+						range[2]);
+		if (unlikely(!ranges[i].count))
+			return -EPROTO;
 	}
 
-	ret = intel_iov_ggtt_pf_update_vf_ptes(iov, origin, pte_offset, mode, num_copies,
-					       start_range, range_size);
+	pte_offset = FIELD_GET(VF2PF_UPDATE_GGTT_RANGES_REQUEST_MSG_1_OFFSET, msg[1]);
+
+	ret = intel_iov_ggtt_pf_update_vf_ranges(iov, origin, pte_offset, ranges, num_ranges);
 	if (ret < 0)
 		return ret;
 
-	updated += ret;
+	pf_stat_add(iov, origin, IOV_VF_STAT_GGTT_PTES, ret);
 
 	response[0] = FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
 		      FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS) |
-		      FIELD_PREP(VF2PF_UPDATE_GGTT32_RESPONSE_MSG_0_NUM_PTES, updated);
+		      FIELD_PREP(VF2PF_UPDATE_GGTT_RANGES_RESPONSE_MSG_0_NUM_PTES, ret);
 
 	return intel_iov_relay_reply_to_vf(&iov->relay, origin, relay_id,
 					   response, ARRAY_SIZE(response));
@@ -445,6 +647,7 @@ static int pf_reply_update_ggtt(struct intel_iov *iov, u32 origin,
 int intel_iov_service_process_msg(struct intel_iov *iov, u32 origin,
 				  u32 relay_id, const u32 *msg, u32 len)
 {
+	ktime_t start = ktime_get();
 	int err = -EOPNOTSUPP;
 	u32 action;
 	u32 __maybe_unused data;
@@ -466,14 +669,26 @@ int intel_iov_service_process_msg(struct intel_iov *iov, u32 origin,
 		break;
 	case IOV_ACTION_VF2PF_QUERY_RUNTIME:
 		err = pf_reply_runtime_query(iov, origin, relay_id, msg, len);
+		pf_stat_add(iov, origin, IOV_VF_STAT_RUNTIME_QUERIES, 1);
+		break;
+	case IOV_ACTION_VF2PF_QUERY_RUNTIME_SNAPSHOT:
+		err = pf_reply_runtime_snapshot(iov, origin, relay_id, msg, len);
+		pf_stat_add(iov, origin, IOV_VF_STAT_RUNTIME_QUERIES, 1);
 		break;
 	case IOV_ACTION_VF2PF_UPDATE_GGTT32:
 		err = pf_reply_update_ggtt(iov, origin, relay_id, msg, len);
 		break;
+	case IOV_ACTION_VF2PF_UPDATE_GGTT_RANGES:
+		err = pf_reply_update_ggtt_ranges(iov, origin, relay_id, msg, len);
+		break;
 	default:
 		break;
 	}
 
+	pf_stat_add(iov, origin, IOV_VF_STAT_RELAY_MSGS, 1);
+	pf_stat_add(iov, origin, IOV_VF_STAT_RELAY_BYTES, len * sizeof(u32));
+	pf_stat_latency(iov, origin, ktime_us_delta(ktime_get(), start));
+
 	return err;
 }
 
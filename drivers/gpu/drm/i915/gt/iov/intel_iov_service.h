@@ -8,6 +8,8 @@
 
 #include <linux/types.h>
 
+#include "intel_iov_types.h"
+
 struct intel_iov;
 
 void intel_iov_service_init_early(struct intel_iov *iov);
@@ -21,4 +23,6 @@ int intel_iov_service_process_msg(struct intel_iov *iov, u32 origin,
 int intel_iov_service_process_mmio_relay(struct intel_iov *iov, const u32 *msg,
 					 u32 len);
 
+u64 intel_iov_service_read_vf_stat(struct intel_iov *iov, u32 vfid, enum intel_iov_vf_stat stat);
+
 #endif /* __INTEL_IOV_SERVICE_H__ */
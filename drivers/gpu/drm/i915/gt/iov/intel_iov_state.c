@@ -4,6 +4,7 @@
  */
 
 #include "i915_pci.h"
+#include "i915_trace.h"
 #include "intel_iov.h"
 #include "intel_iov_event.h"
 #include "intel_iov_ggtt.h"
@@ -34,18 +35,27 @@ static void pf_state_worker_func(struct work_struct *w);
 void intel_iov_state_init_early(struct intel_iov *iov)
 {
 	struct intel_iov_data *data;
+	unsigned long *pending;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 	GEM_BUG_ON(iov->pf.state.data);
 
 	INIT_WORK(&iov->pf.state.worker, pf_state_worker_func);
 
+	pending = bitmap_zalloc(1 + pf_get_totalvfs(iov), GFP_KERNEL);
+	if (unlikely(!pending)) {
+		pf_update_status(iov, -ENOMEM, "state");
+		return;
+	}
+
 	data = kcalloc(1 + pf_get_totalvfs(iov), sizeof(*data), GFP_KERNEL);
 	if (unlikely(!data)) {
+		bitmap_free(pending);
 		pf_update_status(iov, -ENOMEM, "state");
 		return;
 	}
 
+	iov->pf.state.pending = pending;
 	iov->pf.state.data = data;
 }
 
@@ -62,6 +72,7 @@ void intel_iov_state_release(struct intel_iov *iov)
 
 	cancel_work_sync(&iov->pf.state.worker);
 	kfree(fetch_and_zero(&iov->pf.state.data));
+	bitmap_free(fetch_and_zero(&iov->pf.state.pending));
 }
 
 static void pf_reset_vf_state(struct intel_iov *iov, u32 vfid)
@@ -208,7 +219,45 @@ static bool pf_vf_flr_in_progress(struct intel_iov *iov, u32 vfid)
 	return test_bit(IOV_VF_FLR_IN_PROGRESS, state);
 }
 
-/* Return: true if more processing is needed */
+static void pf_queue_vf(struct intel_iov *iov, u32 vfid)
+{
+	GEM_BUG_ON(!vfid || vfid > pf_get_totalvfs(iov));
+
+	/* worker must see VF state updates made before queueing it */
+	smp_mb__before_atomic();
+	set_bit(vfid, iov->pf.state.pending);
+	smp_mb__after_atomic();
+	queue_work(system_unbound_wq, &iov->pf.state.worker);
+}
+
+/*
+ * Workers of other GTs may wait for this VF to reach some FLR phase on this
+ * GT, so let them re-check the VF once it did, instead of polling.
+ */
+static void pf_queue_vf_siblings(struct intel_iov *iov, u32 vfid)
+{
+	struct intel_gt *gt;
+	unsigned int gtid;
+
+	for_each_gt(gt, iov_to_i915(iov), gtid)
+		if (&gt->iov != iov)
+			pf_queue_vf(&gt->iov, vfid);
+}
+
+static void pf_vf_flr_failed(struct intel_iov *iov, u32 vfid)
+{
+	unsigned long *state = &iov->pf.state.data[vfid].state;
+
+	set_bit(IOV_VF_FLR_FAILED, state);
+	clear_bit(IOV_VF_FLR_IN_PROGRESS, state);
+	trace_i915_iov_vf_flr(iov_to_gt(iov), vfid, IOV_FLR_PHASE_FAILED);
+	pf_queue_vf_siblings(iov, vfid);
+}
+
+/*
+ * Return: true if more processing is needed. Waits for other GTs return
+ * false, the VF is queued again by the GT that makes progress.
+ */
 static bool pf_process_vf(struct intel_iov *iov, u32 vfid)
 {
 	unsigned long *state = &iov->pf.state.data[vfid].state;
@@ -221,11 +270,11 @@ static bool pf_process_vf(struct intel_iov *iov, u32 vfid)
 			return true;
 		}
 		if (err) {
-			set_bit(IOV_VF_FLR_FAILED, state);
-			clear_bit(IOV_VF_FLR_IN_PROGRESS, state);
+			pf_vf_flr_failed(iov, vfid);
 			return false;
 		}
 		clear_bit(IOV_VF_PAUSE_IN_PROGRESS, state);
+		trace_i915_iov_vf_flr(iov_to_gt(iov), vfid, IOV_FLR_PHASE_START);
 		return true;
 	}
 
@@ -233,10 +282,12 @@ static bool pf_process_vf(struct intel_iov *iov, u32 vfid)
 		struct intel_gt *gt;
 		unsigned int gtid;
 
+		/* queued again by pf_handle_vf_flr_done() of the other GT */
 		for_each_gt(gt, iov_to_i915(iov), gtid)
 			if (!pf_vf_flr_done_received(&gt->iov, vfid))
-				return true;
+				return false;
 		clear_bit(IOV_VF_NEEDS_FLR_DONE_SYNC, state);
+		pf_queue_vf_siblings(iov, vfid);
 		return true;
 	}
 
@@ -244,9 +295,10 @@ static bool pf_process_vf(struct intel_iov *iov, u32 vfid)
 		struct intel_gt *gt;
 		unsigned int gtid;
 
+		/* queued again once the other GT cleared its sync flag */
 		for_each_gt(gt, iov_to_i915(iov), gtid)
 			if (pf_vf_flr_needs_sync(&gt->iov, vfid))
-				return true;
+				return false;
 	}
 
 	if (test_and_clear_bit(IOV_VF_FLR_DONE_RECEIVED, state)) {
@@ -261,10 +313,10 @@ static bool pf_process_vf(struct intel_iov *iov, u32 vfid)
 			return true;
 		}
 		if (err) {
-			set_bit(IOV_VF_FLR_FAILED, state);
-			clear_bit(IOV_VF_FLR_IN_PROGRESS, state);
+			pf_vf_flr_failed(iov, vfid);
 			return false;
 		}
+		trace_i915_iov_vf_flr(iov_to_gt(iov), vfid, IOV_FLR_PHASE_FINISH);
 		return true;
 	}
 
@@ -273,44 +325,49 @@ static bool pf_process_vf(struct intel_iov *iov, u32 vfid)
 			struct intel_gt *gt;
 			unsigned int gtid;
 
+			/* queued again once the other GT completed its FLR */
 			for_each_gt(gt, iov_to_i915(iov), gtid) {
 				if (iov_is_root(&gt->iov))
 					continue;
 				if (pf_vf_flr_in_progress(&gt->iov, vfid))
-					return true;
+					return false;
 			}
 		}
 		clear_bit(IOV_VF_FLR_IN_PROGRESS, state);
+		trace_i915_iov_vf_flr(iov_to_gt(iov), vfid, IOV_FLR_PHASE_COMPLETE);
+		if (!iov_is_root(iov))
+			pf_queue_vf(iov_get_root(iov), vfid);
 		return false;
 	}
 
 	return false;
 }
 
-static void pf_queue_worker(struct intel_iov *iov)
-{
-	queue_work(system_unbound_wq, &iov->pf.state.worker);
-}
-
-static void pf_process_all_vfs(struct intel_iov *iov)
+static void pf_process_pending_vfs(struct intel_iov *iov)
 {
 	unsigned int num_vfs = pf_get_totalvfs(iov);
-	unsigned int n;
+	unsigned int n = 1;
 	bool more = false;
 
-	/* only VFs need processing */
-	for (n = 1; n <= num_vfs; n++)
-		more |= pf_process_vf(iov, n);
+	/* only VFs with new events need processing */
+	for_each_set_bit_from(n, iov->pf.state.pending, 1 + num_vfs) {
+		if (!test_and_clear_bit(n, iov->pf.state.pending))
+			continue;
+		if (pf_process_vf(iov, n)) {
+			set_bit(n, iov->pf.state.pending);
+			more = true;
+		}
+	}
 
 	if (more)
-		pf_queue_worker(iov);
+		queue_work(system_unbound_wq, &iov->pf.state.worker);
 }
 
 static void pf_state_worker_func(struct work_struct *w)
 {
 	struct intel_iov *iov = container_of(w, struct intel_iov, pf.state.worker);
 
-	pf_process_all_vfs(iov);
+	pf_process_pending_vfs(iov);
 }
 
 /**
@@ -353,7 +410,8 @@ static void pf_init_vf_flr(struct intel_iov *iov, u32 vfid)
 		set_bit(IOV_VF_NEEDS_FLR_DONE_SYNC, state);
 
 	set_bit(IOV_VF_NEEDS_FLR_START, state);
-	pf_queue_worker(iov);
+	trace_i915_iov_vf_flr(iov_to_gt(iov), vfid, IOV_FLR_PHASE_NOTIFY);
+	pf_queue_vf(iov, vfid);
 }
 
 static void pf_handle_vf_flr(struct intel_iov *iov, u32 vfid)
@@ -387,7 +445,9 @@ static void pf_handle_vf_flr_done(struct intel_iov *iov, u32 vfid)
 	unsigned long *state = &iov->pf.state.data[vfid].state;
 
 	set_bit(IOV_VF_FLR_DONE_RECEIVED, state);
-	pf_queue_worker(iov);
+	trace_i915_iov_vf_flr(iov_to_gt(iov), vfid, IOV_FLR_PHASE_DONE);
+	pf_queue_vf(iov, vfid);
+	pf_queue_vf_siblings(iov, vfid);
 }
 
 static void pf_handle_vf_pause_done(struct intel_iov *iov, u32 vfid)
@@ -720,6 +780,102 @@ int intel_iov_state_restore_ggtt(struct intel_iov *iov, u32 vfid, const void *bu
 	return ret;
 }
 
+/**
+ * intel_iov_state_save_ggtt_dirty - Save VF GGTT PTEs modified since last save.
+ * @iov: the IOV struct
+ * @vfid: VF identifier
+ * @buf: buffer to save dirty VF GGTT PTEs
+ * @size: size of buffer to save dirty VF GGTT PTEs
+ *
+ * This function is for PF only.
+ *
+ * Return: Size of data written (0 if no PTEs are dirty) on success,
+ *         -EOPNOTSUPP if dirty tracking is not available,
+ *         or a negative error code on failure.
+ */
+ssize_t intel_iov_state_save_ggtt_dirty(struct intel_iov *iov, u32 vfid, void *buf, size_t size)
+{
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[vfid].ggtt_region;
+	ssize_t ret;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	if (!drm_mm_node_allocated(node))
+		ret = -EINVAL;
+	else
+		ret = intel_iov_ggtt_shadow_save_dirty(iov, vfid, buf, size,
+						       I915_GGTT_SAVE_PTES_NO_VFID);
+
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return ret;
+}
+
+/**
+ * intel_iov_state_clear_ggtt_dirty - Start tracking of modified VF GGTT PTEs.
+ * @iov: the IOV struct
+ * @vfid: VF identifier
+ *
+ * This function is for PF only.
+ *
+ * Return: 0 on success, -EOPNOTSUPP if dirty tracking is not available,
+ *         or a negative error code on failure.
+ */
+int intel_iov_state_clear_ggtt_dirty(struct intel_iov *iov, u32 vfid)
+{
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[vfid].ggtt_region;
+	int ret;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	if (!drm_mm_node_allocated(node))
+		ret = -EINVAL;
+	else
+		ret = intel_iov_ggtt_shadow_clear_dirty(iov, vfid);
+
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return ret;
+}
+
+/**
+ * intel_iov_state_restore_ggtt_dirty - Restore VF GGTT PTEs saved as dirty.
+ * @iov: the IOV struct
+ * @vfid: VF identifier
+ * @buf: buffer from intel_iov_state_save_ggtt_dirty()
+ * @size: size of buffer with dirty VF GGTT PTEs
+ *
+ * This function is for PF only.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_state_restore_ggtt_dirty(struct intel_iov *iov, u32 vfid,
+				       const void *buf, size_t size)
+{
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	intel_wakeref_t wakeref;
+	int ret = -ENONET;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	with_intel_runtime_pm(rpm, wakeref) {
+		unsigned int flags = FIELD_PREP(I915_GGTT_RESTORE_PTES_VFID_MASK, vfid) |
+						I915_GGTT_RESTORE_PTES_NEW_VFID;
+
+		ret = intel_iov_ggtt_shadow_load_dirty(iov, vfid, buf, size, flags);
+	}
+
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return ret;
+}
+
 static int guc_action_save_restore_vf(struct intel_guc *guc, u32 vfid, u32 opcode,
 				       u64 offset, u32 size)
 {
@@ -760,11 +916,45 @@ static int pf_save_vf_size(struct intel_iov *iov, u32 vfid)
 	return ret * sizeof(u32);
 }
 
+/*
+ * Use VF slot of the staging buffer if it was prepared by the caller,
+ * otherwise allocate a new GuC buffer (returned in @vma).
+ */
+static int pf_get_vf_buffer(struct intel_iov *iov, u32 vfid, u32 size,
+			    struct i915_vma **vma, void **blob, u32 *offset)
+{
+	struct intel_iov_state_staging *staging = &iov->pf.state.staging;
+	struct intel_guc *guc = iov_to_guc(iov);
+	int err;
+
+	if (staging->vma && vfid <= staging->num_slots && size <= staging->slot_size) {
+		*vma = NULL;
+		*blob = staging->vaddr + (vfid - 1) * staging->slot_size;
+		*offset = intel_guc_ggtt_offset(guc, staging->vma) +
+			  (vfid - 1) * staging->slot_size;
+		return 0;
+	}
+
+	err = intel_guc_allocate_and_map_vma(guc, size, vma, blob);
+	if (unlikely(err))
+		return err;
+
+	*offset = intel_guc_ggtt_offset(guc, *vma);
+	return 0;
+}
+
+static void pf_put_vf_buffer(struct i915_vma **vma)
+{
+	if (*vma)
+		i915_vma_unpin_and_release(vma, I915_VMA_RELEASE_MAP);
+}
+
 static int pf_save_vf(struct intel_iov *iov, u32 vfid, void *buf, u32 size)
 {
 	struct intel_guc *guc = iov_to_guc(iov);
 	struct i915_vma *vma;
 	void *blob;
+	u32 offset;
 	int ret;
 	u32 rsize = 0;
 
@@ -772,13 +962,12 @@ static int pf_save_vf(struct intel_iov *iov, u32 vfid, void *buf, u32 size)
 	GEM_BUG_ON(vfid > pf_get_totalvfs(iov));
 	GEM_BUG_ON(!vfid);
 
-	ret = intel_guc_allocate_and_map_vma(guc, size, &vma, (void **)&blob);
+	ret = pf_get_vf_buffer(iov, vfid, size, &vma, &blob, &offset);
 	if (unlikely(ret))
 		goto failed;
 
 	ret = guc_action_save_restore_vf(guc, vfid, GUC_PF_OPCODE_VF_SAVE,
-					 intel_guc_ggtt_offset(guc, vma),
-					 size / sizeof(u32));
+					 offset, size / sizeof(u32));
 
 	if (likely(ret > 0)) {
 		memcpy(buf, blob, size);
@@ -790,7 +979,7 @@ static int pf_save_vf(struct intel_iov *iov, u32 vfid, void *buf, u32 size)
 		}
 	}
 
-	i915_vma_unpin_and_release(&vma, I915_VMA_RELEASE_MAP);
+	pf_put_vf_buffer(&vma);
 
 	if (unlikely(ret < 0))
 		goto failed;
@@ -856,6 +1045,7 @@ static int pf_restore_vf(struct intel_iov *iov, u32 vfid, const void *buf, size_
 	struct intel_guc *guc = iov_to_guc(iov);
 	struct i915_vma *vma;
 	void *blob;
+	u32 offset;
 	int ret;
 	u32 rsize = 0;
 
@@ -863,18 +1053,16 @@ static int pf_restore_vf(struct intel_iov *iov, u32 vfid, const void *buf, size_
 	GEM_BUG_ON(vfid > pf_get_totalvfs(iov));
 	GEM_BUG_ON(!vfid);
 
-	ret = intel_guc_allocate_and_map_vma(guc, size,
-					     &vma, (void **)&blob);
+	ret = pf_get_vf_buffer(iov, vfid, size, &vma, &blob, &offset);
 	if (unlikely(ret < 0))
 		goto failed;
 
 	memcpy(blob, buf, size);
 
 	ret = guc_action_save_restore_vf(guc, vfid, GUC_PF_OPCODE_VF_RESTORE,
-					 intel_guc_ggtt_offset(guc, vma),
-					 size / sizeof(u32));
+					 offset, size / sizeof(u32));
 
-	i915_vma_unpin_and_release(&vma, I915_VMA_RELEASE_MAP);
+	pf_put_vf_buffer(&vma);
 
 	if (unlikely(ret < 0))
 		goto failed;
@@ -916,6 +1104,102 @@ int intel_iov_state_restore_vf(struct intel_iov *iov, u32 vfid, const void *buf,
 	return err;
 }
 
+/**
+ * intel_iov_state_staging_init - Prepare GuC buffer shared by VFs save/restore.
+ * @iov: the IOV struct
+ * @num_vfs: number of VFs
+ * @slot_size: size of the VF state (in bytes)
+ *
+ * Allocates and maps a single GuC buffer with a slot for each VF, so
+ * intel_iov_state_save_vf() and intel_iov_state_restore_vf() of different
+ * VFs can run in parallel without allocating a new GuC buffer each time.
+ * VF states larger than @slot_size fall back to a dedicated buffer.
+ *
+ * This function is for PF only.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int intel_iov_state_staging_init(struct intel_iov *iov, unsigned int num_vfs, u32 slot_size)
+{
+	struct intel_iov_state_staging *staging = &iov->pf.state.staging;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	intel_wakeref_t wakeref;
+	int err = -ENONET;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+	GEM_BUG_ON(staging->vma);
+
+	if (!num_vfs || !slot_size)
+		return -EINVAL;
+
+	slot_size = ALIGN(slot_size, PAGE_SIZE);
+
+	with_intel_runtime_pm(rpm, wakeref)
+		err = intel_guc_allocate_and_map_vma(iov_to_guc(iov), num_vfs * slot_size,
+						     &staging->vma, &staging->vaddr);
+	if (unlikely(err)) {
+		staging->vma = NULL;
+		return err;
+	}
+
+	staging->slot_size = slot_size;
+	staging->num_slots = num_vfs;
+
+	return 0;
+}
+
+/**
+ * intel_iov_state_staging_fini - Release GuC buffer shared by VFs save/restore.
+ * @iov: the IOV struct
+ *
+ * This function is for PF only.
+ */
+void intel_iov_state_staging_fini(struct intel_iov *iov)
+{
+	struct intel_iov_state_staging *staging = &iov->pf.state.staging;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (staging->vma)
+		i915_vma_unpin_and_release(&staging->vma, I915_VMA_RELEASE_MAP);
+	staging->vaddr = NULL;
+	staging->slot_size = 0;
+	staging->num_slots = 0;
+}
+
+/**
+ * intel_iov_state_print_timings - Print VFs GuC state save/restore timings.
+ * @iov: the IOV struct
+ * @p: the DRM printer
+ *
+ * Print duration of the last GuC state save and restore for all VFs.
+ * VFs that were never saved nor restored are ignored.
+ *
+ * This function can only be called on PF.
+ */
+int intel_iov_state_print_timings(struct intel_iov *iov, struct drm_printer *p)
+{
+	unsigned int n, total_vfs = pf_get_totalvfs(iov);
+	const struct intel_iov_data *data;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (unlikely(!iov->pf.state.data))
+		return -ENODATA;
+
+	for (n = 1; n <= total_vfs; n++) {
+		data = &iov->pf.state.data[n];
+
+		if (!data->guc_state.save_us && !data->guc_state.restore_us)
+			continue;
+
+		drm_printf(p, "VF%u:\tsave %u us\trestore %u us\n", n,
+			   data->guc_state.save_us, data->guc_state.restore_us);
+	}
+
+	return 0;
+}
+
 int intel_iov_state_store_guc_migration_state(struct intel_iov *iov, u32 vfid,
 					      const void *buf, size_t size)
 {
@@ -932,3 +1216,728 @@ int intel_iov_state_store_guc_migration_state(struct intel_iov *iov, u32 vfid,
 		return ret;
 	return 0;
 }
+
+/*
+ * The migration stream is a sequence of sections, each one prefixed with
+ * a &struct iov_state_section header. Sections are emitted in the order of
+ * stream_sections[], those not applicable to the GT are skipped.
+ *
+ * GGTT PTEs are moved through a bounce buffer of IOV_STATE_STREAM_CHUNK_SIZE
+ * bytes, GuC state is moved through the GuC VMA used by the save/restore
+ * action, so the caller may use any chunk size and the peak memory needed
+ * by the stream does not depend on the VF provisioning.
+ */
+#define IOV_STATE_STREAM_CHUNK_SIZE	SZ_64K
+
+enum iov_state_section_type {
+	IOV_STATE_SECTION_GGTT = 1,
+	IOV_STATE_SECTION_GUC,
+};
+
+struct iov_state_section {
+	u32 type;
+	u32 mbz;
+	u64 size;
+} __packed;
+
+static const u32 stream_sections[] = {
+	IOV_STATE_SECTION_GGTT,
+	IOV_STATE_SECTION_GUC,
+};
+
+struct intel_iov_state_stream {
+	struct intel_iov *iov;
+	u32 vfid;
+	bool restore;
+	unsigned int section;
+	struct iov_state_section hdr;
+	u64 pos;
+	void *chunk;
+	u64 chunk_offset;
+	u32 chunk_len;
+	struct i915_vma *vma;
+	void *blob;
+	bool ggtt_dirty;
+	struct work_struct guc_save_work;
+	int guc_save_ret;
+};
+
+static bool stream_has_ggtt(struct intel_iov_state_stream *stream)
+{
+	return iov_to_gt(stream->iov)->type != GT_MEDIA;
+}
+
+static bool stream_ggtt_use_shadow(struct intel_iov_state_stream *stream)
+{
+	struct intel_iov *iov = stream->iov;
+
+	/* mock device has no GSM, selftests go through the shadow */
+	if (I915_SELFTEST_ONLY(iov->pf.state.selftest.mock_save_restore))
+		return true;
+
+	/* Wa_22018453856 */
+	return i915_ggtt_require_binder(iov_to_i915(iov));
+}
+
+static int stream_ggtt_save_chunk(struct intel_iov_state_stream *stream, u64 offset,
+				  void *buf, u32 size)
+{
+	struct intel_iov *iov = stream->iov;
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[stream->vfid].ggtt_region;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	struct i915_ggtt *ggtt = iov_to_gt(iov)->ggtt;
+	intel_wakeref_t wakeref;
+	int ret = -ENONET;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	if (!drm_mm_node_allocated(node) ||
+	    ggtt_size_to_ptes_size(node->size) != stream->hdr.size) {
+		ret = -ESTALE;
+		goto out;
+	}
+
+	with_intel_runtime_pm(rpm, wakeref) {
+		unsigned int flags = I915_GGTT_SAVE_PTES_NO_VFID;
+		struct drm_mm_node part = {
+			.start = node->start + offset / sizeof(gen8_pte_t) * I915_GTT_PAGE_SIZE_4K,
+			.size = size / sizeof(gen8_pte_t) * I915_GTT_PAGE_SIZE_4K,
+		};
+
+		if (stream_ggtt_use_shadow(stream))
+			ret = intel_iov_ggtt_shadow_save_chunk(iov, stream->vfid, offset,
+							       buf, size, flags);
+		else
+			ret = i915_ggtt_save_ptes(ggtt, &part, buf, size, flags);
+	}
+
+out:
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return ret < 0 ? ret : 0;
+}
+
+static int stream_ggtt_restore_chunk(struct intel_iov_state_stream *stream, u64 offset,
+				     const void *buf, u32 size)
+{
+	struct intel_iov *iov = stream->iov;
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[stream->vfid].ggtt_region;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	struct i915_ggtt *ggtt = iov_to_gt(iov)->ggtt;
+	intel_wakeref_t wakeref;
+	int ret = -ENONET;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	if (!drm_mm_node_allocated(node) ||
+	    ggtt_size_to_ptes_size(node->size) != stream->hdr.size) {
+		ret = -ESTALE;
+		goto out;
+	}
+
+	with_intel_runtime_pm(rpm, wakeref) {
+		unsigned int flags = FIELD_PREP(I915_GGTT_RESTORE_PTES_VFID_MASK, stream->vfid) |
+						I915_GGTT_RESTORE_PTES_NEW_VFID;
+		struct drm_mm_node part = {
+			.start = node->start + offset / sizeof(gen8_pte_t) * I915_GTT_PAGE_SIZE_4K,
+			.size = size / sizeof(gen8_pte_t) * I915_GTT_PAGE_SIZE_4K,
+		};
+
+		/* shadow is written to the GGTT once complete */
+		if (stream_ggtt_use_shadow(stream))
+			ret = intel_iov_ggtt_shadow_load_chunk(iov, stream->vfid, offset,
+							       buf, size, flags);
+		else
+			ret = i915_ggtt_restore_ptes(ggtt, &part, buf, size, flags);
+	}
+
+out:
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	return ret < 0 ? ret : 0;
+}
+
+static int stream_ggtt_restore_sync(struct intel_iov_state_stream *stream)
+{
+	struct intel_iov *iov = stream->iov;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	intel_wakeref_t wakeref;
+	int ret = 0;
+
+	if (!stream_ggtt_use_shadow(stream))
+		goto done;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	with_intel_runtime_pm(rpm, wakeref)
+		ret = intel_iov_ggtt_shadow_sync(iov, stream->vfid);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+done:
+	if (!ret)
+		stream->ggtt_dirty = false;
+	return ret;
+}
+
+/*
+ * GGTT PTEs of an incomplete restore are already in the GGTT or the shadow,
+ * but never made it to the other one, so clear both like after the VF FLR.
+ */
+static void stream_ggtt_restore_abort(struct intel_iov_state_stream *stream)
+{
+	struct intel_iov *iov = stream->iov;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	intel_wakeref_t wakeref;
+
+	IOV_ERROR(iov, "VF%u GGTT restore incomplete, clearing PTEs\n", stream->vfid);
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	with_intel_runtime_pm(rpm, wakeref)
+		pf_clear_vf_ggtt_entries(iov, stream->vfid);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	stream->ggtt_dirty = false;
+}
+
+static void stream_release_vma(struct intel_iov_state_stream *stream)
+{
+	if (stream->vma)
+		i915_vma_unpin_and_release(&stream->vma, I915_VMA_RELEASE_MAP);
+	else if (I915_SELFTEST_ONLY(stream->iov->pf.state.selftest.mock_save_restore))
+		kvfree(stream->blob);
+	stream->blob = NULL;
+}
+
+static int stream_alloc_vma(struct intel_iov_state_stream *stream, u32 size)
+{
+	struct intel_guc *guc = iov_to_guc(stream->iov);
+
+	GEM_BUG_ON(stream->vma);
+
+	size = max_t(u32, size, PF2GUC_SAVE_RESTORE_VF_BUFF_MIN_SIZE);
+
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+	if (stream->iov->pf.state.selftest.mock_save_restore) {
+		stream->blob = kvzalloc(size, GFP_KERNEL);
+		return stream->blob ? 0 : -ENOMEM;
+	}
+#endif
+
+	return intel_guc_allocate_and_map_vma(guc, size, &stream->vma, &stream->blob);
+}
+
+/* @size (in bytes) 0 queries the size of the VF state */
+static int stream_guc_action(struct intel_iov_state_stream *stream, u32 opcode, u32 size)
+{
+	struct intel_iov *iov = stream->iov;
+	struct intel_guc *guc = iov_to_guc(iov);
+
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+	if (iov->pf.state.selftest.mock_save_restore)
+		return iov->pf.state.selftest.mock_save_restore(iov, stream->vfid, opcode,
+								size ? stream->blob : NULL,
+								size / sizeof(u32));
+#endif
+
+	return guc_action_save_restore_vf(guc, stream->vfid, opcode,
+					  size ? intel_guc_ggtt_offset(guc, stream->vma) : 0,
+					  size / sizeof(u32));
+}
+
+static int stream_guc_state_size(struct intel_iov_state_stream *stream)
+{
+	int ret;
+
+	ret = stream_guc_action(stream, GUC_PF_OPCODE_VF_SAVE, 0);
+	if (unlikely(ret < 0)) {
+		IOV_ERROR(stream->iov, "Failed to query VF%u save state size (%pe)\n",
+			  stream->vfid, ERR_PTR(ret));
+		return ret;
+	}
+
+	return ret * sizeof(u32);
+}
+
+static int __stream_guc_save(struct intel_iov_state_stream *stream)
+{
+	u32 size;
+	int ret;
+
+	ret = stream_guc_state_size(stream);
+	if (ret < 0)
+		return ret;
+	size = max_t(u32, ret, PF2GUC_SAVE_RESTORE_VF_BUFF_MIN_SIZE);
+
+	ret = stream_alloc_vma(stream, size);
+	if (ret)
+		return ret;
+
+	/*
+	 * GuC saves the whole state at once and the action only returns once
+	 * it is done. Only the copy-out from the GuC buffer is chunked, but
+	 * the save runs from stream_guc_save_work() while the GGTT section is
+	 * streamed out.
+	 */
+	return stream_guc_action(stream, GUC_PF_OPCODE_VF_SAVE, size);
+}
+
+static int stream_guc_save(struct intel_iov_state_stream *stream)
+{
+	struct intel_iov *iov = stream->iov;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	intel_wakeref_t wakeref;
+	int ret = -ENONET;
+
+	with_intel_runtime_pm(rpm, wakeref)
+		ret = __stream_guc_save(stream);
+
+	if (unlikely(ret < 0)) {
+		IOV_ERROR(iov, "Failed to save VF%u state (%pe)\n", stream->vfid, ERR_PTR(ret));
+		return ret;
+	}
+
+	return ret * sizeof(u32);
+}
+
+static void stream_guc_save_work(struct work_struct *w)
+{
+	struct intel_iov_state_stream *stream = container_of(w, typeof(*stream), guc_save_work);
+
+	stream->guc_save_ret = stream_guc_save(stream);
+}
+
+static int stream_guc_save_wait(struct intel_iov_state_stream *stream)
+{
+	flush_work(&stream->guc_save_work);
+	return stream->guc_save_ret;
+}
+
+static int stream_guc_restore(struct intel_iov_state_stream *stream)
+{
+	struct intel_iov *iov = stream->iov;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	u32 size = max_t(u32, stream->hdr.size, PF2GUC_SAVE_RESTORE_VF_BUFF_MIN_SIZE);
+	intel_wakeref_t wakeref;
+	int ret = -ENONET;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	with_intel_runtime_pm(rpm, wakeref)
+		ret = stream_guc_action(stream, GUC_PF_OPCODE_VF_RESTORE, size);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	if (unlikely(ret < 0)) {
+		IOV_ERROR(iov, "Failed to restore VF%u state (%pe)\n", stream->vfid, ERR_PTR(ret));
+		return ret;
+	}
+
+	return 0;
+}
+
+/* prepare header of the next applicable section, if any */
+static int stream_save_open_section(struct intel_iov_state_stream *stream)
+{
+	struct intel_iov *iov = stream->iov;
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[stream->vfid].ggtt_region;
+	ssize_t size;
+
+	for (; stream->section < ARRAY_SIZE(stream_sections); stream->section++) {
+		u32 type = stream_sections[stream->section];
+
+		switch (type) {
+		case IOV_STATE_SECTION_GGTT:
+			if (!stream_has_ggtt(stream))
+				continue;
+			mutex_lock(pf_provisioning_mutex(iov));
+			size = drm_mm_node_allocated(node) ?
+			       ggtt_size_to_ptes_size(node->size) : 0;
+			mutex_unlock(pf_provisioning_mutex(iov));
+			break;
+		case IOV_STATE_SECTION_GUC:
+			size = stream_guc_save_wait(stream);
+			break;
+		default:
+			MISSING_CASE(type);
+			return -EINVAL;
+		}
+
+		if (size < 0)
+			return size;
+		if (!size)
+			continue;
+
+		stream->hdr = (struct iov_state_section) { .type = type, .size = size };
+		stream->pos = 0;
+		stream->chunk_offset = 0;
+		stream->chunk_len = 0;
+		return 0;
+	}
+
+	return 0;
+}
+
+static void stream_close_section(struct intel_iov_state_stream *stream)
+{
+	/* on save, GuC buffer may be already in use by the pending GuC save */
+	if (stream->hdr.type == IOV_STATE_SECTION_GUC)
+		stream_release_vma(stream);
+	stream->hdr = (struct iov_state_section) {};
+	stream->pos = 0;
+	stream->section++;
+}
+
+static int stream_save_payload(struct intel_iov_state_stream *stream, u64 offset,
+			       void *buf, u32 len)
+{
+	int err;
+
+	switch (stream->hdr.type) {
+	case IOV_STATE_SECTION_GGTT:
+		if (offset == stream->chunk_offset + stream->chunk_len) {
+			stream->chunk_offset = offset;
+			stream->chunk_len = min_t(u64, IOV_STATE_STREAM_CHUNK_SIZE,
+						  stream->hdr.size - offset);
+			err = stream_ggtt_save_chunk(stream, offset, stream->chunk,
+						     stream->chunk_len);
+			if (err)
+				return err;
+		}
+		len = min_t(u32, len, stream->chunk_offset + stream->chunk_len - offset);
+		memcpy(buf, stream->chunk + (offset - stream->chunk_offset), len);
+		break;
+	case IOV_STATE_SECTION_GUC:
+		memcpy(buf, stream->blob + offset, len);
+		break;
+	default:
+		MISSING_CASE(stream->hdr.type);
+		return -EINVAL;
+	}
+
+	return len;
+}
+
+static int stream_restore_open_section(struct intel_iov_state_stream *stream)
+{
+	struct iov_state_section *hdr = &stream->hdr;
+	struct intel_iov *iov = stream->iov;
+	struct drm_mm_node *node = &iov->pf.provisioning.configs[stream->vfid].ggtt_region;
+	struct intel_runtime_pm *rpm = iov_to_gt(iov)->uncore->rpm;
+	intel_wakeref_t wakeref;
+	int err = 0;
+
+	if (hdr->mbz || !hdr->size)
+		return -EPROTO;
+
+	switch (hdr->type) {
+	case IOV_STATE_SECTION_GGTT:
+		if (!stream_has_ggtt(stream) || !IS_ALIGNED(hdr->size, sizeof(gen8_pte_t)))
+			return -EPROTO;
+		mutex_lock(pf_provisioning_mutex(iov));
+		if (!drm_mm_node_allocated(node) ||
+		    ggtt_size_to_ptes_size(node->size) != hdr->size)
+			err = -ENOSPC;
+		mutex_unlock(pf_provisioning_mutex(iov));
+		stream->chunk_offset = 0;
+		stream->chunk_len = 0;
+		stream->ggtt_dirty = !err;
+		break;
+	case IOV_STATE_SECTION_GUC:
+		if (!IS_ALIGNED(hdr->size, sizeof(u32)))
+			return -EPROTO;
+		err = -ENONET;
+		with_intel_runtime_pm(rpm, wakeref)
+			err = stream_guc_state_size(stream);
+		if (err < 0)
+			return err;
+		/* GuC never saves more than it reports for the VF */
+		if (hdr->size > max_t(u32, err, PF2GUC_SAVE_RESTORE_VF_BUFF_MIN_SIZE))
+			return -EMSGSIZE;
+		err = stream_alloc_vma(stream, hdr->size);
+		break;
+	default:
+		return -EPROTO;
+	}
+
+	return err;
+}
+
+static int stream_restore_payload(struct intel_iov_state_stream *stream, u64 offset,
+				  const void *buf, u32 len)
+{
+	int err;
+
+	switch (stream->hdr.type) {
+	case IOV_STATE_SECTION_GGTT:
+		len = min_t(u32, len, IOV_STATE_STREAM_CHUNK_SIZE - stream->chunk_len);
+		memcpy(stream->chunk + stream->chunk_len, buf, len);
+		stream->chunk_len += len;
+
+		if (stream->chunk_len == IOV_STATE_STREAM_CHUNK_SIZE ||
+		    offset + len == stream->hdr.size) {
+			err = stream_ggtt_restore_chunk(stream, stream->chunk_offset,
+							stream->chunk, stream->chunk_len);
+			if (err)
+				return err;
+			stream->chunk_offset += stream->chunk_len;
+			stream->chunk_len = 0;
+		}
+		break;
+	case IOV_STATE_SECTION_GUC:
+		memcpy(stream->blob + offset, buf, len);
+		break;
+	default:
+		MISSING_CASE(stream->hdr.type);
+		return -EINVAL;
+	}
+
+	return len;
+}
+
+static int stream_restore_close_section(struct intel_iov_state_stream *stream)
+{
+	int err;
+
+	switch (stream->hdr.type) {
+	case IOV_STATE_SECTION_GGTT:
+		err = stream_ggtt_restore_sync(stream);
+		break;
+	case IOV_STATE_SECTION_GUC:
+		err = stream_guc_restore(stream);
+		break;
+	default:
+		MISSING_CASE(stream->hdr.type);
+		err = -EINVAL;
+	}
+
+	stream_close_section(stream);
+	return err;
+}
+
+static struct intel_iov_state_stream *
+stream_create(struct intel_iov *iov, u32 vfid, bool restore)
+{
+	struct intel_iov_state_stream *stream;
+
+	GEM_BUG_ON(!intel_iov_is_pf(iov));
+
+	if (!vfid || vfid > pf_get_totalvfs(iov))
+		return ERR_PTR(-EINVAL);
+
+	stream = kzalloc(sizeof(*stream), GFP_KERNEL);
+	if (!stream)
+		return ERR_PTR(-ENOMEM);
+
+	stream->chunk = kvmalloc(IOV_STATE_STREAM_CHUNK_SIZE, GFP_KERNEL);
+	if (!stream->chunk) {
+		kfree(stream);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	stream->iov = iov;
+	stream->vfid = vfid;
+	stream->restore = restore;
+
+	return stream;
+}
+
+static void stream_destroy(struct intel_iov_state_stream *stream)
+{
+	if (!stream->restore)
+		flush_work(&stream->guc_save_work);
+	stream_release_vma(stream);
+	kvfree(stream->chunk);
+	kfree(stream);
+}
+
+/**
+ * intel_iov_state_save_begin - Start streaming VF migration state.
+ * @iov: the IOV struct
+ * @vfid: VF identifier
+ *
+ * The GuC state save is started right away, in the background, so the VF
+ * must already be paused.
+ *
+ * This function is for PF only.
+ *
+ * Return: new stream on success or an ERR_PTR on failure.
+ */
+struct intel_iov_state_stream *intel_iov_state_save_begin(struct intel_iov *iov, u32 vfid)
+{
+	struct intel_iov_state_stream *stream;
+	int err;
+
+	stream = stream_create(iov, vfid, false);
+	if (IS_ERR(stream))
+		return stream;
+
+	INIT_WORK(&stream->guc_save_work, stream_guc_save_work);
+	queue_work(system_unbound_wq, &stream->guc_save_work);
+
+	err = stream_save_open_section(stream);
+	if (err) {
+		stream_destroy(stream);
+		return ERR_PTR(err);
+	}
+
+	return stream;
+}
+
+/**
+ * intel_iov_state_save_next_chunk - Read next chunk of VF migration state.
+ * @stream: the stream from intel_iov_state_save_begin()
+ * @buf: buffer to save the chunk
+ * @size: size of the buffer (in bytes)
+ *
+ * This function is for PF only.
+ *
+ * Return: size of data written (in bytes), 0 if there is no more data,
+ *         or a negative error code on failure.
+ */
+ssize_t intel_iov_state_save_next_chunk(struct intel_iov_state_stream *stream,
+					void *buf, size_t size)
+{
+	size_t done = 0;
+	int ret;
+
+	GEM_BUG_ON(stream->restore);
+
+	while (done < size && stream->section < ARRAY_SIZE(stream_sections)) {
+		size_t left = size - done;
+
+		if (stream->pos < sizeof(stream->hdr)) {
+			ret = min_t(size_t, sizeof(stream->hdr) - stream->pos, left);
+			memcpy(buf + done, (void *)&stream->hdr + stream->pos, ret);
+		} else {
+			u64 offset = stream->pos - sizeof(stream->hdr);
+
+			ret = stream_save_payload(stream, offset, buf + done,
+						  min_t(u64, stream->hdr.size - offset,
+							min_t(size_t, left, SZ_1G)));
+			if (ret < 0)
+				return ret;
+		}
+
+		stream->pos += ret;
+		done += ret;
+
+		if (stream->pos == sizeof(stream->hdr) + stream->hdr.size) {
+			stream_close_section(stream);
+			ret = stream_save_open_section(stream);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return done;
+}
+
+/**
+ * intel_iov_state_save_end - Finish streaming VF migration state.
+ * @stream: the stream from intel_iov_state_save_begin()
+ *
+ * This function is for PF only.
+ */
+void intel_iov_state_save_end(struct intel_iov_state_stream *stream)
+{
+	GEM_BUG_ON(stream->restore);
+	stream_destroy(stream);
+}
+
+/**
+ * intel_iov_state_restore_begin - Start restoring VF migration state.
+ * @iov: the IOV struct
+ * @vfid: VF identifier
+ *
+ * This function is for PF only.
+ *
+ * Return: new stream on success or an ERR_PTR on failure.
+ */
+struct intel_iov_state_stream *intel_iov_state_restore_begin(struct intel_iov *iov, u32 vfid)
+{
+	return stream_create(iov, vfid, true);
+}
+
+/**
+ * intel_iov_state_restore_next_chunk - Write next chunk of VF migration state.
+ * @stream: the stream from intel_iov_state_restore_begin()
+ * @buf: buffer with the chunk
+ * @size: size of the chunk (in bytes)
+ *
+ * Chunks may be split at any byte boundary, but must be passed in the order
+ * they were returned by intel_iov_state_save_next_chunk().
+ *
+ * This function is for PF only.
+ *
+ * Return: size of data consumed (in bytes) or a negative error code on failure.
+ */
+ssize_t intel_iov_state_restore_next_chunk(struct intel_iov_state_stream *stream,
+					   const void *buf, size_t size)
+{
+	size_t done = 0;
+	int ret;
+
+	GEM_BUG_ON(!stream->restore);
+
+	while (done < size) {
+		size_t left = size - done;
+
+		if (stream->pos < sizeof(stream->hdr)) {
+			ret = min_t(size_t, sizeof(stream->hdr) - stream->pos, left);
+			memcpy((void *)&stream->hdr + stream->pos, buf + done, ret);
+			stream->pos += ret;
+			done += ret;
+
+			if (stream->pos == sizeof(stream->hdr)) {
+				ret = stream_restore_open_section(stream);
+				if (ret)
+					return ret;
+			}
+			continue;
+		}
+
+		ret = stream_restore_payload(stream, stream->pos - sizeof(stream->hdr),
+					     buf + done,
+					     min_t(u64, stream->hdr.size + sizeof(stream->hdr) -
+						   stream->pos, min_t(size_t, left, SZ_1G)));
+		if (ret < 0)
+			return ret;
+
+		stream->pos += ret;
+		done += ret;
+
+		if (stream->pos == sizeof(stream->hdr) + stream->hdr.size) {
+			ret = stream_restore_close_section(stream);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return done;
+}
+
+/**
+ * intel_iov_state_restore_end - Finish restoring VF migration state.
+ * @stream: the stream from intel_iov_state_restore_begin()
+ *
+ * This function is for PF only.
+ *
+ * Return: 0 on success, -ENODATA if the stream was truncated.
+ */
+int intel_iov_state_restore_end(struct intel_iov_state_stream *stream)
+{
+	int err = stream->pos ? -ENODATA : 0;
+
+	GEM_BUG_ON(!stream->restore);
+
+	if (err)
+		IOV_ERROR(stream->iov, "VF%u state stream truncated (%pe)\n",
+			  stream->vfid, ERR_PTR(err));
+
+	if (stream->ggtt_dirty)
+		stream_ggtt_restore_abort(stream);
+
+	stream_destroy(stream);
+	return err;
+}
+
+#if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
+#include "selftests/selftest_mock_iov_state.c"
+#endif
@@ -8,7 +8,9 @@
 
 #include <linux/types.h>
 
+struct drm_printer;
 struct intel_iov;
+struct intel_iov_state_stream;
 
 void intel_iov_state_init_early(struct intel_iov *iov);
 void intel_iov_state_release(struct intel_iov *iov);
@@ -25,10 +27,26 @@ int intel_iov_state_stop_vf(struct intel_iov *iov, u32 vfid);
 int intel_iov_state_save_vf_size(struct intel_iov *iov, u32 vfid);
 ssize_t intel_iov_state_save_ggtt(struct intel_iov *iov, u32 vfid, void *buf, size_t size);
 int intel_iov_state_restore_ggtt(struct intel_iov *iov, u32 vfid, const void *buf, size_t size);
+ssize_t intel_iov_state_save_ggtt_dirty(struct intel_iov *iov, u32 vfid, void *buf, size_t size);
+int intel_iov_state_clear_ggtt_dirty(struct intel_iov *iov, u32 vfid);
+int intel_iov_state_restore_ggtt_dirty(struct intel_iov *iov, u32 vfid,
+				       const void *buf, size_t size);
 int intel_iov_state_save_vf(struct intel_iov *iov, u32 vfid, void *buf, size_t size);
 int intel_iov_state_restore_vf(struct intel_iov *iov, u32 vfid, const void *buf, size_t size);
 int intel_iov_state_store_guc_migration_state(struct intel_iov *iov, u32 vfid,
 					      const void *buf, size_t size);
+int intel_iov_state_staging_init(struct intel_iov *iov, unsigned int num_vfs, u32 slot_size);
+void intel_iov_state_staging_fini(struct intel_iov *iov);
+int intel_iov_state_print_timings(struct intel_iov *iov, struct drm_printer *p);
+
+struct intel_iov_state_stream *intel_iov_state_save_begin(struct intel_iov *iov, u32 vfid);
+ssize_t intel_iov_state_save_next_chunk(struct intel_iov_state_stream *stream,
+					void *buf, size_t size);
+void intel_iov_state_save_end(struct intel_iov_state_stream *stream);
+struct intel_iov_state_stream *intel_iov_state_restore_begin(struct intel_iov *iov, u32 vfid);
+ssize_t intel_iov_state_restore_next_chunk(struct intel_iov_state_stream *stream,
+					   const void *buf, size_t size);
+int intel_iov_state_restore_end(struct intel_iov_state_stream *stream);
 
 int intel_iov_state_process_guc2pf(struct intel_iov *iov,
 				   const u32 *msg, u32 len);
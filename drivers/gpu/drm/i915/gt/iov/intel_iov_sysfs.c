@@ -4,6 +4,7 @@
  */
 
 #include "intel_iov_provisioning.h"
+#include "intel_iov_sched.h"
 #include "intel_iov_state.h"
 #include "intel_iov_sysfs.h"
 #include "intel_iov_types.h"
@@ -191,6 +192,55 @@ static ssize_t doorbells_spare_iov_attr_store(struct intel_iov *iov,
 	return err ?: count;
 }
 
+static ssize_t staged_provisioning_iov_attr_show(struct intel_iov *iov,
+						 unsigned int id, char *buf)
+{
+	GEM_WARN_ON(id);
+	return sysfs_emit(buf, "%u\n", intel_iov_provisioning_is_staging(iov));
+}
+
+static ssize_t staged_provisioning_iov_attr_store(struct intel_iov *iov,
+						  unsigned int id,
+						  const char *buf, size_t count)
+{
+	bool value;
+	int err;
+
+	err = kstrtobool(buf, &value);
+	if (err)
+		return err;
+
+	GEM_WARN_ON(id);
+	if (value)
+		err = intel_iov_provisioning_stage(iov);
+	else
+		err = intel_iov_provisioning_commit(iov);
+	return err ?: count;
+}
+
+static ssize_t sched_controller_iov_attr_show(struct intel_iov *iov,
+					      unsigned int id, char *buf)
+{
+	GEM_WARN_ON(id);
+	return sysfs_emit(buf, "%u\n", intel_iov_sched_is_enabled(iov));
+}
+
+static ssize_t sched_controller_iov_attr_store(struct intel_iov *iov,
+					       unsigned int id,
+					       const char *buf, size_t count)
+{
+	bool value;
+	int err;
+
+	err = kstrtobool(buf, &value);
+	if (err)
+		return err;
+
+	GEM_WARN_ON(id);
+	err = intel_iov_sched_set_enabled(iov, value);
+	return err ?: count;
+}
+
 static ssize_t ggtt_free_iov_attr_show(struct intel_iov *iov,
 				       unsigned int id, char *buf)
 {
@@ -303,6 +353,8 @@ static ssize_t sample_period_ms_iov_attr_store(struct intel_iov *iov,
 IOV_ATTR(ggtt_spare);
 IOV_ATTR(contexts_spare);
 IOV_ATTR(doorbells_spare);
+IOV_ATTR(staged_provisioning);
+IOV_ATTR(sched_controller);
 
 IOV_ATTR_RO(ggtt_free);
 IOV_ATTR_RO(ggtt_max_quota);
@@ -319,6 +371,8 @@ static struct attribute *pf_attrs[] = {
 	&ggtt_spare_iov_attr.attr,
 	&contexts_spare_iov_attr.attr,
 	&doorbells_spare_iov_attr.attr,
+	&staged_provisioning_iov_attr.attr,
+	&sched_controller_iov_attr.attr,
 	NULL
 };
 
@@ -475,6 +529,88 @@ static struct attribute *vf_threshold_attrs[] = {
 	NULL
 };
 
+static ssize_t exec_quantum_min_ms_iov_attr_show(struct intel_iov *iov,
+						 unsigned int id, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", intel_iov_sched_get_min_exec_quantum(iov, id));
+}
+
+static ssize_t exec_quantum_min_ms_iov_attr_store(struct intel_iov *iov,
+						  unsigned int id,
+						  const char *buf, size_t count)
+{
+	u32 value;
+	int err;
+
+	err = kstrtou32(buf, 0, &value);
+	if (err)
+		return err;
+
+	err = intel_iov_sched_set_min_exec_quantum(iov, id, value);
+	return err ?: count;
+}
+
+static ssize_t exec_quantum_max_ms_iov_attr_show(struct intel_iov *iov,
+						 unsigned int id, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", intel_iov_sched_get_max_exec_quantum(iov, id));
+}
+
+static ssize_t exec_quantum_max_ms_iov_attr_store(struct intel_iov *iov,
+						  unsigned int id,
+						  const char *buf, size_t count)
+{
+	u32 value;
+	int err;
+
+	err = kstrtou32(buf, 0, &value);
+	if (err)
+		return err;
+
+	err = intel_iov_sched_set_max_exec_quantum(iov, id, value);
+	return err ?: count;
+}
+
+static ssize_t share_iov_attr_show(struct intel_iov *iov,
+				   unsigned int id, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", intel_iov_sched_get_share(iov, id));
+}
+
+static ssize_t share_iov_attr_store(struct intel_iov *iov,
+				    unsigned int id,
+				    const char *buf, size_t count)
+{
+	u32 value;
+	int err;
+
+	err = kstrtou32(buf, 0, &value);
+	if (err)
+		return err;
+
+	err = intel_iov_sched_set_share(iov, id, value);
+	return err ?: count;
+}
+
+static ssize_t busyness_iov_attr_show(struct intel_iov *iov,
+				      unsigned int id, char *buf)
+{
+	return sysfs_emit(buf, "%u\n", intel_iov_sched_get_busyness(iov, id));
+}
+
+IOV_ATTR(exec_quantum_min_ms);
+IOV_ATTR(exec_quantum_max_ms);
+IOV_ATTR(share);
+IOV_ATTR_RO(busyness);
+
+static struct attribute *vf_sched_attrs[] = {
+	&exec_quantum_min_ms_iov_attr.attr,
+	&exec_quantum_max_ms_iov_attr.attr,
+	&share_iov_attr.attr,
+	&busyness_iov_attr.attr,
+	NULL
+};
+
 static umode_t vf_attr_is_visible(struct kobject *kobj,
 				  struct attribute *attr, int index)
 {
@@ -540,9 +676,15 @@ static const struct attribute_group vf_threshold_attr_group = {
 	.attrs = vf_threshold_attrs,
 };
 
+static const struct attribute_group vf_sched_attr_group = {
+	.name = "sched",
+	.attrs = vf_sched_attrs,
+};
+
 static const struct attribute_group *vf_attr_groups[] = {
 	&vf_attr_group,
 	&vf_threshold_attr_group,
+	&vf_sched_attr_group,
 	NULL
 };
 
@@ -6,10 +6,13 @@
 #ifndef __INTEL_IOV_TYPES_H__
 #define __INTEL_IOV_TYPES_H__
 
+#include <linux/completion.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
+#include <linux/xarray.h>
 #include <drm/drm_mm.h>
 #include "abi/iov_actions_abi.h"
+#include "gt/iov/intel_iov_reg.h"
 #include "gt/intel_gtt.h"
 #include "i915_reg.h"
 #include "i915_selftest.h"
@@ -48,6 +51,8 @@ IOV_THRESHOLDS(__to_intel_iov_threshold_enum)
  * @num_dbs: number of GuC doorbells.
  * @begin_db: start index of GuC doorbells.
  * @exec_quantum: execution-quantum in milliseconds.
+ * @exec_quantum_tuned: execution-quantum set by the scheduling controller
+ *                      in milliseconds, 0 if @exec_quantum is used.
  * @preempt_timeout: preemption timeout in microseconds.
  * @thresholds: FIXME missing docs
  */
@@ -58,6 +63,7 @@ struct intel_iov_config {
 	u16 num_dbs;
 	u16 begin_db;
 	u32 exec_quantum;
+	u32 exec_quantum_tuned;
 	u32 preempt_timeout;
 	u32 thresholds[IOV_THRESHOLD_MAX];
 };
@@ -94,38 +100,149 @@ struct intel_iov_policies {
 	u32 sample_period;
 };
 
+#define IOV_PROFILE_NAME_LEN	16
+#define IOV_MAX_PROFILES	8
+
+/**
+ * struct intel_iov_profile_vf - VF parameters of the provisioning profile.
+ * @weight: share of GGTT, contexts and doorbells relative to other VFs.
+ * @exec_quantum: execution quantum in ms (0 = unlimited).
+ * @preempt_timeout: preemption timeout in us (0 = unlimited).
+ */
+struct intel_iov_profile_vf {
+	u16 weight;
+	u32 exec_quantum;
+	u32 preempt_timeout;
+};
+
+/**
+ * struct intel_iov_profile - Named VFs auto-provisioning profile.
+ * @name: name of the profile.
+ * @num_vfs: number of VFs described by the profile.
+ * @vfs: parameters of the VFs, any other VFs are given weight 1.
+ */
+struct intel_iov_profile {
+	char name[IOV_PROFILE_NAME_LEN];
+	unsigned int num_vfs;
+	struct intel_iov_profile_vf vfs[];
+};
+
 /**
  * struct intel_iov_provisioning - IOV provisioning data.
  * @auto_mode: indicates manual or automatic provisioning mode.
+ * @staging: VF provisioning changes are being staged (root tile only).
  * @num_pushed: FIXME missing doc
+ * @num_deferred: number of VF configs to push on commit of staged changes.
  * @worker: FIXME missing doc
  * @policies: provisioning policies.
  * @spare: spare resources configuration
  * @configs: flexible array with configuration data for PF and VFs.
  * @lock: protects provisionining data
+ * @profiles: named auto-provisioning profiles (root tile only).
+ * @profile: profile used by auto-provisioning, NULL for a fair split.
  * @self_done: FIXME missing doc
  */
 struct intel_iov_provisioning {
 	bool auto_mode;
+	bool staging;
 	unsigned int num_pushed;
+	unsigned int num_deferred;
 	struct work_struct worker;
 	struct intel_iov_policies policies;
 	struct intel_iov_spare_config spare;
 	struct intel_iov_config *configs;
 	struct mutex lock;
+	struct intel_iov_profile *profiles[IOV_MAX_PROFILES];
+	struct intel_iov_profile *profile;
 
 	bool self_done;
+
+	I915_SELFTEST_DECLARE(struct {
+		/**
+		 * @selftest.mock_push_config: pointer to a function used to
+		 * mock GuC VF config update action of a single VF.
+		 */
+		int (*mock_push_config)(struct intel_iov *, u32, const u32 *, u32);
+		/** @selftest.data: private data of the mock. */
+		void *data;
+	} selftest);
 };
 
 #define VFID(n)		(n)
 #define PFID		VFID(0)
 
+/**
+ * enum intel_iov_vf_stat - VF control-plane traffic counters.
+ * @IOV_VF_STAT_RELAY_MSGS: number of relay requests received from the VF
+ * @IOV_VF_STAT_RELAY_BYTES: size of relay requests received from the VF (in bytes)
+ * @IOV_VF_STAT_RUNTIME_QUERIES: number of runtime registers queries
+ * @IOV_VF_STAT_GGTT_PTES: number of GGTT PTEs written on behalf of the VF
+ * @IOV_VF_STAT_LATENCY_10US: requests serviced in less than 10us
+ * @IOV_VF_STAT_LATENCY_100US: requests serviced in less than 100us
+ * @IOV_VF_STAT_LATENCY_1MS: requests serviced in less than 1ms
+ * @IOV_VF_STAT_LATENCY_SLOW: requests serviced in 1ms or more
+ * @IOV_VF_STAT_MAX: number of counters
+ */
+enum intel_iov_vf_stat {
+	IOV_VF_STAT_RELAY_MSGS,
+	IOV_VF_STAT_RELAY_BYTES,
+	IOV_VF_STAT_RUNTIME_QUERIES,
+	IOV_VF_STAT_GGTT_PTES,
+	IOV_VF_STAT_LATENCY_10US,
+	IOV_VF_STAT_LATENCY_100US,
+	IOV_VF_STAT_LATENCY_1MS,
+	IOV_VF_STAT_LATENCY_SLOW,
+	IOV_VF_STAT_MAX
+};
+
+#define IOV_EVENT_LOG_SIZE		32
+#define IOV_EVENT_ENGINE_UNKNOWN	(~0u)
+
+/**
+ * struct intel_iov_event_record - Timestamped VF adverse event.
+ * @seq: sequence number of the event in the VF log, starting from 1.
+ * @timestamp: CLOCK_MONOTONIC time of the event (in ns).
+ * @vfid: VF identifier.
+ * @threshold: GuC KLV key of the exceeded threshold.
+ * @engine: engine class and instance, or IOV_EVENT_ENGINE_UNKNOWN.
+ * @value: value of the threshold at the time of the event.
+ *
+ * This is also the layout of the records in the adverse_events_log debugfs.
+ */
+struct intel_iov_event_record {
+	u64 seq;
+	u64 timestamp;
+	u32 vfid;
+	u32 threshold;
+	u32 engine;
+	u32 value;
+};
+
+/**
+ * struct intel_iov_event_log - Ring of most recent VF adverse events.
+ * @head: sequence number of the last recorded event.
+ * @last_uevent: time of the last uevent sent for this VF (in jiffies).
+ * @records: the ring, indexed by the event sequence number.
+ *
+ * Events are recorded only by the G2H handler, while readers validate each
+ * record by its sequence number, so there is no lock.
+ */
+struct intel_iov_event_log {
+	atomic64_t head;
+	unsigned long last_uevent;
+	struct intel_iov_event_record records[IOV_EVENT_LOG_SIZE];
+};
+
 /**
  * struct intel_iov_data - Data related to one VF.
  * @state: VF state bits
  * @paused: FIXME missing doc
  * @adverse_events: FIXME missing doc
+ * @events: log of recent adverse events
  * @guc_state: pointer to VF state from GuC
+ * @guc_state.save_us: duration of the last GuC state save (in us)
+ * @guc_state.restore_us: duration of the last GuC state restore (in us)
+ * @stats: control-plane traffic counters, see &enum intel_iov_vf_stat
  */
 struct intel_iov_data {
 	unsigned long state;
@@ -139,20 +256,196 @@ struct intel_iov_data {
 #define IOV_VF_FLR_FAILED		(BITS_PER_LONG - 1)
 	bool paused;
 	unsigned int adverse_events[IOV_THRESHOLD_MAX];
+	struct intel_iov_event_log events;
 	struct {
 		void *blob;
 		u32 size;
+		u32 save_us;
+		u32 restore_us;
 	} guc_state;
+	u64 stats[IOV_VF_STAT_MAX];
+};
+
+/**
+ * struct intel_iov_state_staging - GuC buffer shared by VFs state save/restore.
+ * @vma: GuC VMA divided into per-VF slots
+ * @vaddr: CPU mapping of the @vma
+ * @slot_size: size of the single VF slot (in bytes)
+ * @num_slots: number of VF slots
+ */
+struct intel_iov_state_staging {
+	struct i915_vma *vma;
+	void *vaddr;
+	u32 slot_size;
+	unsigned int num_slots;
+};
+
+/**
+ * enum intel_iov_flr_phase - VF FLR phases reported by the tracepoint.
+ * @IOV_FLR_PHASE_NOTIFY: FLR notification received from the GuC
+ * @IOV_FLR_PHASE_START: START FLR request accepted by the GuC
+ * @IOV_FLR_PHASE_DONE: FLR DONE notification received from the GuC
+ * @IOV_FLR_PHASE_FINISH: FINISH FLR request accepted by the GuC
+ * @IOV_FLR_PHASE_COMPLETE: FLR sequence completed
+ * @IOV_FLR_PHASE_FAILED: FLR sequence aborted
+ */
+enum intel_iov_flr_phase {
+	IOV_FLR_PHASE_NOTIFY,
+	IOV_FLR_PHASE_START,
+	IOV_FLR_PHASE_DONE,
+	IOV_FLR_PHASE_FINISH,
+	IOV_FLR_PHASE_COMPLETE,
+	IOV_FLR_PHASE_FAILED,
 };
 
 /**
  * struct intel_iov_state - Placeholder for all VFs data.
  * @worker: event processing worker
+ * @pending: bitmap of VFs with pending events to be processed by the worker
  * @data: FIXME missing doc
+ * @staging: GuC buffer used to save/restore all VFs at once
+ * @selftest: IOV state selftests data
  */
 struct intel_iov_state {
 	struct work_struct worker;
+	unsigned long *pending;
 	struct intel_iov_data *data;
+	struct intel_iov_state_staging staging;
+
+	I915_SELFTEST_DECLARE(struct {
+		/**
+		 * @selftest.mock_save_restore: pointer to a function used to
+		 * mock GuC VF save/restore action of the migration stream.
+		 */
+		int (*mock_save_restore)(struct intel_iov *, u32, u32, void *, u32);
+		/** @selftest.data: private data of the mock. */
+		void *data;
+	} selftest);
+};
+
+#define IOV_SNAPSHOT_MAGIC		0x50564f49 /* "IOVP" */
+#define IOV_SNAPSHOT_VERSION		1
+#define IOV_SNAPSHOT_FLAG_AUTO_MODE	BIT(0)
+#define IOV_SNAPSHOT_FLAG_STAGING	BIT(1)
+#define IOV_SNAPSHOT_FLAG_SCHED_IF_IDLE	BIT(2)
+#define IOV_SNAPSHOT_FLAG_RESET_ENGINE	BIT(3)
+
+/**
+ * struct intel_iov_snapshot_header - Header of the PF provisioning snapshot.
+ * @magic: IOV_SNAPSHOT_MAGIC.
+ * @version: IOV_SNAPSHOT_VERSION, bumped on any incompatible layout change.
+ * @header_size: size of this header (in bytes).
+ * @entry_size: size of each &intel_iov_snapshot_entry (in bytes).
+ * @num_entries: number of entries that follow, PF first then VF1..VFn.
+ * @num_vfs: number of currently enabled VFs.
+ * @gt_id: GT id.
+ * @flags: combination of IOV_SNAPSHOT_FLAG_* bits.
+ * @num_pushed: number of VF configurations pushed to the GuC.
+ * @sample_period: sample period policy (in ms).
+ * @num_thresholds: number of thresholds and adverse events in each entry.
+ * @num_stats: number of counters in each entry.
+ * @spare_ggtt: PF spare GGTT size (in bytes).
+ * @spare_ctxs: number of PF spare contexts.
+ * @spare_dbs: number of PF spare doorbells.
+ * @timestamp: time when the snapshot was taken (in ns, monotonic).
+ */
+struct intel_iov_snapshot_header {
+	u32 magic;
+	u16 version;
+	u16 header_size;
+	u16 entry_size;
+	u16 num_entries;
+	u16 num_vfs;
+	u16 gt_id;
+	u32 flags;
+	u32 num_pushed;
+	u32 sample_period;
+	u16 num_thresholds;
+	u16 num_stats;
+	u64 spare_ggtt;
+	u16 spare_ctxs;
+	u16 spare_dbs;
+	u32 reserved;
+	u64 timestamp;
+} __packed;
+
+/**
+ * struct intel_iov_snapshot_entry - PF or VF entry of the provisioning snapshot.
+ * @ggtt_start: start of the provisioned GGTT range.
+ * @ggtt_size: size of the provisioned GGTT range (in bytes).
+ * @begin_ctx: first provisioned context id.
+ * @num_ctxs: number of provisioned contexts.
+ * @begin_db: first provisioned doorbell id.
+ * @num_dbs: number of provisioned doorbells.
+ * @exec_quantum: execution quantum (in ms).
+ * @preempt_timeout: preemption timeout (in us).
+ * @thresholds: adverse event thresholds, indexed by &intel_iov_threshold.
+ * @adverse_events: adverse events counters, indexed by &intel_iov_threshold.
+ * @stats: VF counters, indexed by &intel_iov_vf_stat.
+ */
+struct intel_iov_snapshot_entry {
+	u64 ggtt_start;
+	u64 ggtt_size;
+	u16 begin_ctx;
+	u16 num_ctxs;
+	u16 begin_db;
+	u16 num_dbs;
+	u32 exec_quantum;
+	u32 preempt_timeout;
+	u32 thresholds[IOV_THRESHOLD_MAX];
+	u32 adverse_events[IOV_THRESHOLD_MAX];
+	u64 stats[IOV_VF_STAT_MAX];
+} __packed;
+
+/**
+ * struct intel_iov_sched_vf - Per-VF data of the scheduling controller.
+ * @min_exec_quantum: lower bound of the execution quantum (in ms).
+ * @max_exec_quantum: upper bound of the execution quantum (in ms),
+ *                    0 if VF execution quantum is not controlled.
+ * @share: target share of the engines time (in percent), 0 for fair share.
+ * @begin_ctx: start of the VF contexts range sampled in current period.
+ * @num_ctxs: size of the VF contexts range sampled in current period.
+ * @busy: number of samples in current period with VF context running.
+ * @busyness: share of the engines time used in last period (in percent).
+ */
+struct intel_iov_sched_vf {
+	u32 min_exec_quantum;
+	u32 max_exec_quantum;
+	u32 share;
+	u16 begin_ctx;
+	u16 num_ctxs;
+	u32 busy;
+	u32 busyness;
+};
+
+/**
+ * struct intel_iov_sched - PF scheduling controller.
+ * @worker: samples engines usage and adjusts VFs execution quanta.
+ * @vfs: per-VF controller data, indexed by VF id.
+ * @samples: number of samples taken in current period.
+ * @period_end: end of the current period (in jiffies).
+ * @enabled: whether the controller is running.
+ */
+struct intel_iov_sched {
+	struct delayed_work worker;
+	struct intel_iov_sched_vf *vfs;
+	u32 samples;
+	unsigned long period_end;
+	bool enabled;
+};
+
+/**
+ * struct intel_iov_runtime_snapshot - Immutable snapshot of runtime registers.
+ * @rcu: used to defer release of the replaced snapshot.
+ * @generation: non-zero generation stamp of this snapshot.
+ * @count: number of register entries in @data.
+ * @data: register offset/value pairs, as sent to the VFs.
+ */
+struct intel_iov_runtime_snapshot {
+	struct rcu_head rcu;
+	u32 generation;
+	u32 count;
+	u32 data[];
 };
 
 /**
@@ -160,11 +453,15 @@ struct intel_iov_state {
  * @size: size of the regs and value arrays.
  * @regs: pointer to static array with register offsets.
  * @values: pointer to array with captured register values.
+ * @snapshot: currently published snapshot of the register values.
+ * @generation: generation of the most recently published snapshot.
  */
 struct intel_iov_runtime_regs {
 	u32 size;
 	const i915_reg_t *regs;
 	u32 *values;
+	struct intel_iov_runtime_snapshot __rcu *snapshot;
+	atomic_t generation;
 };
 
 /**
@@ -177,10 +474,12 @@ struct intel_iov_service {
 
 /**
  * struct intel_iov_vf_runtime - Placeholder for the VF runtime data.
+ * @generation: generation of the PF snapshot held in @regs (0 if unknown).
  * @regs_size: size of runtime register array.
  * @regs: pointer to array of register offset/value pairs.
  */
 struct intel_iov_vf_runtime {
+	u32 generation;
 	u32 regs_size;
 	struct vf_runtime_reg {
 		u32 offset;
@@ -188,6 +487,7 @@ struct intel_iov_vf_runtime {
 	} *regs;
 };
 
+struct intel_engine_cs;
 struct intel_iov;
 
 /**
@@ -195,11 +495,16 @@ struct intel_iov;
  * @ptes: pointer to a buffer that stores the GGTT PTEs of a specific VF.
  * @ggtt_region: pointer to the ggtt_region assigned to a specific VF during provisioning.
  * @vfid: vfid VF, to which the data in this structure belongs.
+ * @staging: preallocated buffer used to batch PTEs requested by the VF.
+ * @dirty: bitmap of PTEs modified since the last save or clear of dirty PTEs.
  */
 struct intel_iov_ggtt_shadow {
 	gen8_pte_t *ptes;
 	struct drm_mm_node *ggtt_region;
 	unsigned int vfid;
+	gen8_pte_t *staging;
+	unsigned long *dirty;
+#define IOV_GGTT_STAGING_PTES	SZ_2K
 };
 
 /**
@@ -215,11 +520,91 @@ struct intel_iov_pf_ggtt {
 		 * updates by the GPU. (For selftest purposes only)
 		 */
 		int (*mock_update_ptes)(struct intel_iov *, struct sg_table *, gen8_pte_t);
+		/**
+		 * @selftest.mock_write_ptes: pointer to a function used to mock
+		 * direct GGTT writes of already encoded PTEs.
+		 */
+		int (*mock_write_ptes)(struct intel_iov *, u64, const gen8_pte_t *, u32);
+		/**
+		 * @selftest.mock_set_space_owner: pointer to a function used to mock
+		 * GGTT space ownership updates.
+		 */
+		void (*mock_set_space_owner)(struct intel_iov *, u16, const struct drm_mm_node *);
 		/** @selftest.ptes: GGTT storage buffer during selftests.*/
 		gen8_pte_t *ptes;
 	} selftest);
 };
 
+/**
+ * struct intel_iov_relay_pending - Relay request that awaits a response.
+ * @replies: number of received non-final responses (busy or retry).
+ * @final: set once the final response was received and claimed.
+ * @target: target VF number (0 if request was sent to the PF).
+ * @fence: relay message ID used to match the response.
+ * @reply: status of the response.
+ * @response: placeholder for the response message (can't be NULL).
+ * @response_size: size of the response placeholder (in dwords).
+ * @msg: request message (must stay valid until request is completed).
+ * @len: length of the request message (in dwords).
+ */
+struct intel_iov_relay_pending {
+	unsigned int replies;
+	bool final;
+	u32 target;
+	u32 fence;
+	int reply;
+	u32 *response;
+	u32 response_size;
+	const u32 *msg;
+	u32 len;
+};
+
+/**
+ * struct intel_iov_vf_ggtt_inflight - VF GGTT update request awaiting PF ack.
+ * @pending: relay request tracking data.
+ * @request: encoded VF2PF_UPDATE_GGTT32 or VF2PF_UPDATE_GGTT_RANGES request.
+ * @response: placeholder for the PF response message.
+ * @expected: number of PTEs that PF should report as updated.
+ */
+struct intel_iov_vf_ggtt_inflight {
+	struct intel_iov_relay_pending pending;
+	u32 request[VF2PF_UPDATE_GGTT32_REQUEST_MSG_MAX_LEN];
+	u32 response[VF2PF_UPDATE_GGTT32_RESPONSE_MSG_LEN];
+	u32 expected;
+};
+
+/**
+ * struct intel_iov_ggtt_range - Run of GGTT PTEs generated by the PF.
+ * @pte: first PTE of the run.
+ * @count: number of PTEs in the run.
+ * @increment: GPA increment (in 4K pages) between consecutive PTEs.
+ */
+struct intel_iov_ggtt_range {
+	gen8_pte_t pte;
+	u16 count;
+	u16 increment;
+};
+
+#define IOV_VF_GGTT_NUM_CLASSES		3
+#define IOV_VF_GGTT_CLASS_CACHE_SIZE	32
+
+/**
+ * struct intel_iov_vf_ggtt_alloc - VF GGTT allocator data.
+ * @start: start of the VF GGTT window.
+ * @end: end of the VF GGTT window, 0 if the window is not known yet.
+ * @count: number of cached free offsets in each size class.
+ * @offsets: cached free offsets of each size class, most recently freed last.
+ *
+ * Offsets are just hints, they are revalidated by the drm_mm on reuse.
+ * Protected by the GGTT vm->mutex.
+ */
+struct intel_iov_vf_ggtt_alloc {
+	u64 start;
+	u64 end;
+	unsigned int count[IOV_VF_GGTT_NUM_CLASSES];
+	u64 offsets[IOV_VF_GGTT_NUM_CLASSES][IOV_VF_GGTT_CLASS_CACHE_SIZE];
+};
+
 /**
  * struct intel_iov_vf_ggtt_ptes - Placeholder for the VF PTEs data.
  * @ptes: an array of buffered GGTT PTEs awaiting update by PF.
@@ -227,6 +612,12 @@ struct intel_iov_pf_ggtt {
  * @offset: GGTT offset for the first PTE from the array.
  * @num_copies: number of copies of the first or last PTE (depending on mode).
  * @mode: mode of generating PTEs on PF.
+ * @ranges: an array of buffered PTE runs (used instead of @ptes since ABI 1.1).
+ * @num_ranges: count of the buffered runs in the @ranges array.
+ * @num_range_ptes: total number of PTEs described by the @ranges.
+ * @inflight: ring of update requests already sent to PF but not yet acked.
+ * @inflight_head: index of the oldest request in the @inflight ring.
+ * @num_inflight: number of requests in the @inflight ring.
  * @lock: protects PTEs data
  */
 struct intel_iov_vf_ggtt_ptes {
@@ -236,6 +627,12 @@ struct intel_iov_vf_ggtt_ptes {
 	u16 num_copies;
 	u8 mode;
 #define VF_RELAY_UPDATE_GGTT_MODE_INVALID	U8_MAX
+	struct intel_iov_ggtt_range ranges[VF2PF_UPDATE_GGTT_MAX_RANGES];
+	u16 num_ranges;
+	u32 num_range_ptes;
+	struct intel_iov_vf_ggtt_inflight inflight[8];
+	u8 inflight_head;
+	u8 num_inflight;
 	struct mutex lock;
 };
 
@@ -244,29 +641,32 @@ struct intel_iov_vf_ggtt_ptes {
  * @obj: GEM object with memory interrupt data.
  * @vma: VMA of the object.
  * @vaddr: pointer to memory interrupt data.
+ * @active: bitmap of interrupt source bytes of unparked engines.
+ * @engines: engines indexed by their interrupt source byte.
  */
 struct intel_iov_memirq {
 	struct drm_i915_gem_object *obj;
 	struct i915_vma *vma;
 	void *vaddr;
+	DECLARE_BITMAP(active, I915_VF_IRQ_SOURCE_COUNT);
+	struct intel_engine_cs *engines[I915_VF_IRQ_SOURCE_COUNT];
 };
 
 /**
  * struct intel_iov_relay - IOV Relay Communication data.
- * @lock: protects #pending_relays and #last_fence.
- * @pending_relays: list of relay requests that await a response.
+ * @pending_relays: relay requests that await a response, indexed by fence.
  * @last_fence: fence used with last message.
  * @selftest: FIXME missing doc
  */
 struct intel_iov_relay {
-	spinlock_t lock;
-	struct list_head pending_relays;
-	u32 last_fence;
+	struct xarray pending_relays;
+	atomic_t last_fence;
 
 	I915_SELFTEST_DECLARE(struct {
 		int (*host2guc)(struct intel_iov_relay *, const u32 *, u32);
 		int (*guc2pf)(struct intel_iov_relay *, const u32 *, u32);
 		int (*guc2vf)(struct intel_iov_relay *, const u32 *, u32);
+		int (*mock_guc)(struct intel_iov_relay *, const u32 *, u32);
 		void *data;
 		bool disable_strict : 1;
 		bool enable_loopback : 1;
@@ -276,6 +676,7 @@ struct intel_iov_relay {
 /**
  * struct intel_iov_vf_config - VF configuration data.
  * @guc_abi: FIXME missing doc
+ * @iov_abi: version of the VF/PF interface negotiated with the PF.
  * @ggtt_base: base of GGTT region.
  * @ggtt_size: size of GGTT region.
  * @num_ctxs: number of GuC submission contexts.
@@ -288,6 +689,10 @@ struct intel_iov_vf_config {
 		u8 minor;
 		u8 patch;
 	} guc_abi;
+	struct {
+		u16 major;
+		u16 minor;
+	} iov_abi;
 	u64 ggtt_base;
 	u64 ggtt_size;
 	u16 num_ctxs;
@@ -304,6 +709,7 @@ struct intel_iov_vf_config {
  * @vf: FIXME missing doc
  * @vf.config: configuration of the resources assigned to VF.
  * @vf.runtime: retrieved runtime info.
+ * @vf.ggtt_alloc: allocator of the VF GGTT window.
  * @vf.irq: Memory based interrupts data.
  * @relay: data related to VF/PF communication based on GuC Relay messages.
  */
@@ -315,6 +721,7 @@ struct intel_iov {
 			struct intel_iov_service service;
 			struct intel_iov_state state;
 			struct intel_iov_pf_ggtt ggtt;
+			struct intel_iov_sched sched;
 		} pf;
 
 		struct {
@@ -322,6 +729,7 @@ struct intel_iov {
 			struct intel_iov_vf_runtime runtime;
 			struct intel_iov_vf_ggtt_ptes ptes_buffer;
 			struct drm_mm_node ggtt_balloon[2];
+			struct intel_iov_vf_ggtt_alloc ggtt_alloc;
 			struct intel_iov_memirq irq;
 		} vf;
 	};
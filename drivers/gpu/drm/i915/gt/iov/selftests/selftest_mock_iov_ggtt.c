@@ -242,6 +242,75 @@ out_fini:
 	return err;
 }
 
+static int mock_ggtt_shadow_save_chunked(void *arg)
+{
+	struct intel_iov *iov = arg;
+	const unsigned int vfid = VFID(1);
+	const size_t chunk = 3 * SZ_4K * sizeof(gen8_pte_t);
+	struct drm_mm_node *node;
+	void *full_buf, *chunk_buf;
+	size_t size, offset;
+	u64 ggtt_addr;
+	int err;
+
+	err = mock_ggtt_shadow_init_test(iov);
+	if (err < 0)
+		return err;
+
+	node = mock_provisioning_ggtt_init(iov, vfid, 0, SZ_64M);
+
+	size = ggtt_size_to_ptes_size(node->size);
+	full_buf = kvzalloc(size, GFP_KERNEL);
+	chunk_buf = kvzalloc(size, GFP_KERNEL);
+	if (!full_buf || !chunk_buf) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+
+	err = intel_iov_ggtt_shadow_vf_alloc(iov, vfid, node);
+	if (err < 0)
+		goto out_free;
+
+	for_each_ggtt_page(ggtt_addr, node)
+		intel_iov_ggtt_shadow_set_pte(iov, vfid, ggtt_addr, make_pte(ggtt_addr, vfid));
+
+	intel_iov_ggtt_shadow_save(iov, vfid, full_buf, size, I915_GGTT_SAVE_PTES_NO_VFID);
+
+	for (offset = 0; offset < size; offset += chunk) {
+		size_t len = min(chunk, size - offset);
+
+		err = intel_iov_ggtt_shadow_save_chunk(iov, vfid, offset, chunk_buf + offset, len,
+						       I915_GGTT_SAVE_PTES_NO_VFID);
+		if (err != len) {
+			IOV_SELFTEST_ERROR(iov, "Failed to save chunk at %#zx (%d)\n", offset, err);
+			err = -EINVAL;
+			goto out_vf_free;
+		}
+	}
+
+	err = intel_iov_ggtt_shadow_save_chunk(iov, vfid, size - sizeof(gen8_pte_t), chunk_buf,
+					       2 * sizeof(gen8_pte_t), 0);
+	if (err != -ENOSPC) {
+		IOV_SELFTEST_ERROR(iov, "Chunk beyond VF PTEs not rejected (%d)\n", err);
+		err = -EINVAL;
+		goto out_vf_free;
+	}
+
+	err = 0;
+	if (memcmp(full_buf, chunk_buf, size)) {
+		IOV_SELFTEST_ERROR(iov, "Chunked save doesn't match full save\n");
+		err = -EINVAL;
+	}
+
+out_vf_free:
+	intel_iov_ggtt_shadow_vf_free(iov, vfid);
+out_free:
+	kvfree(chunk_buf);
+	kvfree(full_buf);
+	mock_ggtt_shadow_fini_test(iov);
+	return err;
+}
+
 static int mock_ggtt_shadow_restore_basic(void *arg)
 {
 	struct intel_iov *iov = arg;
@@ -392,14 +461,337 @@ out_fini:
 	return err;
 }
 
+static int mock_write_ptes(struct intel_iov *iov, u64 ggtt_addr, const gen8_pte_t *ptes,
+			   u32 count)
+{
+	gen8_pte_t *hw_ptes = iov->pf.ggtt.selftest.ptes;
+
+	memcpy(hw_ptes + ggtt_addr / I915_GTT_PAGE_SIZE_4K, ptes, count * sizeof(*ptes));
+
+	return 0;
+}
+
+static struct drm_mm_node *mock_pf_update_init(struct intel_iov *iov, unsigned int vfid,
+					       u64 size)
+{
+	struct drm_mm_node *node;
+	int err;
+
+	err = mock_ggtt_shadow_init_test(iov);
+	if (err < 0)
+		return ERR_PTR(err);
+
+	node = mock_provisioning_ggtt_init(iov, vfid, 0, size);
+
+	iov->pf.ggtt.selftest.mock_update_ptes = mock_update_ptes;
+	iov->pf.ggtt.selftest.mock_write_ptes = mock_write_ptes;
+	iov->pf.ggtt.selftest.ptes = kvzalloc(ggtt_size_to_ptes_size(node->size), GFP_KERNEL);
+	if (!iov->pf.ggtt.selftest.ptes) {
+		err = -ENOMEM;
+		goto out_fini;
+	}
+
+	err = intel_iov_ggtt_shadow_vf_alloc(iov, vfid, node);
+	if (err < 0)
+		goto out_free_ptes;
+
+	return node;
+
+out_free_ptes:
+	kvfree(iov->pf.ggtt.selftest.ptes);
+	iov->pf.ggtt.selftest.ptes = NULL;
+out_fini:
+	iov->pf.ggtt.selftest.mock_update_ptes = NULL;
+	iov->pf.ggtt.selftest.mock_write_ptes = NULL;
+	mock_ggtt_shadow_fini_test(iov);
+	return ERR_PTR(err);
+}
+
+static void mock_pf_update_fini(struct intel_iov *iov, unsigned int vfid)
+{
+	intel_iov_ggtt_shadow_vf_free(iov, vfid);
+	kvfree(iov->pf.ggtt.selftest.ptes);
+	iov->pf.ggtt.selftest.ptes = NULL;
+	iov->pf.ggtt.selftest.mock_update_ptes = NULL;
+	iov->pf.ggtt.selftest.mock_write_ptes = NULL;
+	mock_ggtt_shadow_fini_test(iov);
+}
+
+static int check_vf_range(struct intel_iov *iov, unsigned int vfid, gen8_pte_t pte,
+			  u16 count, u16 increment)
+{
+	struct intel_iov_ggtt_range range = {
+		.pte = pte,
+		.count = count,
+		.increment = increment,
+	};
+	gen8_pte_t *hw_ptes = iov->pf.ggtt.selftest.ptes;
+	gen8_pte_t pte_pattern = prepare_pattern_pte(pte, vfid);
+	u64 pfn = FIELD_GET(GEN12_GGTT_PTE_ADDR_MASK, pte);
+	int ret;
+	u16 i;
+
+	memset(hw_ptes, 0, count * sizeof(gen8_pte_t));
+
+	ret = intel_iov_ggtt_pf_update_vf_ranges(iov, vfid, 0, &range, 1);
+	if (ret != count) {
+		IOV_SELFTEST_ERROR(iov, "Updated %d PTEs of %u with increment %u\n",
+				   ret, count, increment);
+		return ret < 0 ? ret : -EINVAL;
+	}
+
+	for (i = 0; i < count; i++) {
+		gen8_pte_t expected_pte = pte_pattern |
+			FIELD_PREP(GEN12_GGTT_PTE_ADDR_MASK, pfn + i * increment);
+
+		if (hw_ptes[i] != expected_pte) {
+			IOV_SELFTEST_ERROR(iov,
+					   "PTE%u with increment %u: expected: %#llx current: %#llx\n",
+					   i, increment, expected_pte, hw_ptes[i]);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int mock_ggtt_pf_update_vf_range(void *arg)
+{
+	struct intel_iov *iov = arg;
+	const unsigned int vfid = VFID(1);
+	const u16 count = SZ_2M / I915_GTT_PAGE_SIZE_4K;
+	gen8_pte_t pte = make_pte(SZ_1G, vfid);
+	struct intel_iov_ggtt_range range = {
+		.pte = pte,
+		.increment = 1,
+	};
+	struct drm_mm_node *node;
+	int err;
+
+	node = mock_pf_update_init(iov, vfid, SZ_32M);
+	if (IS_ERR(node))
+		return PTR_ERR(node);
+
+	err = check_vf_range(iov, vfid, pte, count, 1);
+	if (!err)
+		err = check_vf_range(iov, vfid, pte, count, 0);
+	if (!err)
+		err = check_vf_range(iov, vfid, pte, count, 3);
+	/* more PTEs than fit in the staging buffer */
+	if (!err)
+		err = check_vf_range(iov, vfid, pte, 3 * IOV_GGTT_STAGING_PTES + 1, 1);
+
+	range.count = node->size / I915_GTT_PAGE_SIZE_4K;
+	if (!err && intel_iov_ggtt_pf_update_vf_ranges(iov, vfid, 1, &range, 1) != -ERANGE) {
+		IOV_SELFTEST_ERROR(iov, "Range outside of VF GGTT was not rejected\n");
+		err = -EINVAL;
+	}
+
+	mock_pf_update_fini(iov, vfid);
+	return err;
+}
+
+static int mock_ggtt_shadow_dirty(void *arg)
+{
+	struct intel_iov *iov = arg;
+	const unsigned int vfid = VFID(1);
+	const unsigned int flags = FIELD_PREP(I915_GGTT_RESTORE_PTES_VFID_MASK, vfid) |
+				   I915_GGTT_RESTORE_PTES_NEW_VFID;
+	const u32 dirty[] = { 5, 6, 7, 100 };
+	/* room for the first run only: header and 3 PTEs */
+	u32 buf[2 + 3 * 2] __aligned(8);
+	gen8_pte_t *hw_ptes;
+	struct drm_mm_node *node;
+	unsigned int i;
+	int ret, err = 0;
+
+	node = mock_pf_update_init(iov, vfid, SZ_16M);
+	if (IS_ERR(node))
+		return PTR_ERR(node);
+
+	hw_ptes = iov->pf.ggtt.selftest.ptes;
+
+	/* all PTEs are dirty after allocation */
+	ret = intel_iov_ggtt_shadow_save_dirty(iov, vfid, buf, sizeof(buf), 0);
+	if (ret != sizeof(buf) || buf[0] != 0 || buf[1] != 3) {
+		IOV_SELFTEST_ERROR(iov, "Unexpected initial dirty run %u+%u (%d)\n",
+				   buf[0], buf[1], ret);
+		err = -EINVAL;
+		goto out;
+	}
+
+	intel_iov_ggtt_shadow_clear_dirty(iov, vfid);
+
+	for (i = 0; i < ARRAY_SIZE(dirty); i++)
+		intel_iov_ggtt_shadow_set_pte(iov, vfid,
+					      node->start + dirty[i] * I915_GTT_PAGE_SIZE_4K,
+					      make_pte(dirty[i], vfid));
+
+	ret = intel_iov_ggtt_shadow_save_dirty(iov, vfid, buf, sizeof(buf),
+					       I915_GGTT_SAVE_PTES_NO_VFID);
+	if (ret != sizeof(buf) || buf[0] != 5 || buf[1] != 3) {
+		IOV_SELFTEST_ERROR(iov, "Unexpected 1st dirty run %u+%u (%d)\n",
+				   buf[0], buf[1], ret);
+		err = -EINVAL;
+		goto out;
+	}
+
+	ret = intel_iov_ggtt_shadow_load_dirty(iov, vfid, buf, ret, flags);
+	if (ret) {
+		err = ret;
+		goto out;
+	}
+
+	ret = intel_iov_ggtt_shadow_save_dirty(iov, vfid, buf, sizeof(buf),
+					       I915_GGTT_SAVE_PTES_NO_VFID);
+	if (ret != 2 * sizeof(u32) + sizeof(gen8_pte_t) || buf[0] != 100 || buf[1] != 1) {
+		IOV_SELFTEST_ERROR(iov, "Unexpected 2nd dirty run %u+%u (%d)\n",
+				   buf[0], buf[1], ret);
+		err = -EINVAL;
+		goto out;
+	}
+
+	ret = intel_iov_ggtt_shadow_load_dirty(iov, vfid, buf, ret, flags);
+	if (ret) {
+		err = ret;
+		goto out;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(dirty); i++) {
+		if (hw_ptes[dirty[i]] != make_pte(dirty[i], vfid)) {
+			IOV_SELFTEST_ERROR(iov, "PTE%u: expected: %#llx current: %#llx\n",
+					   dirty[i], make_pte(dirty[i], vfid), hw_ptes[dirty[i]]);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+
+	/* nothing is dirty right after clear */
+	intel_iov_ggtt_shadow_clear_dirty(iov, vfid);
+	ret = intel_iov_ggtt_shadow_save_dirty(iov, vfid, buf, sizeof(buf), 0);
+	if (ret) {
+		IOV_SELFTEST_ERROR(iov, "Unexpected dirty PTEs after clear (%d)\n", ret);
+		err = -EINVAL;
+	}
+
+out:
+	mock_pf_update_fini(iov, vfid);
+	return err;
+}
+
+#define SELFTEST_GGTT_PERF_TIME_MS	100
+
+static int mock_ggtt_pf_update_vf_ptes_throughput(void *arg)
+{
+	struct intel_iov *iov = arg;
+	const unsigned int vfid = VFID(1);
+	const u16 count = VF2PF_UPDATE_GGTT_MAX_PTES;
+	const u16 num_copies = SZ_2M / I915_GTT_PAGE_SIZE_4K - 1;
+	gen8_pte_t ptes[VF2PF_UPDATE_GGTT_MAX_PTES];
+	u64 staging_ptes = 0;
+	struct drm_mm_node *node;
+	ktime_t finish;
+	int err = 0;
+	int ret;
+	u16 i;
+
+	node = mock_pf_update_init(iov, vfid, SZ_16M);
+	if (IS_ERR(node))
+		return PTR_ERR(node);
+
+	for (i = 0; i < count; i++)
+		ptes[i] = make_pte(SZ_1G + i * I915_GTT_PAGE_SIZE_4K, vfid);
+
+	finish = ktime_add_ms(ktime_get(), SELFTEST_GGTT_PERF_TIME_MS);
+	while (!err && ktime_before(ktime_get(), finish)) {
+		ret = intel_iov_ggtt_pf_update_vf_ptes(iov, vfid, 0,
+						       VF2PF_UPDATE_GGTT32_MODE_REPLICATE,
+						       num_copies, ptes, count);
+		if (ret != num_copies + count)
+			err = ret < 0 ? ret : -EINVAL;
+		staging_ptes += num_copies + count;
+	}
+
+	if (!err)
+		dev_info(iov_to_dev(iov), "VF PTEs update via staging buffer: %llu PTEs/s\n",
+			 div_u64(staging_ptes * MSEC_PER_SEC, SELFTEST_GGTT_PERF_TIME_MS));
+
+	mock_pf_update_fini(iov, vfid);
+	return err;
+}
+
+static int mock_ggtt_vf_class_reuse(void *arg)
+{
+	struct intel_iov *iov = arg;
+	struct intel_iov_vf_ggtt_alloc *alloc;
+	struct drm_mm_node a = {}, b = {}, c = {};
+	struct drm_mm mm;
+	u64 offset;
+	int err = 0;
+
+	alloc = kzalloc(sizeof(*alloc), GFP_KERNEL);
+	if (!alloc)
+		return -ENOMEM;
+
+	drm_mm_init(&mm, 0, SZ_16M);
+
+	if (drm_mm_insert_node(&mm, &a, SZ_64K) || drm_mm_insert_node(&mm, &b, SZ_64K)) {
+		err = -ENOSPC;
+		goto out;
+	}
+
+	/* freed offset is reused by next allocation of the same size class */
+	offset = a.start;
+	vf_ggtt_class_put(alloc, a.start, a.size);
+	drm_mm_remove_node(&a);
+
+	if (vf_ggtt_class_get(alloc, &mm, &c, SZ_4K, 0, 0, 0, SZ_16M) != -ENOSPC) {
+		IOV_SELFTEST_ERROR(iov, "4K allocation reused 64K offset\n");
+		err = -EINVAL;
+		goto out;
+	}
+
+	err = vf_ggtt_class_get(alloc, &mm, &c, SZ_64K, 0, 0, 0, SZ_16M);
+	if (err || c.start != offset || alloc->count[1]) {
+		IOV_SELFTEST_ERROR(iov, "64K offset %#llx not reused (%d)\n", offset, err);
+		err = -EINVAL;
+		goto out;
+	}
+
+	/* stale offset is dropped */
+	vf_ggtt_class_put(alloc, b.start, b.size);
+	if (vf_ggtt_class_get(alloc, &mm, &a, SZ_64K, 0, 0, 0, SZ_16M) != -ENOSPC ||
+	    alloc->count[1]) {
+		IOV_SELFTEST_ERROR(iov, "stale 64K offset %#llx reused\n", b.start);
+		err = -EINVAL;
+		goto out;
+	}
+
+out:
+	if (drm_mm_node_allocated(&a))
+		drm_mm_remove_node(&a);
+	if (drm_mm_node_allocated(&b))
+		drm_mm_remove_node(&b);
+	if (drm_mm_node_allocated(&c))
+		drm_mm_remove_node(&c);
+	drm_mm_takedown(&mm);
+	kfree(alloc);
+	return err;
+}
+
 int selftest_mock_iov_ggtt(void)
 {
 	static const struct i915_subtest mock_tests[] = {
 		SUBTEST(mock_ggtt_shadow_basic),
 		SUBTEST(mock_ggtt_shadow_save_basic),
 		SUBTEST(mock_ggtt_shadow_save_no_vfid),
+		SUBTEST(mock_ggtt_shadow_save_chunked),
 		SUBTEST(mock_ggtt_shadow_restore_basic),
 		SUBTEST(mock_ggtt_shadow_restore_new_vfid),
+		SUBTEST(mock_ggtt_pf_update_vf_range),
+		SUBTEST(mock_ggtt_shadow_dirty),
+		SUBTEST(mock_ggtt_pf_update_vf_ptes_throughput),
+		SUBTEST(mock_ggtt_vf_class_reuse),
 	};
 	struct drm_i915_private *i915;
 	int err;
@@ -0,0 +1,671 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright(c) 2024 Intel Corporation. All rights reserved.
+ */
+
+#include "selftests/mock_gem_device.h"
+
+#define MOCK_NUM_VFS	2
+
+struct mock_pushed_config {
+	unsigned int count;
+	u64 ggtt_size;
+	u32 num_ctxs;
+	u32 exec_quantum;
+};
+
+struct mock_provisioning {
+	struct mock_pushed_config vfs[1 + MOCK_NUM_VFS];
+	u16 *ggtt_owners;
+	gen8_pte_t *ggtt_ptes;
+	unsigned int num_ggtt_ptes;
+	unsigned int max_ggtt_ptes;
+};
+
+static int mock_push_config(struct intel_iov *iov, u32 vfid, const u32 *cfg, u32 num_dwords)
+{
+	struct mock_provisioning *mock = iov->pf.provisioning.selftest.data;
+	struct mock_pushed_config *pushed;
+	u32 key, len;
+
+	if (vfid == PFID || vfid > MOCK_NUM_VFS)
+		return -EINVAL;
+
+	pushed = &mock->vfs[vfid];
+	pushed->count++;
+
+	while (num_dwords >= GUC_KLV_LEN_MIN) {
+		key = FIELD_GET(GUC_KLV_0_KEY, cfg[0]);
+		len = FIELD_GET(GUC_KLV_0_LEN, cfg[0]);
+		cfg += GUC_KLV_LEN_MIN;
+		num_dwords -= GUC_KLV_LEN_MIN;
+		if (len > num_dwords)
+			return -EPROTO;
+
+		switch (key) {
+		case GUC_KLV_VF_CFG_GGTT_SIZE_KEY:
+			pushed->ggtt_size = make_u64(cfg[1], cfg[0]);
+			break;
+		case GUC_KLV_VF_CFG_NUM_CONTEXTS_KEY:
+			pushed->num_ctxs = cfg[0];
+			break;
+		case GUC_KLV_VF_CFG_EXEC_QUANTUM_KEY:
+			pushed->exec_quantum = cfg[0];
+			break;
+		}
+
+		cfg += len;
+		num_dwords -= len;
+	}
+
+	return num_dwords ? -EPROTO : 0;
+}
+
+static void mock_set_space_owner(struct intel_iov *iov, u16 vfid, const struct drm_mm_node *node)
+{
+	struct mock_provisioning *mock = iov->pf.provisioning.selftest.data;
+	u64 addr;
+
+	for (addr = node->start; addr < node->start + node->size; addr += I915_GTT_PAGE_SIZE_4K)
+		mock->ggtt_owners[addr / I915_GTT_PAGE_SIZE_4K] = vfid;
+}
+
+static int mock_update_ptes(struct intel_iov *iov, struct sg_table *st, gen8_pte_t pte_pattern)
+{
+	struct mock_provisioning *mock = iov->pf.provisioning.selftest.data;
+	struct sgt_iter iter;
+	dma_addr_t addr;
+
+	for_each_sgt_daddr(addr, iter, st) {
+		if (mock->num_ggtt_ptes == mock->max_ggtt_ptes)
+			return -ENOSPC;
+		mock->ggtt_ptes[mock->num_ggtt_ptes++] = pte_pattern | addr;
+	}
+
+	return 0;
+}
+
+/* only configs are faked, as the mock device has no GGTT and GuC resources */
+static void mock_fake_config(struct intel_iov *iov, unsigned int vfid, u64 ggtt_size,
+			     u16 num_ctxs)
+{
+	struct intel_iov_config *config = &iov->pf.provisioning.configs[vfid];
+
+	config->ggtt_region.start = vfid * ggtt_size;
+	config->ggtt_region.size = ggtt_size;
+	if (ggtt_size)
+		set_bit(DRM_MM_NODE_ALLOCATED_BIT, &config->ggtt_region.flags);
+	else
+		clear_bit(DRM_MM_NODE_ALLOCATED_BIT, &config->ggtt_region.flags);
+	config->begin_ctx = num_ctxs ? vfid * num_ctxs : 0;
+	config->num_ctxs = num_ctxs;
+}
+
+static int mock_provisioning_init(struct intel_iov *iov, struct mock_provisioning *mock)
+{
+	struct drm_i915_private *i915 = iov_to_gt(iov)->i915;
+
+	i915->__mode = I915_IOV_MODE_SRIOV_PF;
+	i915->sriov.pf.driver_vfs = MOCK_NUM_VFS;
+	i915->sriov.pf.__status = 1;
+	mutex_init(&iov->pf.provisioning.lock);
+
+	iov->pf.provisioning.configs = kcalloc(1 + MOCK_NUM_VFS,
+					       sizeof(*iov->pf.provisioning.configs), GFP_KERNEL);
+	if (!iov->pf.provisioning.configs) {
+		mutex_destroy(&iov->pf.provisioning.lock);
+		i915->sriov.pf.__status = 0;
+		i915->sriov.pf.driver_vfs = 0;
+		i915->__mode = I915_IOV_MODE_NONE;
+		return -ENOMEM;
+	}
+
+	memset(mock, 0, sizeof(*mock));
+	iov->pf.provisioning.selftest.mock_push_config = mock_push_config;
+	iov->pf.provisioning.selftest.data = mock;
+
+	return 0;
+}
+
+static void mock_provisioning_fini(struct intel_iov *iov)
+{
+	struct drm_i915_private *i915 = iov_to_gt(iov)->i915;
+
+	iov->pf.provisioning.selftest.mock_push_config = NULL;
+	iov->pf.provisioning.selftest.data = NULL;
+	iov->pf.provisioning.staging = false;
+	iov->pf.provisioning.num_pushed = 0;
+	iov->pf.provisioning.num_deferred = 0;
+
+	kfree(fetch_and_zero(&iov->pf.provisioning.configs));
+	mutex_destroy(&iov->pf.provisioning.lock);
+	i915->sriov.pf.disable_auto_provisioning = false;
+	i915->sriov.pf.__status = 0;
+	i915->sriov.pf.driver_vfs = 0;
+	i915->__mode = I915_IOV_MODE_NONE;
+}
+
+static int mock_provisioning_staged_commit(void *arg)
+{
+	struct intel_iov *iov = arg;
+	struct mock_provisioning mock;
+	unsigned int n;
+	int err;
+
+	err = mock_provisioning_init(iov, &mock);
+	if (err)
+		return err;
+
+	/* both VFs were provisioned and pushed */
+	mutex_lock(pf_provisioning_mutex(iov));
+	mock_fake_config(iov, VFID(1), SZ_64M, 64);
+	mock_fake_config(iov, VFID(2), SZ_64M, 64);
+	err = pf_push_configs(iov, MOCK_NUM_VFS);
+	mutex_unlock(pf_provisioning_mutex(iov));
+	if (err)
+		goto out;
+
+	err = intel_iov_provisioning_stage(iov);
+	if (err)
+		goto out;
+
+	/* modify VF1, unprovision VF2 */
+	err = intel_iov_provisioning_set_exec_quantum(iov, VFID(1), 17);
+	if (err)
+		goto out;
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	mock_fake_config(iov, VFID(2), 0, 0);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	/* reprovisioning while staging must not push half-staged configs */
+	err = intel_iov_provisioning_push(iov, MOCK_NUM_VFS);
+	if (err)
+		goto out;
+
+	for (n = VFID(1); n <= MOCK_NUM_VFS; n++) {
+		if (mock.vfs[n].count != 1) {
+			IOV_SELFTEST_ERROR(iov, "VF%u config pushed while staging\n", n);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+
+	err = intel_iov_provisioning_commit(iov);
+	if (err)
+		goto out;
+
+	for (n = VFID(1); n <= MOCK_NUM_VFS; n++) {
+		if (mock.vfs[n].count != 2) {
+			IOV_SELFTEST_ERROR(iov, "VF%u config pushed %u times on commit\n",
+					   n, mock.vfs[n].count - 1);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+
+	if (mock.vfs[VFID(1)].exec_quantum != 17) {
+		IOV_SELFTEST_ERROR(iov, "VF1 staged execution quantum not pushed (%u)\n",
+				   mock.vfs[VFID(1)].exec_quantum);
+		err = -EINVAL;
+		goto out;
+	}
+
+	if (mock.vfs[VFID(2)].ggtt_size || mock.vfs[VFID(2)].num_ctxs) {
+		IOV_SELFTEST_ERROR(iov, "VF2 resources not released (GGTT %llu ctxs %u)\n",
+				   mock.vfs[VFID(2)].ggtt_size, mock.vfs[VFID(2)].num_ctxs);
+		err = -EINVAL;
+		goto out;
+	}
+
+	if (intel_iov_provisioning_is_staging(iov)) {
+		IOV_SELFTEST_ERROR(iov, "Still staging after commit\n");
+		err = -EINVAL;
+	}
+
+out:
+	mock_provisioning_fini(iov);
+	return err;
+}
+
+static int mock_reserve_ggtt(struct i915_ggtt *ggtt, struct drm_mm_node *node, u64 start,
+			     u64 size)
+{
+	int err;
+
+	memset(node, 0, sizeof(*node));
+	node->start = start;
+	node->size = size;
+	node->color = I915_COLOR_UNEVICTABLE;
+
+	mutex_lock(&ggtt->vm.mutex);
+	err = drm_mm_reserve_node(&ggtt->vm.mm, node);
+	mutex_unlock(&ggtt->vm.mutex);
+
+	return err;
+}
+
+static void mock_release_ggtt(struct i915_ggtt *ggtt, struct drm_mm_node *node)
+{
+	mutex_lock(&ggtt->vm.mutex);
+	if (drm_mm_node_allocated(node))
+		drm_mm_remove_node(node);
+	mutex_unlock(&ggtt->vm.mutex);
+}
+
+static unsigned int mock_count_ggtt_nodes(struct i915_ggtt *ggtt)
+{
+	struct drm_mm_node *node;
+	unsigned int count = 0;
+
+	mutex_lock(&ggtt->vm.mutex);
+	drm_mm_for_each_node(node, &ggtt->vm.mm)
+		count++;
+	mutex_unlock(&ggtt->vm.mutex);
+
+	return count;
+}
+
+#define MOCK_GGTT_VF_SIZE	SZ_2M
+#define MOCK_GGTT_VF_PTES	(MOCK_GGTT_VF_SIZE / SZ_4K)
+
+/*
+ * GGTT layout used by the compaction tests: VF1 owns a relocatable
+ * MOCK_GGTT_VF_SIZE region, PF owned blocks can't be moved, and VF2
+ * asks for @size that doesn't fit into any of the holes.
+ */
+struct mock_ggtt_layout {
+	u64 blocks[3][2];
+	u64 vf_start;
+	u64 size;
+	int result;
+	u64 vf_result;
+};
+
+static int mock_compact_ggtt(struct intel_iov *iov, const struct mock_ggtt_layout *layout)
+{
+	struct drm_mm_node blocks[ARRAY_SIZE(layout->blocks)] = {};
+	struct i915_ggtt *ggtt = iov_to_gt(iov)->ggtt;
+	struct mock_provisioning mock;
+	struct drm_mm_node probe = {};
+	struct intel_iov_config *config;
+	unsigned int i, num_nodes;
+	gen8_pte_t *shadow;
+	u64 addr;
+	int err, ret;
+
+	err = mock_provisioning_init(iov, &mock);
+	if (err)
+		return err;
+	config = &iov->pf.provisioning.configs[VFID(1)];
+
+	mock.ggtt_owners = kcalloc(ggtt->vm.total / I915_GTT_PAGE_SIZE_4K,
+				   sizeof(*mock.ggtt_owners), GFP_KERNEL);
+	mock.ggtt_ptes = kcalloc(MOCK_GGTT_VF_PTES, sizeof(*mock.ggtt_ptes), GFP_KERNEL);
+	mock.max_ggtt_ptes = MOCK_GGTT_VF_PTES;
+	if (!mock.ggtt_owners || !mock.ggtt_ptes) {
+		err = -ENOMEM;
+		goto out_free;
+	}
+
+	err = intel_iov_ggtt_shadow_init(iov);
+	if (err)
+		goto out_free;
+
+	iov->pf.ggtt.selftest.mock_set_space_owner = mock_set_space_owner;
+	iov->pf.ggtt.selftest.mock_update_ptes = mock_update_ptes;
+
+	for (i = 0; i < ARRAY_SIZE(blocks); i++) {
+		err = mock_reserve_ggtt(ggtt, &blocks[i], layout->blocks[i][0],
+					layout->blocks[i][1]);
+		if (err)
+			goto out;
+	}
+
+	err = mock_reserve_ggtt(ggtt, &config->ggtt_region, layout->vf_start, MOCK_GGTT_VF_SIZE);
+	if (err)
+		goto out;
+
+	err = intel_iov_ggtt_shadow_vf_alloc(iov, VFID(1), &config->ggtt_region);
+	if (err)
+		goto out;
+
+	/* uniform PTE flags, so the shadow is written back in one go */
+	shadow = iov->pf.ggtt.shadows_ggtt[VFID(1)].ptes;
+	for (i = 0; i < MOCK_GGTT_VF_PTES; i++)
+		shadow[i] = FIELD_PREP(GEN12_GGTT_PTE_ADDR_MASK, i + 1) |
+			    i915_ggtt_prepare_vf_pte(VFID(1));
+
+	num_nodes = mock_count_ggtt_nodes(ggtt);
+
+	mutex_lock(pf_provisioning_mutex(iov));
+	ret = pf_compact_ggtt(iov, VFID(2), layout->size);
+	mutex_unlock(pf_provisioning_mutex(iov));
+
+	err = -EINVAL;
+	if (ret != layout->result) {
+		IOV_SELFTEST_ERROR(iov, "GGTT compaction returned %pe, expected %pe\n",
+				   ERR_PTR(ret), ERR_PTR(layout->result));
+		goto out;
+	}
+
+	if (!drm_mm_node_allocated(&config->ggtt_region) ||
+	    config->ggtt_region.start != layout->vf_result ||
+	    config->ggtt_region.size != MOCK_GGTT_VF_SIZE) {
+		IOV_SELFTEST_ERROR(iov, "VF1 GGTT at %llx (%lluK), expected %llx (%lluK)\n",
+				   config->ggtt_region.start, config->ggtt_region.size / SZ_1K,
+				   layout->vf_result, (u64)MOCK_GGTT_VF_SIZE / SZ_1K);
+		goto out;
+	}
+
+	if (mock_count_ggtt_nodes(ggtt) != num_nodes) {
+		IOV_SELFTEST_ERROR(iov, "GGTT nodes leaked (%u != %u)\n",
+				   mock_count_ggtt_nodes(ggtt), num_nodes);
+		goto out;
+	}
+
+	/* the ownership follows the VF1 region, space it left is released */
+	for (addr = 0; addr < ggtt->vm.total; addr += I915_GTT_PAGE_SIZE_4K) {
+		u16 owner = mock.ggtt_owners[addr / I915_GTT_PAGE_SIZE_4K];
+		u16 expected = addr >= layout->vf_result &&
+			       addr < layout->vf_result + MOCK_GGTT_VF_SIZE ? VFID(1) : PFID;
+
+		if (owner != expected) {
+			IOV_SELFTEST_ERROR(iov, "GGTT %llx owned by VF%u, expected VF%u\n",
+					   addr, owner, expected);
+			goto out;
+		}
+	}
+
+	/* VF1 PTEs are written again from the shadow GGTT, moved or not */
+	if (mock.num_ggtt_ptes != MOCK_GGTT_VF_PTES ||
+	    memcmp(mock.ggtt_ptes, shadow, MOCK_GGTT_VF_PTES * sizeof(*shadow))) {
+		IOV_SELFTEST_ERROR(iov, "VF1 GGTT PTEs not restored from shadow (%u/%u)\n",
+				   mock.num_ggtt_ptes, MOCK_GGTT_VF_PTES);
+		goto out;
+	}
+
+	if (!ret) {
+		mutex_lock(&ggtt->vm.mutex);
+		ret = pf_ggtt_insert_compact(ggtt, &probe, layout->size,
+					     pf_get_ggtt_alignment(iov));
+		mutex_unlock(&ggtt->vm.mutex);
+		if (ret) {
+			IOV_SELFTEST_ERROR(iov, "No room for %lluK after compaction (%pe)\n",
+					   layout->size / SZ_1K, ERR_PTR(ret));
+			goto out;
+		}
+		mock_release_ggtt(ggtt, &probe);
+	}
+
+	err = 0;
+out:
+	intel_iov_ggtt_shadow_vf_free(iov, VFID(1));
+	mock_release_ggtt(ggtt, &config->ggtt_region);
+	for (i = 0; i < ARRAY_SIZE(blocks); i++)
+		mock_release_ggtt(ggtt, &blocks[i]);
+	iov->pf.ggtt.selftest.mock_update_ptes = NULL;
+	iov->pf.ggtt.selftest.mock_set_space_owner = NULL;
+	intel_iov_ggtt_shadow_fini(iov);
+out_free:
+	kfree(mock.ggtt_ptes);
+	kfree(mock.ggtt_owners);
+	mock_provisioning_fini(iov);
+	return err;
+}
+
+static int mock_provisioning_compact_ggtt(void *arg)
+{
+	/* VF1 moves down, so VF2 gets the 4M made of both holes */
+	static const struct mock_ggtt_layout layout = {
+		.blocks = {
+			{ 0, SZ_2M },
+			{ SZ_2M, SZ_2M },
+			{ 10 * SZ_1M, 6 * SZ_1M },
+		},
+		.vf_start = 6 * SZ_1M,
+		.size = SZ_4M,
+		.result = 0,
+		.vf_result = SZ_4M,
+	};
+
+	return mock_compact_ggtt(arg, &layout);
+}
+
+static int mock_provisioning_compact_ggtt_rollback(void *arg)
+{
+	/* VF2 fits once VF1 is removed, but then VF1 doesn't fit back */
+	static const struct mock_ggtt_layout layout = {
+		.blocks = {
+			{ 0, SZ_4M },
+			{ 7 * SZ_1M, SZ_1M },
+			{ 9 * SZ_1M, 7 * SZ_1M },
+		},
+		.vf_start = SZ_4M,
+		.size = SZ_2M,
+		.result = -ENOSPC,
+		.vf_result = SZ_4M,
+	};
+
+	return mock_compact_ggtt(arg, &layout);
+}
+
+static int mock_provisioning_compact_ctxs(void *arg)
+{
+	struct intel_iov *iov = arg;
+	struct intel_iov_config *configs;
+	struct mock_provisioning mock;
+	u16 begin_ctx, num_ctxs;
+	int err, ret;
+
+	err = mock_provisioning_init(iov, &mock);
+	if (err)
+		return err;
+	configs = iov->pf.provisioning.configs;
+
+	/*
+	 * PF owns the first 256 blocks of contexts, VF1 sits in the middle
+	 * of the remaining space, leaving holes of 44 and 148 blocks.
+	 */
+	configs[PFID].num_ctxs = decode_pf_ctxs_count(256);
+	configs[VFID(1)].begin_ctx = decode_vf_ctxs_start(300);
+	configs[VFID(1)].num_ctxs = decode_vf_ctxs_count(64);
+	num_ctxs = decode_vf_ctxs_count(160);
+
+	mutex_lock(pf_provisioning_mutex(iov));
+
+	err = -EINVAL;
+	ret = pf_alloc_vf_ctxs_range(iov, VFID(2), num_ctxs);
+	if (ret != -ENOSPC) {
+		IOV_SELFTEST_ERROR(iov, "Unexpected contexts hole (%d)\n", ret);
+		goto out;
+	}
+
+	ret = pf_compact_ctxs(iov, VFID(2), num_ctxs);
+	if (ret) {
+		IOV_SELFTEST_ERROR(iov, "Contexts compaction failed (%pe)\n", ERR_PTR(ret));
+		goto out;
+	}
+
+	if (configs[VFID(2)].num_ctxs ||
+	    configs[VFID(1)].num_ctxs != decode_vf_ctxs_count(64) ||
+	    configs[VFID(1)].begin_ctx != decode_vf_ctxs_start(288)) {
+		IOV_SELFTEST_ERROR(iov, "Unexpected contexts VF1 %u-%u VF2 %u\n",
+				   configs[VFID(1)].begin_ctx, configs[VFID(1)].num_ctxs,
+				   configs[VFID(2)].num_ctxs);
+		goto out;
+	}
+
+	ret = pf_alloc_vf_ctxs_range(iov, VFID(2), num_ctxs);
+	if (ret < 0) {
+		IOV_SELFTEST_ERROR(iov, "No room for %u contexts after compaction (%pe)\n",
+				   num_ctxs, ERR_PTR(ret));
+		goto out;
+	}
+
+	/* 200 blocks fit only without VF1, so VF1 must stay where it was */
+	begin_ctx = configs[VFID(1)].begin_ctx;
+	ret = pf_compact_ctxs(iov, VFID(2), decode_vf_ctxs_count(200));
+	if (ret != -ENOSPC) {
+		IOV_SELFTEST_ERROR(iov, "Contexts compaction returned %pe, expected %pe\n",
+				   ERR_PTR(ret), ERR_PTR(-ENOSPC));
+		goto out;
+	}
+
+	if (configs[VFID(2)].num_ctxs ||
+	    configs[VFID(1)].num_ctxs != decode_vf_ctxs_count(64) ||
+	    configs[VFID(1)].begin_ctx != begin_ctx) {
+		IOV_SELFTEST_ERROR(iov, "Contexts not restored VF1 %u-%u VF2 %u\n",
+				   configs[VFID(1)].begin_ctx, configs[VFID(1)].num_ctxs,
+				   configs[VFID(2)].num_ctxs);
+		goto out;
+	}
+
+	err = 0;
+out:
+	mutex_unlock(pf_provisioning_mutex(iov));
+	mock_provisioning_fini(iov);
+	return err;
+}
+
+static int mock_check_shares(struct intel_iov *iov, const struct intel_iov_profile *profile,
+			     unsigned int num_vfs, u64 available, u64 alignment)
+{
+	u32 total = profile_total_weight(profile, num_vfs);
+	u64 share, sum = 0, aligned_sum = 0;
+	unsigned int n;
+	u16 weight;
+
+	for (n = VFID(1); n <= num_vfs; n++) {
+		weight = profile_vf_weight(profile, n);
+		share = profile_vf_share(profile, n, num_vfs, available);
+
+		/* exact share rounded down */
+		if (share * total > available * weight ||
+		    (share + 1) * total <= available * weight) {
+			IOV_SELFTEST_ERROR(iov, "%s: VF%u got %llu of %llu with weight %u/%u\n",
+					   profile_name(profile), n, share, available,
+					   weight, total);
+			return -EINVAL;
+		}
+
+		sum += share;
+		aligned_sum += ALIGN_DOWN(share, alignment);
+	}
+
+	/* each VF may lose less than one unit to rounding */
+	if (sum > available || available - sum >= num_vfs) {
+		IOV_SELFTEST_ERROR(iov, "%s: %u VFs got %llu of %llu\n",
+				   profile_name(profile), num_vfs, sum, available);
+		return -EINVAL;
+	}
+
+	if (sum - aligned_sum >= num_vfs * alignment) {
+		IOV_SELFTEST_ERROR(iov, "%s: %u VFs got %llu of %llu aligned to %llu\n",
+				   profile_name(profile), num_vfs, aligned_sum, available,
+				   alignment);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int mock_provisioning_profile_share(void *arg)
+{
+	struct intel_iov *iov = arg;
+	struct intel_iov_profile *profile;
+	struct mock_provisioning mock;
+	char weighted[] = "weighted 3 1";
+	char zero[] = "zero 1 0";
+	int err;
+
+	err = mock_provisioning_init(iov, &mock);
+	if (err)
+		return err;
+
+	/* without profile, it is a fair split */
+	err = mock_check_shares(iov, NULL, 3, 1000, 1);
+	if (!err)
+		err = mock_check_shares(iov, NULL, 7, SZ_4G - SZ_64M, SZ_4K);
+	if (err)
+		goto out;
+
+	profile = pf_parse_profile(iov, weighted);
+	if (IS_ERR(profile)) {
+		err = PTR_ERR(profile);
+		IOV_SELFTEST_ERROR(iov, "Failed to parse profile (%pe)\n", profile);
+		goto out;
+	}
+
+	if (profile_vf_share(profile, VFID(1), 2, SZ_4K) != SZ_2K + SZ_1K ||
+	    profile_vf_share(profile, VFID(2), 2, SZ_4K) != SZ_1K) {
+		IOV_SELFTEST_ERROR(iov, "%s: unexpected shares %llu and %llu of %u\n",
+				   profile_name(profile),
+				   profile_vf_share(profile, VFID(1), 2, SZ_4K),
+				   profile_vf_share(profile, VFID(2), 2, SZ_4K), SZ_4K);
+		err = -EINVAL;
+		goto out_profile;
+	}
+
+	/* VFs beyond the profile get weight 1 */
+	err = mock_check_shares(iov, profile, 4, SZ_1G - SZ_4K, SZ_4K);
+	if (!err)
+		err = mock_check_shares(iov, profile, 5, GUC_MAX_CONTEXT_ID, CTXS_GRANULARITY);
+	if (!err)
+		err = mock_check_shares(iov, profile, 3, GUC_NUM_DOORBELLS, 1);
+	if (err)
+		goto out_profile;
+
+	/* VF with zero weight gets nothing, the others share everything */
+	profile->vfs[1].weight = 0;
+	err = mock_check_shares(iov, profile, 2, SZ_4K, 1);
+	if (err)
+		goto out_profile;
+
+	if (profile_vf_share(profile, VFID(2), 2, SZ_4K)) {
+		IOV_SELFTEST_ERROR(iov, "%s: zero weight VF2 got %llu\n", profile_name(profile),
+				   profile_vf_share(profile, VFID(2), 2, SZ_4K));
+		err = -EINVAL;
+		goto out_profile;
+	}
+
+	/* but such profile can't be set by the user */
+	kfree(profile);
+	profile = pf_parse_profile(iov, zero);
+	if (PTR_ERR_OR_ZERO(profile) != -EINVAL) {
+		IOV_SELFTEST_ERROR(iov, "Profile with zero weight not rejected (%pe)\n", profile);
+		err = -EINVAL;
+		goto out_profile;
+	}
+	profile = NULL;
+
+out_profile:
+	if (!IS_ERR(profile))
+		kfree(profile);
+out:
+	mock_provisioning_fini(iov);
+	return err;
+}
+
+int selftest_mock_iov_provisioning(void)
+{
+	static const struct i915_subtest mock_tests[] = {
+		SUBTEST(mock_provisioning_staged_commit),
+		SUBTEST(mock_provisioning_compact_ggtt),
+		SUBTEST(mock_provisioning_compact_ggtt_rollback),
+		SUBTEST(mock_provisioning_compact_ctxs),
+		SUBTEST(mock_provisioning_profile_share),
+	};
+	struct drm_i915_private *i915;
+	int err;
+
+	i915 = mock_gem_device();
+	if (!i915)
+		return -ENOMEM;
+
+	err = i915_subtests(mock_tests, &to_gt(i915)->iov);
+
+	mock_destroy_device(i915);
+
+	return err;
+}
@@ -697,6 +697,218 @@ static int mock_prepares_pf2guc_and_retries(void *arg)
 	return err;
 }
 
+#define MOCK_PIPELINE_DEPTH	4
+
+struct pipelined_params {
+	u32 relay_ids[MOCK_PIPELINE_DEPTH];
+	unsigned int count;
+};
+
+static int vf2guc_record_relay_id(struct intel_iov_relay *relay, const u32 *msg, u32 len)
+{
+	struct pipelined_params *params = relay->selftest.data;
+
+	host2guc_success(relay, msg, len);
+
+	if (len < VF2GUC_RELAY_TO_PF_REQUEST_MSG_MIN_LEN)
+		return -EPROTO;
+
+	if (FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, msg[0]) != GUC_ACTION_VF2GUC_RELAY_TO_PF)
+		return -ENOTTY;
+
+	if (params->count >= ARRAY_SIZE(params->relay_ids))
+		return -ENOSPC;
+
+	params->relay_ids[params->count++] =
+		FIELD_GET(VF2GUC_RELAY_TO_PF_REQUEST_MSG_1_RELAY_ID, msg[1]);
+	return 0;
+}
+
+static int mock_submits_vf2guc_pipelined(void *arg)
+{
+	struct intel_iov *iov = arg;
+	u32 msg[] = {
+		MSG_IOV_SELFTEST_RELAY(SELFTEST_RELAY_OPCODE_NOP),
+	};
+	struct intel_iov_relay_pending pending[MOCK_PIPELINE_DEPTH];
+	u32 buf[MOCK_PIPELINE_DEPTH][GUC_HXG_MSG_MIN_LEN];
+	struct pipelined_params params = {};
+	unsigned int n, i;
+	int err = 0, ret;
+
+	iov->relay.selftest.disable_strict = 1;
+	iov->relay.selftest.data = &params;
+
+	for (n = 0; n < ARRAY_SIZE(pending); n++) {
+		iov->relay.selftest.host2guc = vf2guc_record_relay_id;
+
+		err = intel_iov_relay_submit_to_pf(&iov->relay, &pending[n], msg, ARRAY_SIZE(msg),
+						   buf[n], ARRAY_SIZE(buf[n]));
+		if (err < 0) {
+			IOV_SELFTEST_ERROR(iov, "failed to submit request%u, %d\n", n, err);
+			break;
+		}
+	}
+
+	/* reply in reverse order, replies must be matched by the fence */
+	for (i = n; i--; ) {
+		u32 reply[] = {
+			MSG_GUC2VF_RELAY_FROM_PF,
+			FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+			FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS) |
+			FIELD_PREP(GUC_HXG_RESPONSE_MSG_0_DATA0, i),
+		};
+
+		reply[1] = FIELD_PREP(GUC2VF_RELAY_FROM_PF_EVENT_MSG_1_RELAY_ID,
+				      params.relay_ids[i]);
+
+		ret = intel_iov_relay_process_guc2vf(&iov->relay, reply, ARRAY_SIZE(reply));
+		if (ret && !err) {
+			IOV_SELFTEST_ERROR(iov, "failed to process reply%u, %d\n", i, ret);
+			err = ret;
+		}
+	}
+
+	for (i = 0; i < n; i++) {
+		ret = intel_iov_relay_wait_for_pf(&iov->relay, &pending[i]);
+		if (ret < 0) {
+			IOV_SELFTEST_ERROR(iov, "request%u failed, %d\n", i, ret);
+			err = err ?: ret;
+		} else if (buf[i][0] != i) {
+			IOV_SELFTEST_ERROR(iov, "request%u got reply%u\n", i, buf[i][0]);
+			err = err ?: -EBADMSG;
+		}
+	}
+
+	iov->relay.selftest.disable_strict = 0;
+	iov->relay.selftest.host2guc = NULL;
+	iov->relay.selftest.data = NULL;
+
+	return err;
+}
+
+static int mock_drops_duplicated_vf2guc_reply(void *arg)
+{
+	struct intel_iov *iov = arg;
+	u32 msg[] = {
+		MSG_IOV_SELFTEST_RELAY(SELFTEST_RELAY_OPCODE_NOP),
+	};
+	u32 reply[] = {
+		MSG_GUC2VF_RELAY_FROM_PF,
+		FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS),
+	};
+	struct intel_iov_relay_pending pending;
+	u32 buf[GUC_HXG_MSG_MIN_LEN];
+	struct pipelined_params params = {};
+	int err, ret;
+
+	iov->relay.selftest.disable_strict = 1;
+	iov->relay.selftest.data = &params;
+	iov->relay.selftest.host2guc = vf2guc_record_relay_id;
+
+	err = intel_iov_relay_submit_to_pf(&iov->relay, &pending, msg, ARRAY_SIZE(msg),
+					   buf, ARRAY_SIZE(buf));
+	if (err < 0) {
+		IOV_SELFTEST_ERROR(iov, "failed to submit request, %d\n", err);
+		goto out;
+	}
+
+	reply[1] = FIELD_PREP(GUC2VF_RELAY_FROM_PF_EVENT_MSG_1_RELAY_ID, params.relay_ids[0]);
+
+	err = intel_iov_relay_process_guc2vf(&iov->relay, reply, ARRAY_SIZE(reply));
+	if (err) {
+		IOV_SELFTEST_ERROR(iov, "failed to process reply, %d\n", err);
+		goto wait;
+	}
+
+	/* final reply was already matched, request is no longer pending */
+	ret = intel_iov_relay_process_guc2vf(&iov->relay, reply, ARRAY_SIZE(reply));
+	if (ret != -ESRCH) {
+		IOV_SELFTEST_ERROR(iov, "duplicated reply not rejected, %d\n", ret);
+		err = -EINVAL;
+	}
+
+wait:
+	ret = intel_iov_relay_wait_for_pf(&iov->relay, &pending);
+	if (ret < 0 && !err) {
+		IOV_SELFTEST_ERROR(iov, "request failed, %d\n", ret);
+		err = ret;
+	}
+
+	if (!err && !xa_empty(&iov->relay.pending_relays)) {
+		IOV_SELFTEST_ERROR(iov, "request still tracked\n");
+		err = -EINVAL;
+	}
+
+out:
+	iov->relay.selftest.disable_strict = 0;
+	iov->relay.selftest.host2guc = NULL;
+	iov->relay.selftest.data = NULL;
+
+	return err;
+}
+
+static int mock_keeps_final_vf2guc_reply_after_busy(void *arg)
+{
+	struct intel_iov *iov = arg;
+	u32 msg[] = {
+		MSG_IOV_SELFTEST_RELAY(SELFTEST_RELAY_OPCODE_NOP),
+	};
+	u32 busy[] = {
+		MSG_GUC2VF_RELAY_FROM_PF,
+		FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_NO_RESPONSE_BUSY),
+	};
+	u32 reply[] = {
+		MSG_GUC2VF_RELAY_FROM_PF,
+		FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS) |
+		FIELD_PREP(GUC_HXG_RESPONSE_MSG_0_DATA0, 7),
+	};
+	struct intel_iov_relay_pending pending;
+	u32 buf[GUC_HXG_MSG_MIN_LEN];
+	struct pipelined_params params = {};
+	int err, ret;
+
+	iov->relay.selftest.disable_strict = 1;
+	iov->relay.selftest.data = &params;
+	iov->relay.selftest.host2guc = vf2guc_record_relay_id;
+
+	err = intel_iov_relay_submit_to_pf(&iov->relay, &pending, msg, ARRAY_SIZE(msg),
+					   buf, ARRAY_SIZE(buf));
+	if (err < 0) {
+		IOV_SELFTEST_ERROR(iov, "failed to submit request, %d\n", err);
+		goto out;
+	}
+
+	busy[1] = FIELD_PREP(GUC2VF_RELAY_FROM_PF_EVENT_MSG_1_RELAY_ID, params.relay_ids[0]);
+	reply[1] = busy[1];
+
+	/* both replies arrive before the requester wakes up */
+	err = intel_iov_relay_process_guc2vf(&iov->relay, busy, ARRAY_SIZE(busy));
+	if (!err)
+		err = intel_iov_relay_process_guc2vf(&iov->relay, reply, ARRAY_SIZE(reply));
+	if (err)
+		IOV_SELFTEST_ERROR(iov, "failed to process reply, %d\n", err);
+
+	ret = intel_iov_relay_wait_for_pf(&iov->relay, &pending);
+	if (!err && ret < 0) {
+		IOV_SELFTEST_ERROR(iov, "request failed, %d\n", ret);
+		err = ret;
+	} else if (!err && buf[0] != 7) {
+		IOV_SELFTEST_ERROR(iov, "unexpected reply data %u\n", buf[0]);
+		err = -EBADMSG;
+	}
+
+out:
+	iov->relay.selftest.disable_strict = 0;
+	iov->relay.selftest.host2guc = NULL;
+	iov->relay.selftest.data = NULL;
+
+	return err;
+}
+
 int selftest_mock_iov_relay(void)
 {
 	static const struct i915_subtest mock_tests[] = {
@@ -710,6 +922,9 @@ int selftest_mock_iov_relay(void)
 		SUBTEST(mock_prepares_pf2guc_and_waits),
 		SUBTEST(mock_prepares_pf2guc_and_fails),
 		SUBTEST(mock_prepares_pf2guc_and_retries),
+		SUBTEST(mock_submits_vf2guc_pipelined),
+		SUBTEST(mock_drops_duplicated_vf2guc_reply),
+		SUBTEST(mock_keeps_final_vf2guc_reply_after_busy),
 	};
 	struct drm_i915_private *i915;
 	struct intel_iov *iov;
@@ -724,6 +939,7 @@ int selftest_mock_iov_relay(void)
 
 	err = i915_subtests(mock_tests, iov);
 
+	intel_iov_relay_release(&iov->relay);
 	mock_destroy_device(i915);
 	return err;
 }
@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright(c) 2024 Intel Corporation. All rights reserved.
+ */
+
+#include "selftests/mock_gem_device.h"
+
+static int mock_sched_idle_vf_gets_min(void *arg)
+{
+	struct intel_iov *iov = arg;
+	u32 exec_quantum;
+
+	exec_quantum = sched_next_exec_quantum(20, 0, 50, 2, 40);
+	if (exec_quantum != 2) {
+		IOV_SELFTEST_ERROR(iov, "idle VF got %u instead of %u\n", exec_quantum, 2);
+		return -EINVAL;
+	}
+
+	/* infinite execution quantum must be reduced too */
+	exec_quantum = sched_next_exec_quantum(0, 0, 50, 2, 40);
+	if (exec_quantum != 2) {
+		IOV_SELFTEST_ERROR(iov, "idle VF got %u instead of %u\n", exec_quantum, 2);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int mock_sched_busy_vf_converges(void *arg)
+{
+	struct intel_iov *iov = arg;
+	static const struct {
+		u32 exec_quantum;
+		u32 busyness;
+		u32 target;
+		u32 expected;
+	} testcases[] = {
+		/* on target: no change */
+		{ 20, 50, 50, 20 },
+		/* under-served: half way to 2x */
+		{ 20, 25, 50, 30 },
+		/* over-served: half way to 1/2x */
+		{ 20, 80, 40, 15 },
+		/* clamped to max */
+		{ 40, 10, 100, 40 },
+		/* clamped to min */
+		{ 4, 100, 1, 2 },
+		/* infinite starts from max */
+		{ 0, 100, 50, 30 },
+	};
+	unsigned int n;
+	u32 exec_quantum;
+
+	for (n = 0; n < ARRAY_SIZE(testcases); n++) {
+		exec_quantum = sched_next_exec_quantum(testcases[n].exec_quantum,
+						       testcases[n].busyness,
+						       testcases[n].target, 2, 40);
+		if (exec_quantum != testcases[n].expected) {
+			IOV_SELFTEST_ERROR(iov, "case%u got %u instead of %u\n",
+					   n, exec_quantum, testcases[n].expected);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+int selftest_mock_iov_sched(void)
+{
+	static const struct i915_subtest mock_tests[] = {
+		SUBTEST(mock_sched_idle_vf_gets_min),
+		SUBTEST(mock_sched_busy_vf_converges),
+	};
+	struct drm_i915_private *i915;
+	int err;
+
+	i915 = mock_gem_device();
+	if (!i915)
+		return -ENOMEM;
+
+	err = i915_subtests(mock_tests, &to_gt(i915)->iov);
+
+	mock_destroy_device(i915);
+
+	return err;
+}
@@ -201,6 +201,139 @@ static int mock_handshake_reject_invalid(void *arg)
 	return ret;
 }
 
+static int host2guc_capture(struct intel_iov_relay *relay, const u32 *msg_recvd, u32 len)
+{
+	u32 *buf = relay->selftest.data;
+
+	GEM_BUG_ON(len < PF2GUC_RELAY_TO_VF_REQUEST_MSG_MIN_LEN);
+	GEM_BUG_ON(len > PF2GUC_RELAY_TO_VF_REQUEST_MSG_MAX_LEN);
+
+	/* msg_recvd is full H2G, save IOV message preceded by its length */
+	buf[0] = len - PF2GUC_RELAY_TO_VF_REQUEST_MSG_MIN_LEN;
+	memcpy(buf + 1, msg_recvd + PF2GUC_RELAY_TO_VF_REQUEST_MSG_MIN_LEN,
+	       buf[0] * sizeof(u32));
+
+	return 0;
+}
+
+static int mock_query_runtime_snapshot(struct intel_iov *iov, u32 generation,
+				       u32 *count, u32 *current_generation)
+{
+	u32 msg[VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_LEN] = {
+		FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_REQUEST) |
+		FIELD_PREP(GUC_HXG_REQUEST_MSG_0_ACTION, IOV_ACTION_VF2PF_QUERY_RUNTIME_SNAPSHOT),
+		FIELD_PREP(VF2PF_QUERY_RUNTIME_SNAPSHOT_REQUEST_MSG_1_GENERATION, generation),
+	};
+	u32 *buf = iov->relay.selftest.data;
+	int err;
+
+	buf[0] = 0;
+	iov->relay.selftest.host2guc = host2guc_capture;
+	err = intel_iov_service_process_msg(iov, SELFTEST_VF_ID, SELFTEST_RELAY_ID, msg,
+					    ARRAY_SIZE(msg));
+	if (err)
+		return err;
+
+	if (buf[0] < VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN)
+		return -EPROTO;
+
+	*count = FIELD_GET(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_0_COUNT, buf[1]);
+	*current_generation = FIELD_GET(VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_1_GENERATION,
+					buf[2]);
+
+	if (buf[0] != VF2PF_QUERY_RUNTIME_SNAPSHOT_RESPONSE_MSG_MIN_LEN + 2 * *count)
+		return -EPROTO;
+
+	return 0;
+}
+
+static int mock_runtime_snapshot(void *arg)
+{
+	static const i915_reg_t regs[] = { _MMIO(0x100), _MMIO(0x200), _MMIO(0x300) };
+	struct intel_iov *iov = arg;
+	struct intel_iov_runtime_regs *runtime = &iov->pf.service.runtime;
+	u32 values[ARRAY_SIZE(regs)] = { 0x11, 0x22, 0x33 };
+	u32 count, generation, first;
+	u32 *buf;
+	int err, i;
+
+	buf = kcalloc(VF2PF_MSG_MAX_LEN + 1, sizeof(u32), GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	runtime->size = ARRAY_SIZE(regs);
+	runtime->regs = regs;
+	runtime->values = values;
+	iov->relay.selftest.data = buf;
+
+	pf_publish_runtime_snapshot(iov);
+
+	/* VF without cached data gets all registers */
+	err = mock_query_runtime_snapshot(iov, 0, &count, &first);
+	if (err || count != ARRAY_SIZE(regs) || !first) {
+		IOV_SELFTEST_ERROR(iov, "full snapshot query failed %d count=%u generation=%#x\n",
+				   err, count, first);
+		err = -ENOTSOCK;
+		goto out;
+	}
+	for (i = 0; i < ARRAY_SIZE(regs); i++) {
+		if (buf[3 + 2 * i] != i915_mmio_reg_offset(regs[i]) ||
+		    buf[3 + 2 * i + 1] != values[i]) {
+			IOV_SELFTEST_ERROR(iov, "unexpected entry%d %#x:%#x\n",
+					   i, buf[3 + 2 * i], buf[3 + 2 * i + 1]);
+			err = -ENOTSOCK;
+			goto out;
+		}
+	}
+
+	/* republishing unchanged values must not bump the generation */
+	pf_publish_runtime_snapshot(iov);
+
+	/* VF with current generation gets no registers */
+	err = mock_query_runtime_snapshot(iov, first, &count, &generation);
+	if (err || count || generation != first) {
+		IOV_SELFTEST_ERROR(iov, "cached snapshot query failed %d count=%u generation=%#x\n",
+				   err, count, generation);
+		err = -ENOTSOCK;
+		goto out;
+	}
+
+	/* any change must result in a new generation */
+	values[1]++;
+	pf_publish_runtime_snapshot(iov);
+
+	err = mock_query_runtime_snapshot(iov, first, &count, &generation);
+	if (err || count != ARRAY_SIZE(regs) || !generation || generation == first ||
+	    buf[3 + 2 * 1 + 1] != values[1]) {
+		IOV_SELFTEST_ERROR(iov, "updated snapshot query failed %d count=%u generation=%#x\n",
+				   err, count, generation);
+		err = -ENOTSOCK;
+		goto out;
+	}
+
+	/* without snapshot VF must be told to fall back */
+	pf_replace_runtime_snapshot(iov, NULL);
+
+	err = mock_query_runtime_snapshot(iov, generation, &count, &generation);
+	if (err != -ENODATA) {
+		IOV_SELFTEST_ERROR(iov, "missing snapshot query returned %d\n", err);
+		err = -ENOTSOCK;
+		goto out;
+	}
+	err = 0;
+
+out:
+	pf_replace_runtime_snapshot(iov, NULL);
+	iov->relay.selftest.host2guc = NULL;
+	iov->relay.selftest.data = NULL;
+	runtime->values = NULL;
+	runtime->regs = NULL;
+	runtime->size = 0;
+	kfree(buf);
+	return err;
+}
+
 int selftest_mock_iov_service(void)
 {
 	static const struct i915_subtest mock_tests[] = {
@@ -210,6 +343,7 @@ int selftest_mock_iov_service(void)
 		SUBTEST(mock_handshake_with_newer),
 		SUBTEST(mock_handshake_latest_pf_support),
 		SUBTEST(mock_handshake_reject_invalid),
+		SUBTEST(mock_runtime_snapshot),
 	};
 	struct drm_i915_private *i915;
 	struct intel_iov *iov;
@@ -0,0 +1,319 @@
+// SPDX-License-Identifier: MIT
+/*
+ * Copyright(c) 2024 Intel Corporation. All rights reserved.
+ */
+
+#include "selftests/mock_gem_device.h"
+
+#define MOCK_NUM_VFS		7
+#define MOCK_VF_GGTT_SIZE	SZ_64M
+#define MOCK_VF_STATE_DWORDS	2503
+
+struct mock_vf_state {
+	u32 *saved;
+	u32 *restored;
+	u32 num_dwords;
+};
+
+static int mock_save_restore(struct intel_iov *iov, u32 vfid, u32 opcode, void *blob,
+			     u32 num_dwords)
+{
+	struct mock_vf_state *state = iov->pf.state.selftest.data;
+
+	switch (opcode) {
+	case GUC_PF_OPCODE_VF_SAVE:
+		if (!blob)
+			return state->num_dwords;
+		if (num_dwords < state->num_dwords)
+			return -ENOBUFS;
+		memcpy(blob, state->saved, state->num_dwords * sizeof(u32));
+		return state->num_dwords;
+	case GUC_PF_OPCODE_VF_RESTORE:
+		if (num_dwords < state->num_dwords)
+			return -EINVAL;
+		memcpy(state->restored, blob, state->num_dwords * sizeof(u32));
+		return num_dwords;
+	default:
+		return -EINVAL;
+	}
+}
+
+static int mock_update_ptes(struct intel_iov *iov, struct sg_table *st, gen8_pte_t pte_pattern)
+{
+	return 0;
+}
+
+static gen8_pte_t make_pte(u64 seed, unsigned int vfid)
+{
+	return FIELD_PREP(MTL_GGTT_PTE_PAT_MASK, seed) |
+	       FIELD_PREP(GEN12_GGTT_PTE_ADDR_MASK, seed) |
+	       i915_ggtt_prepare_vf_pte(vfid);
+}
+
+static int mock_state_init(struct intel_iov *iov, unsigned int vfid, struct mock_vf_state *state)
+{
+	struct drm_i915_private *i915 = iov_to_gt(iov)->i915;
+	struct drm_mm_node *node;
+	u64 ggtt_addr;
+	u32 n;
+	int err;
+
+	i915->__mode = I915_IOV_MODE_SRIOV_PF;
+	i915->sriov.pf.driver_vfs = MOCK_NUM_VFS;
+	mutex_init(&iov->pf.provisioning.lock);
+
+	state->num_dwords = MOCK_VF_STATE_DWORDS;
+	state->saved = kvmalloc_array(state->num_dwords, sizeof(u32), GFP_KERNEL);
+	state->restored = kvzalloc(state->num_dwords * sizeof(u32), GFP_KERNEL);
+	iov->pf.provisioning.configs = kcalloc(1 + pf_get_totalvfs(iov),
+					       sizeof(*iov->pf.provisioning.configs), GFP_KERNEL);
+	if (!state->saved || !state->restored || !iov->pf.provisioning.configs) {
+		err = -ENOMEM;
+		goto err_free;
+	}
+
+	for (n = 0; n < state->num_dwords; n++)
+		state->saved[n] = n ^ 0x5a5a5a5a;
+
+	node = &iov->pf.provisioning.configs[vfid].ggtt_region;
+	node->start = 0;
+	node->size = MOCK_VF_GGTT_SIZE;
+	set_bit(DRM_MM_NODE_ALLOCATED_BIT, &node->flags);
+
+	err = intel_iov_ggtt_shadow_init(iov);
+	if (err)
+		goto err_free;
+
+	err = intel_iov_ggtt_shadow_vf_alloc(iov, vfid, node);
+	if (err)
+		goto err_shadow;
+
+	for (ggtt_addr = node->start; ggtt_addr < node->start + node->size;
+	     ggtt_addr += I915_GTT_PAGE_SIZE_4K)
+		intel_iov_ggtt_shadow_set_pte(iov, vfid, ggtt_addr, make_pte(ggtt_addr, vfid));
+
+	iov->pf.ggtt.selftest.mock_update_ptes = mock_update_ptes;
+	iov->pf.state.selftest.mock_save_restore = mock_save_restore;
+	iov->pf.state.selftest.data = state;
+
+	return 0;
+
+err_shadow:
+	intel_iov_ggtt_shadow_fini(iov);
+err_free:
+	kfree(iov->pf.provisioning.configs);
+	iov->pf.provisioning.configs = NULL;
+	kvfree(state->restored);
+	kvfree(state->saved);
+	mutex_destroy(&iov->pf.provisioning.lock);
+	i915->sriov.pf.driver_vfs = 0;
+	i915->__mode = I915_IOV_MODE_NONE;
+	return err;
+}
+
+static void mock_state_fini(struct intel_iov *iov, unsigned int vfid, struct mock_vf_state *state)
+{
+	struct drm_i915_private *i915 = iov_to_gt(iov)->i915;
+
+	iov->pf.state.selftest.mock_save_restore = NULL;
+	iov->pf.state.selftest.data = NULL;
+	iov->pf.ggtt.selftest.mock_update_ptes = NULL;
+
+	intel_iov_ggtt_shadow_vf_free(iov, vfid);
+	intel_iov_ggtt_shadow_fini(iov);
+	kfree(iov->pf.provisioning.configs);
+	iov->pf.provisioning.configs = NULL;
+	kvfree(state->restored);
+	kvfree(state->saved);
+	mutex_destroy(&iov->pf.provisioning.lock);
+	i915->sriov.pf.driver_vfs = 0;
+	i915->__mode = I915_IOV_MODE_NONE;
+}
+
+static ssize_t mock_state_save(struct intel_iov *iov, unsigned int vfid, void *buf, size_t size)
+{
+	struct intel_iov_state_stream *stream;
+	size_t done = 0;
+	ssize_t ret;
+
+	stream = intel_iov_state_save_begin(iov, vfid);
+	if (IS_ERR(stream))
+		return PTR_ERR(stream);
+
+	do {
+		ret = intel_iov_state_save_next_chunk(stream, buf + done,
+						      min_t(size_t, SZ_4K, size - done));
+		if (ret > 0)
+			done += ret;
+	} while (ret > 0 && done < size);
+
+	intel_iov_state_save_end(stream);
+
+	if (ret < 0)
+		return ret;
+	if (done == size)
+		return -ENOSPC;
+
+	return done;
+}
+
+static int mock_state_restore(struct intel_iov *iov, unsigned int vfid, const void *buf,
+			      size_t size, const size_t *splits, unsigned int num_splits)
+{
+	struct intel_iov_state_stream *stream;
+	size_t done = 0, len;
+	unsigned int n = 0;
+	ssize_t ret = 0;
+	int err;
+
+	stream = intel_iov_state_restore_begin(iov, vfid);
+	if (IS_ERR(stream))
+		return PTR_ERR(stream);
+
+	while (done < size) {
+		len = min_t(size_t, splits[n++ % num_splits], size - done);
+		ret = intel_iov_state_restore_next_chunk(stream, buf + done, len);
+		if (ret < 0)
+			break;
+		if (ret != len) {
+			ret = -EPROTO;
+			break;
+		}
+		done += len;
+	}
+
+	err = intel_iov_state_restore_end(stream);
+
+	return ret < 0 ? ret : err;
+}
+
+static int mock_state_save_restore_roundtrip(void *arg)
+{
+	static const size_t as_saved[] = { SZ_4K };
+	static const size_t resplit[] = { 1, 15, 7, SZ_4K - 1, SZ_64K + 9 };
+	static const struct {
+		const size_t *splits;
+		unsigned int num_splits;
+	} cases[] = {
+		{ as_saved, ARRAY_SIZE(as_saved) },
+		{ resplit, ARRAY_SIZE(resplit) },
+	};
+	struct intel_iov *iov = arg;
+	const unsigned int vfid = VFID(1);
+	size_t ptes_size = ggtt_size_to_ptes_size(MOCK_VF_GGTT_SIZE);
+	size_t size = ptes_size + MOCK_VF_STATE_DWORDS * sizeof(u32) + SZ_4K;
+	struct mock_vf_state state;
+	gen8_pte_t *shadow, *expected;
+	unsigned int n;
+	ssize_t ret;
+	void *buf;
+	int err;
+
+	err = mock_state_init(iov, vfid, &state);
+	if (err)
+		return err;
+
+	shadow = iov->pf.ggtt.shadows_ggtt[vfid].ptes;
+	expected = kvmalloc(ptes_size, GFP_KERNEL);
+	buf = kvmalloc(size, GFP_KERNEL);
+	if (!expected || !buf) {
+		err = -ENOMEM;
+		goto out;
+	}
+	memcpy(expected, shadow, ptes_size);
+
+	ret = mock_state_save(iov, vfid, buf, size);
+	if (ret < 0) {
+		IOV_SELFTEST_ERROR(iov, "Failed to save VF%u state (%pe)\n", vfid, ERR_PTR(ret));
+		err = ret;
+		goto out;
+	}
+	size = ret;
+
+	for (n = 0; n < ARRAY_SIZE(cases); n++) {
+		memset(shadow, 0, ptes_size);
+		memset(state.restored, 0, state.num_dwords * sizeof(u32));
+
+		err = mock_state_restore(iov, vfid, buf, size, cases[n].splits,
+					 cases[n].num_splits);
+		if (err) {
+			IOV_SELFTEST_ERROR(iov, "Failed to restore VF%u state, case %u (%pe)\n",
+					   vfid, n, ERR_PTR(err));
+			goto out;
+		}
+
+		if (memcmp(shadow, expected, ptes_size)) {
+			IOV_SELFTEST_ERROR(iov, "GGTT PTEs mismatch after restore, case %u\n", n);
+			err = -EINVAL;
+			goto out;
+		}
+
+		if (memcmp(state.restored, state.saved, state.num_dwords * sizeof(u32))) {
+			IOV_SELFTEST_ERROR(iov, "GuC state mismatch after restore, case %u\n", n);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+
+out:
+	kvfree(buf);
+	kvfree(expected);
+	mock_state_fini(iov, vfid, &state);
+	return err;
+}
+
+static int mock_state_restore_oversized_guc(void *arg)
+{
+	struct intel_iov *iov = arg;
+	const unsigned int vfid = VFID(1);
+	struct iov_state_section hdr = {
+		.type = IOV_STATE_SECTION_GUC,
+		.size = (MOCK_VF_STATE_DWORDS + 1) * sizeof(u32),
+	};
+	struct intel_iov_state_stream *stream;
+	struct mock_vf_state state;
+	ssize_t ret;
+	int err;
+
+	err = mock_state_init(iov, vfid, &state);
+	if (err)
+		return err;
+
+	stream = intel_iov_state_restore_begin(iov, vfid);
+	if (IS_ERR(stream)) {
+		err = PTR_ERR(stream);
+		goto out;
+	}
+
+	ret = intel_iov_state_restore_next_chunk(stream, &hdr, sizeof(hdr));
+	if (ret != -EMSGSIZE) {
+		IOV_SELFTEST_ERROR(iov, "GuC state larger than reported was accepted (%zd)\n",
+				   ret);
+		err = -EINVAL;
+	}
+
+	intel_iov_state_restore_end(stream);
+out:
+	mock_state_fini(iov, vfid, &state);
+	return err;
+}
+
+int selftest_mock_iov_state(void)
+{
+	static const struct i915_subtest mock_tests[] = {
+		SUBTEST(mock_state_save_restore_roundtrip),
+		SUBTEST(mock_state_restore_oversized_guc),
+	};
+	struct drm_i915_private *i915;
+	int err;
+
+	i915 = mock_gem_device();
+	if (!i915)
+		return -ENOMEM;
+
+	err = i915_subtests(mock_tests, &to_gt(i915)->iov);
+
+	mock_destroy_device(i915);
+
+	return err;
+}
@@ -3,6 +3,9 @@
  * Copyright(c) 2022 Intel Corporation. All rights reserved.
  */
 
+#include <linux/kthread.h>
+#include <linux/sort.h>
+
 #define SELFTEST_RELAY_PERF_LOOP		100
 #define SELFTEST_RELAY_PERF_TIME_MS		100
 
@@ -246,3 +249,214 @@ int selftest_perf_iov_relay(struct drm_i915_private *i915)
 
 	return err;
 }
+
+#define SELFTEST_RELAY_BENCH_LOOP		1000
+#define SELFTEST_RELAY_BENCH_MAX_SENDERS	8
+
+/*
+ * Zero-latency GuC stand-in: every PF2GUC_RELAY_TO_VF is immediately
+ * answered by the "VF" with a success response that echoes the payload.
+ */
+static int mock_guc_echo_from_vf(struct intel_iov_relay *relay, const u32 *msg, u32 len)
+{
+	u32 reply[GUC2PF_RELAY_FROM_VF_EVENT_MSG_MAX_LEN] = {
+		MSG_GUC2PF_RELAY_FROM_VF(0),
+		FIELD_PREP(GUC_HXG_MSG_0_ORIGIN, GUC_HXG_ORIGIN_HOST) |
+		FIELD_PREP(GUC_HXG_MSG_0_TYPE, GUC_HXG_TYPE_RESPONSE_SUCCESS),
+	};
+	u32 data_len;
+
+	if (unlikely(len < PF2GUC_RELAY_TO_VF_REQUEST_MSG_MIN_LEN + GUC_HXG_MSG_MIN_LEN))
+		return -EPROTO;
+
+	if (unlikely(FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, msg[0]) !=
+		     GUC_ACTION_PF2GUC_RELAY_TO_VF))
+		return -ENOTTY;
+
+	data_len = len - PF2GUC_RELAY_TO_VF_REQUEST_MSG_MIN_LEN - GUC_HXG_MSG_MIN_LEN;
+	GEM_BUG_ON(GUC2PF_RELAY_FROM_VF_EVENT_MSG_MIN_LEN + GUC_HXG_MSG_MIN_LEN + data_len >
+		   ARRAY_SIZE(reply));
+
+	reply[1] = FIELD_PREP(GUC2PF_RELAY_FROM_VF_EVENT_MSG_1_VFID,
+			      FIELD_GET(PF2GUC_RELAY_TO_VF_REQUEST_MSG_1_VFID, msg[1]));
+	reply[2] = FIELD_PREP(GUC2PF_RELAY_FROM_VF_EVENT_MSG_2_RELAY_ID,
+			      FIELD_GET(PF2GUC_RELAY_TO_VF_REQUEST_MSG_2_RELAY_ID, msg[2]));
+	memcpy(&reply[GUC2PF_RELAY_FROM_VF_EVENT_MSG_MIN_LEN + GUC_HXG_MSG_MIN_LEN],
+	       &msg[PF2GUC_RELAY_TO_VF_REQUEST_MSG_MIN_LEN + GUC_HXG_MSG_MIN_LEN],
+	       4 * data_len);
+
+	return intel_iov_relay_process_guc2pf(relay, reply, GUC2PF_RELAY_FROM_VF_EVENT_MSG_MIN_LEN +
+					      GUC_HXG_MSG_MIN_LEN + data_len);
+}
+
+struct relay_bench_sender {
+	struct kthread_worker *worker;
+	struct kthread_work work;
+	struct intel_iov *iov;
+	u32 vfid;
+	u32 len;
+	u64 *samples;
+	int result;
+};
+
+static void relay_bench_sender_func(struct kthread_work *work)
+{
+	struct relay_bench_sender *sender = container_of(work, typeof(*sender), work);
+	struct intel_iov *iov = sender->iov;
+	u32 msg[PF2GUC_RELAY_TO_VF_REQUEST_MSG_NUM_RELAY_DATA] = {
+		MSG_IOV_SELFTEST_RELAY(SELFTEST_RELAY_OPCODE_ECHO),
+	};
+	u32 buf[PF2GUC_RELAY_TO_VF_REQUEST_MSG_NUM_RELAY_DATA];
+	unsigned int n;
+	int ret;
+
+	for (n = GUC_HXG_MSG_MIN_LEN; n < sender->len; n++)
+		msg[n] = FIELD_PREP(GUC_HXG_REQUEST_MSG_n_DATAn, SELFTEST_RELAY_DATA + n);
+
+	for (n = 0; n < SELFTEST_RELAY_BENCH_LOOP; n++) {
+		ktime_t start = ktime_get();
+
+		ret = intel_iov_relay_send_to_vf(&iov->relay, sender->vfid, msg, sender->len,
+						 buf, ARRAY_SIZE(buf));
+		sender->samples[n] = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+		if (ret != sender->len) {
+			sender->result = ret < 0 ? ret : -EBADMSG;
+			return;
+		}
+	}
+
+	sender->result = 0;
+}
+
+static int cmp_u64(const void *A, const void *B)
+{
+	const u64 *a = A, *b = B;
+
+	return *a < *b ? -1 : *a > *b;
+}
+
+static u64 percentile(const u64 *sorted, unsigned int count, unsigned int permille)
+{
+	return sorted[min_t(unsigned int, count - 1, div_u64(mul_u32_u32(count, permille), 1000))];
+}
+
+static int relay_bench_run(struct intel_iov *iov, unsigned int num_senders, u32 len)
+{
+	struct relay_bench_sender senders[SELFTEST_RELAY_BENCH_MAX_SENDERS] = {};
+	unsigned int count = num_senders * SELFTEST_RELAY_BENCH_LOOP;
+	ktime_t start, elapsed;
+	unsigned int n;
+	u64 *samples;
+	int err = 0;
+
+	GEM_BUG_ON(num_senders > ARRAY_SIZE(senders));
+
+	samples = kvmalloc_array(count, sizeof(*samples), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	for (n = 0; n < num_senders; n++) {
+		struct kthread_worker *worker;
+
+		worker = kthread_create_worker(0, "igt/relay:%u", n);
+		if (IS_ERR(worker)) {
+			err = PTR_ERR(worker);
+			break;
+		}
+
+		senders[n].worker = worker;
+		senders[n].iov = iov;
+		senders[n].vfid = VFID(n + 1);
+		senders[n].len = len;
+		senders[n].samples = samples + n * SELFTEST_RELAY_BENCH_LOOP;
+		kthread_init_work(&senders[n].work, relay_bench_sender_func);
+	}
+
+	start = ktime_get();
+	for (n = 0; n < num_senders && senders[n].worker; n++)
+		kthread_queue_work(senders[n].worker, &senders[n].work);
+
+	for (n = 0; n < num_senders && senders[n].worker; n++) {
+		kthread_flush_work(&senders[n].work);
+		err = err ?: senders[n].result;
+	}
+	elapsed = ktime_sub(ktime_get(), start);
+
+	for (n = 0; n < num_senders && senders[n].worker; n++)
+		kthread_destroy_worker(senders[n].worker);
+
+	if (err) {
+		IOV_SELFTEST_ERROR(iov, "%u senders, %u dwords failed %d\n", num_senders, len, err);
+		goto out;
+	}
+
+	sort(samples, count, sizeof(*samples), cmp_u64, NULL);
+
+	dev_info(iov_to_dev(iov),
+		 "%u senders, %2u dwords: %llu relays/s, latency p50 %llu p99 %llu p999 %llu max %llu ns\n",
+		 num_senders, len,
+		 div64_u64(mul_u32_u32(count, NSEC_PER_SEC), max_t(u64, ktime_to_ns(elapsed), 1)),
+		 percentile(samples, count, 500), percentile(samples, count, 990),
+		 percentile(samples, count, 999), samples[count - 1]);
+
+out:
+	kvfree(samples);
+	return err;
+}
+
+static int mock_relay_bench(void *arg)
+{
+	struct intel_iov *iov = arg;
+	unsigned int num_senders;
+	u32 len;
+	int err = 0;
+
+	iov->relay.selftest.disable_strict = 1;
+	iov->relay.selftest.mock_guc = mock_guc_echo_from_vf;
+
+	for (num_senders = 1; num_senders <= SELFTEST_RELAY_BENCH_MAX_SENDERS; num_senders *= 2) {
+		len = GUC_HXG_MSG_MIN_LEN;
+		do {
+			err = relay_bench_run(iov, num_senders, len);
+			if (len == PF2GUC_RELAY_TO_VF_REQUEST_MSG_NUM_RELAY_DATA)
+				break;
+			len = min_t(u32, 2 * len, PF2GUC_RELAY_TO_VF_REQUEST_MSG_NUM_RELAY_DATA);
+		} while (!err);
+		if (err)
+			break;
+	}
+
+	iov->relay.selftest.mock_guc = NULL;
+	iov->relay.selftest.disable_strict = 0;
+
+	if (!err && !xa_empty(&iov->relay.pending_relays)) {
+		IOV_SELFTEST_ERROR(iov, "requests still tracked\n");
+		err = -EINVAL;
+	}
+
+	return err;
+}
+
+int selftest_mock_perf_iov_relay(void)
+{
+	static const struct i915_subtest mock_tests[] = {
+		SUBTEST(mock_relay_bench),
+	};
+	struct drm_i915_private *i915;
+	struct intel_iov *iov;
+	int err;
+
+	i915 = mock_gem_device();
+	if (!i915)
+		return -ENOMEM;
+
+	iov = &to_gt(i915)->iov;
+	intel_iov_relay_init_early(&iov->relay);
+
+	err = i915_subtests(mock_tests, iov);
+
+	intel_iov_relay_release(&iov->relay);
+	mock_destroy_device(i915);
+	return err;
+}
@@ -91,6 +91,10 @@ static int relay_selftest_guc_send_nb(struct intel_guc *guc, const u32 *msg, u32
 {
 	struct intel_iov_relay *relay = &guc_to_gt(guc)->iov.relay;
 
+	/* unlike one-shot host2guc, mock GuC handles all messages */
+	if (unlikely(relay->selftest.mock_guc))
+		return relay->selftest.mock_guc(relay, msg, len);
+
 	if (unlikely(!IS_ERR_OR_NULL(relay->selftest.host2guc))) {
 		int ret = relay->selftest.host2guc(relay, msg, len);
 
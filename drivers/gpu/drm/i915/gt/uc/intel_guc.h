@@ -146,6 +146,12 @@ struct intel_guc {
 		 * (deregistered with the GuC)
 		 */
 		struct list_head destroyed_contexts;
+		/**
+		 * @deregistered_contexts: destroyed contexts with deregistration
+		 * confirmed by the GuC in the current batch of G2H messages,
+		 * only accessed from the CT incoming requests worker
+		 */
+		struct list_head deregistered_contexts;
 		/**
 		 * @destroyed_worker: worker to deregister contexts, need as we
 		 * need to take a GT PM reference and can't from destroy
@@ -303,12 +309,10 @@ struct intel_guc {
 	 */
 	unsigned long last_dead_guc_jiffies;
 
-#ifdef CONFIG_DRM_I915_SELFTEST
 	/**
 	 * @number_guc_id_stolen: The number of guc_ids that have been stolen
 	 */
 	int number_guc_id_stolen;
-#endif
 };
 
 /*
@@ -388,6 +392,36 @@ retry:
 	return err;
 }
 
+static inline int intel_guc_send_batch(struct intel_guc *guc,
+				       const struct intel_guc_ct_msg *msgs,
+				       unsigned int count)
+{
+	return intel_guc_ct_send_batch(&guc->ct, msgs, count, 0);
+}
+
+static inline int intel_guc_send_batch_busy_loop(struct intel_guc *guc,
+						 const struct intel_guc_ct_msg *msgs,
+						 unsigned int count,
+						 u32 g2h_len_dw)
+{
+	unsigned int sleep_period_ms = 1;
+	int err;
+
+	might_sleep();
+
+retry:
+	err = intel_guc_ct_send_batch(&guc->ct, msgs, count,
+				      MAKE_SEND_FLAGS(g2h_len_dw));
+	if (unlikely(err == -EBUSY)) {
+		if (msleep_interruptible(sleep_period_ms))
+			return -EINTR;
+		sleep_period_ms = sleep_period_ms << 1;
+		goto retry;
+	}
+
+	return err;
+}
+
 /* Only call this from the interrupt handler code */
 static inline void intel_guc_to_host_event_handler(struct intel_guc *guc)
 {
@@ -537,6 +571,7 @@ int intel_guc_engine_failure_process_msg(struct intel_guc *guc,
 int intel_guc_error_capture_process_msg(struct intel_guc *guc,
 					const u32 *msg, u32 len);
 int intel_guc_crash_process_msg(struct intel_guc *guc, u32 action);
+void intel_guc_g2h_batch_done(struct intel_guc *guc);
 
 struct intel_engine_cs *
 intel_guc_lookup_engine(struct intel_guc *guc, u8 guc_class, u8 instance);
@@ -4,12 +4,14 @@
  */
 
 #include <linux/circ_buf.h>
+#include <linux/hash.h>
 #include <linux/ktime.h>
 #include <linux/time64.h>
 #include <linux/string_helpers.h>
 #include <linux/timekeeping.h>
 
 #include "i915_drv.h"
+#include "i915_trace.h"
 #include "intel_guc_ct.h"
 #include "intel_guc_print.h"
 #include "gt/iov/intel_iov_event.h"
@@ -99,16 +101,30 @@ static inline struct drm_i915_private *ct_to_i915(struct intel_guc_ct *ct)
 #define CTB_G2H_BUFFER_SIZE	(4 * CTB_H2G_BUFFER_SIZE)
 #define G2H_ROOM_BUFFER_SIZE	(CTB_G2H_BUFFER_SIZE / 4)
 
+/*
+ * Incoming G2H messages are copied into slots preallocated per CT, so that
+ * the receive path does not depend on atomic allocations. Slots fit all the
+ * frequent notifications (context scheduling, deregistration, TLB, adverse
+ * events), bigger messages and a pool overflow fall back to kmalloc().
+ */
+#define CT_MSG_POOL_SLOTS	128
+#define CT_MSG_POOL_SLOT_LEN	16
+
 struct ct_request {
 	struct list_head link;
 	u32 fence;
+	u32 action;
+	ktime_t sent;
 	u32 status;
 	u32 response_len;
 	u32 *response_buf;
 };
 
 struct ct_incoming_msg {
-	struct list_head link;
+	union {
+		struct list_head link;
+		struct llist_node free_link;
+	};
 	u32 size;
 	u32 msg[];
 };
@@ -280,6 +296,41 @@ failed:
 	return err;
 }
 
+static size_t ct_msg_slot_size(void)
+{
+	struct ct_incoming_msg *msg;
+
+	return struct_size(msg, msg, CT_MSG_POOL_SLOT_LEN);
+}
+
+static int ct_msg_pool_init(struct intel_guc_ct *ct)
+{
+	size_t slot_size = ct_msg_slot_size();
+	unsigned int n;
+	void *slots;
+
+	slots = kcalloc(CT_MSG_POOL_SLOTS, slot_size, GFP_KERNEL);
+	if (!slots)
+		return -ENOMEM;
+
+	init_llist_head(&ct->msg_pool.free);
+	for (n = 0; n < CT_MSG_POOL_SLOTS; n++) {
+		struct ct_incoming_msg *msg = slots + n * slot_size;
+
+		llist_add(&msg->free_link, &ct->msg_pool.free);
+	}
+	ct->msg_pool.slots = slots;
+
+	return 0;
+}
+
+static void ct_msg_pool_fini(struct intel_guc_ct *ct)
+{
+	kfree(ct->msg_pool.slots);
+	ct->msg_pool.slots = NULL;
+	init_llist_head(&ct->msg_pool.free);
+}
+
 /**
  * intel_guc_ct_init - Init buffer-based communication
  * @ct: pointer to CT struct
@@ -337,6 +388,14 @@ int intel_guc_ct_init(struct intel_guc_ct *ct)
 
 	guc_ct_buffer_init(&ct->ctbs.recv, desc, cmds, cmds_size, resv_space);
 
+	err = ct_msg_pool_init(ct);
+	if (unlikely(err)) {
+		CT_PROBE_ERROR(ct, "Failed to allocate G2H message pool (%pe)\n",
+			       ERR_PTR(err));
+		i915_vma_unpin_and_release(&ct->vma, I915_VMA_RELEASE_MAP);
+		return err;
+	}
+
 	return 0;
 }
 
@@ -364,6 +423,9 @@ void intel_guc_ct_fini(struct intel_guc_ct *ct)
 		cancel_delayed_work_sync(&ct->mtl_workaround.work);
 
 	tasklet_kill(&ct->receive_tasklet);
+	/* incoming requests may still occupy the pool slots */
+	flush_work(&ct->requests.worker);
+	ct_msg_pool_fini(ct);
 	i915_vma_unpin_and_release(&ct->vma, I915_VMA_RELEASE_MAP);
 	memset(ct, 0, sizeof(*ct));
 }
@@ -482,20 +544,12 @@ static u32 ct_get_next_fence(struct intel_guc_ct *ct)
 	return ++ct->requests.last_fence;
 }
 
-static int ct_write(struct intel_guc_ct *ct,
-		    const u32 *action,
-		    u32 len /* in dwords */,
-		    u32 fence, u32 flags)
+static int ct_check_send_desc(struct intel_guc_ct *ct)
 {
 	struct intel_guc_ct_buffer *ctb = &ct->ctbs.send;
 	struct guc_ct_buffer_desc *desc = ctb->desc;
 	u32 tail = ctb->tail;
 	u32 size = ctb->size;
-	u32 header;
-	u32 hxg;
-	u32 type;
-	u32 *cmds = ctb->cmds;
-	unsigned int i;
 
 	if (unlikely(desc->status))
 		goto corrupted;
@@ -517,6 +571,120 @@ static int ct_write(struct intel_guc_ct *ct,
 	}
 #endif
 
+	return 0;
+
+corrupted:
+	CT_ERROR(ct, "Corrupted descriptor head=%u tail=%u status=%#x\n",
+		 desc->head, desc->tail, desc->status);
+	CT_DEAD(ct, WRITE);
+	ctb->broken = true;
+	return -EPIPE;
+}
+
+static void ct_hist_add(struct intel_guc_ct_hist *hist, u32 us)
+{
+	unsigned int bucket = us ? min_t(unsigned int, ilog2(us) + 1,
+					 INTEL_GUC_CT_HIST_BUCKETS - 1) : 0;
+	int max = atomic_read(&hist->max_us);
+
+	atomic_inc(&hist->buckets[bucket]);
+	atomic64_inc(&hist->count);
+	atomic64_add(us, &hist->total_us);
+	while ((u32)max < us && !atomic_try_cmpxchg(&hist->max_us, &max, us))
+		;
+}
+
+static void ct_hist_reset(struct intel_guc_ct_hist *hist)
+{
+	unsigned int n;
+
+	for (n = 0; n < INTEL_GUC_CT_HIST_BUCKETS; n++)
+		atomic_set(&hist->buckets[n], 0);
+	atomic64_set(&hist->count, 0);
+	atomic64_set(&hist->total_us, 0);
+	atomic_set(&hist->max_us, 0);
+}
+
+/*
+ * Each action code owns the slot selected by its hash, taken on first use.
+ * Actions colliding with an already taken slot are only counted as untracked.
+ */
+static struct intel_guc_ct_hist *ct_stats_hist(struct intel_guc_ct *ct, u32 action,
+					       bool response)
+{
+	typeof(ct->stats.actions[0]) *slot;
+	int key = action + 1;
+	int old;
+
+	slot = &ct->stats.actions[hash_32(action, INTEL_GUC_CT_HIST_ACTIONS_SHIFT)];
+	old = atomic_read(&slot->key);
+	if (unlikely(!old) && atomic_try_cmpxchg(&slot->key, &old, key))
+		old = key;
+	if (unlikely(old != key))
+		return NULL;
+
+	return response ? &slot->response : &slot->queue;
+}
+
+static void ct_stats_h2g(struct intel_guc_ct *ct, u32 action, u32 len, u32 fence,
+			 ktime_t queued)
+{
+	struct intel_guc_ct_hist *hist;
+	u32 queue_us;
+
+	/* KTIME_MAX means the message was written without any delay */
+	queue_us = queued == KTIME_MAX ? 0 : ktime_us_delta(ktime_get(), queued);
+	trace_intel_guc_ct_h2g(ct_to_gt(ct), fence, action, len, queue_us);
+
+	hist = ct_stats_hist(ct, action, false);
+	if (likely(hist))
+		ct_hist_add(hist, queue_us);
+	else
+		atomic64_inc(&ct->stats.untracked);
+}
+
+static void ct_stats_response(struct intel_guc_ct *ct, struct ct_request *req)
+{
+	struct intel_guc_ct_hist *hist;
+	u32 response_us;
+
+	response_us = ktime_us_delta(ktime_get(), req->sent);
+	trace_intel_guc_ct_response(ct_to_gt(ct), req->fence, req->action, response_us);
+
+	hist = ct_stats_hist(ct, req->action, true);
+	if (likely(hist))
+		ct_hist_add(hist, response_us);
+}
+
+static void ct_stats_wait(struct intel_guc_ct *ct, struct ct_request *req,
+			  ktime_t start, int err)
+{
+	u32 wait_us;
+
+	wait_us = ktime_us_delta(ktime_get(), start);
+	trace_intel_guc_ct_wait(ct_to_gt(ct), req->fence, req->action, wait_us, err);
+
+	ct_hist_add(&ct->stats.wait, wait_us);
+}
+
+/*
+ * Return: new local tail, the message is not visible to the GuC
+ *         until the tail is published by ct_write_tail()
+ */
+static u32 ct_write_msg(struct intel_guc_ct *ct, u32 tail,
+			const u32 *action,
+			u32 len /* in dwords */,
+			u32 fence, u32 flags,
+			ktime_t queued)
+{
+	struct intel_guc_ct_buffer *ctb = &ct->ctbs.send;
+	u32 size = ctb->size;
+	u32 header;
+	u32 hxg;
+	u32 type;
+	u32 *cmds = ctb->cmds;
+	unsigned int i;
+
 	/*
 	 * dw0: CT header (including fence)
 	 * dw1: HXG header (including action code)
@@ -551,6 +719,16 @@ static int ct_write(struct intel_guc_ct *ct,
 	ct_track_lost_and_found(ct, fence,
 				FIELD_GET(GUC_HXG_EVENT_MSG_0_ACTION, action[0]));
 #endif
+	ct_stats_h2g(ct, FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, action[0]),
+		     len, fence, queued);
+
+	return tail;
+}
+
+static void ct_write_tail(struct intel_guc_ct *ct, u32 tail, u32 len_dw)
+{
+	struct intel_guc_ct_buffer *ctb = &ct->ctbs.send;
+	struct guc_ct_buffer_desc *desc = ctb->desc;
 
 	/*
 	 * make sure H2G buffer update and LRC tail update (if this triggering a
@@ -560,8 +738,12 @@ static int ct_write(struct intel_guc_ct *ct,
 
 	/* update local copies */
 	ctb->tail = tail;
-	GEM_BUG_ON(atomic_read(&ctb->space) < len + GUC_CTB_HDR_LEN);
-	atomic_sub(len + GUC_CTB_HDR_LEN, &ctb->space);
+	GEM_BUG_ON(atomic_read(&ctb->space) < len_dw);
+	atomic_sub(len_dw, &ctb->space);
+
+	WRITE_ONCE(ct->stats.h2g_hwm,
+		   max_t(u32, ct->stats.h2g_hwm,
+			 CIRC_CNT(tail, READ_ONCE(desc->head), ctb->size)));
 
 	/* now update descriptor */
 	WRITE_ONCE(desc->tail, tail);
@@ -577,15 +759,25 @@ static int ct_write(struct intel_guc_ct *ct,
 					  ct_to_guc(ct)->notify_reg);
 		}
 	}
+}
 
-	return 0;
+static int ct_write(struct intel_guc_ct *ct,
+		    const u32 *action,
+		    u32 len /* in dwords */,
+		    u32 fence, u32 flags,
+		    ktime_t queued)
+{
+	u32 tail;
+	int err;
 
-corrupted:
-	CT_ERROR(ct, "Corrupted descriptor head=%u tail=%u status=%#x\n",
-		 desc->head, desc->tail, desc->status);
-	CT_DEAD(ct, WRITE);
-	ctb->broken = true;
-	return -EPIPE;
+	err = ct_check_send_desc(ct);
+	if (unlikely(err))
+		return err;
+
+	tail = ct_write_msg(ct, ct->ctbs.send.tail, action, len, fence, flags, queued);
+	ct_write_tail(ct, tail, len + GUC_CTB_HDR_LEN);
+
+	return 0;
 }
 
 /**
@@ -605,6 +797,7 @@ corrupted:
  */
 static int wait_for_ct_request_update(struct intel_guc_ct *ct, struct ct_request *req, u32 *status)
 {
+	ktime_t start = ktime_get();
 	int err;
 	bool ct_enabled;
 
@@ -628,6 +821,8 @@ static int wait_for_ct_request_update(struct intel_guc_ct *ct, struct ct_request
 	if (!ct_enabled)
 		err = -ENODEV;
 
+	ct_stats_wait(ct, req, start, err);
+
 	*status = req->status;
 	return err;
 }
@@ -752,17 +947,20 @@ static int ct_send_nb(struct intel_guc_ct *ct,
 	struct intel_guc_ct_buffer *ctb = &ct->ctbs.send;
 	unsigned long spin_flags;
 	u32 g2h_len_dw = G2H_LEN_DW(flags);
+	ktime_t queued;
 	u32 fence;
 	int ret;
 
 	spin_lock_irqsave(&ctb->lock, spin_flags);
 
+	/* non-blocking senders retry on their own, the stall is our queue time */
+	queued = ct->stall_time;
 	ret = has_room_nb(ct, len + GUC_CTB_HDR_LEN, g2h_len_dw);
 	if (unlikely(ret))
 		goto out;
 
 	fence = ct_get_next_fence(ct);
-	ret = ct_write(ct, action, len, fence, flags);
+	ret = ct_write(ct, action, len, fence, flags, queued);
 	if (unlikely(ret))
 		goto out;
 
@@ -787,6 +985,7 @@ static int ct_send(struct intel_guc_ct *ct,
 	unsigned long flags;
 	unsigned int sleep_period_ms = 1;
 	bool send_again;
+	ktime_t queued;
 	u32 fence;
 	int err;
 
@@ -798,6 +997,7 @@ static int ct_send(struct intel_guc_ct *ct,
 
 resend:
 	send_again = false;
+	queued = ktime_get();
 
 	/*
 	 * We use a lazy spin wait loop here as we believe that if the CT
@@ -827,15 +1027,17 @@ retry:
 
 	fence = ct_get_next_fence(ct);
 	request.fence = fence;
+	request.action = FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION, action[0]);
 	request.status = 0;
 	request.response_len = response_buf_size;
 	request.response_buf = response_buf;
 
 	spin_lock(&ct->requests.lock);
+	request.sent = ktime_get();
 	list_add_tail(&request.link, &ct->requests.pending);
 	spin_unlock(&ct->requests.lock);
 
-	err = ct_write(ct, action, len, fence, 0);
+	err = ct_write(ct, action, len, fence, 0, queued);
 	g2h_reserve_space(ct, GUC_CTB_HXG_MSG_MAX_LEN);
 
 	spin_unlock_irqrestore(&ctb->lock, flags);
@@ -895,6 +1097,250 @@ unlink:
 	return err;
 }
 
+static u32 ct_batch_len(const struct intel_guc_ct_msg *msgs, unsigned int count)
+{
+	u32 len = 0;
+
+	while (count--)
+		len += msgs[count].len + GUC_CTB_HDR_LEN;
+
+	return len;
+}
+
+static int ct_send_batch_nb(struct intel_guc_ct *ct,
+			    const struct intel_guc_ct_msg *msgs,
+			    unsigned int count,
+			    u32 flags)
+{
+	struct intel_guc_ct_buffer *ctb = &ct->ctbs.send;
+	unsigned long spin_flags;
+	u32 h2g_len_dw = ct_batch_len(msgs, count);
+	u32 g2h_len_dw = G2H_LEN_DW(flags) * count;
+	ktime_t queued;
+	unsigned int n;
+	u32 tail;
+	int ret;
+
+	/* must fit at once, as we can't send only part of the batch */
+	if (unlikely(h2g_len_dw > ctb->size / 2))
+		return -EMSGSIZE;
+
+	spin_lock_irqsave(&ctb->lock, spin_flags);
+
+	queued = ct->stall_time;
+	ret = has_room_nb(ct, h2g_len_dw, g2h_len_dw);
+	if (unlikely(ret))
+		goto out;
+
+	ret = ct_check_send_desc(ct);
+	if (unlikely(ret))
+		goto out;
+
+	tail = ctb->tail;
+	for (n = 0; n < count; n++)
+		tail = ct_write_msg(ct, tail, msgs[n].action, msgs[n].len,
+				    ct_get_next_fence(ct), flags, queued);
+	ct_write_tail(ct, tail, h2g_len_dw);
+
+	g2h_reserve_space(ct, g2h_len_dw);
+	intel_guc_notify(ct_to_guc(ct));
+
+out:
+	spin_unlock_irqrestore(&ctb->lock, spin_flags);
+
+	return ret;
+}
+
+/* limited by the G2H space that we must reserve for each response */
+#define CT_SEND_BATCH_MAX	8
+
+static int ct_send_batch(struct intel_guc_ct *ct,
+			 const struct intel_guc_ct_msg *msgs,
+			 unsigned int count)
+{
+	struct intel_guc_ct_buffer *ctb = &ct->ctbs.send;
+	struct ct_request requests[CT_SEND_BATCH_MAX];
+	bool send_again[CT_SEND_BATCH_MAX] = {};
+	u32 h2g_len_dw = ct_batch_len(msgs, count);
+	u32 g2h_len_dw = GUC_CTB_HXG_MSG_MAX_LEN * count;
+	unsigned int sleep_period_ms = 1;
+	ktime_t queued = ktime_get();
+	unsigned long flags;
+	unsigned int n;
+	u32 status;
+	u32 tail;
+	int ret = 0;
+	int err;
+
+	GEM_BUG_ON(!count || count > CT_SEND_BATCH_MAX);
+	might_sleep();
+
+retry:
+	spin_lock_irqsave(&ctb->lock, flags);
+	if (unlikely(!h2g_has_room(ct, h2g_len_dw) ||
+		     !g2h_has_room(ct, g2h_len_dw))) {
+		if (ct->stall_time == KTIME_MAX)
+			ct->stall_time = ktime_get();
+		spin_unlock_irqrestore(&ctb->lock, flags);
+
+		if (unlikely(ct_deadlocked(ct)))
+			return -EPIPE;
+
+		if (msleep_interruptible(sleep_period_ms))
+			return -EINTR;
+		sleep_period_ms = sleep_period_ms << 1;
+
+		goto retry;
+	}
+
+	ct->stall_time = KTIME_MAX;
+
+	err = ct_check_send_desc(ct);
+	if (unlikely(err)) {
+		spin_unlock_irqrestore(&ctb->lock, flags);
+		return err;
+	}
+
+	spin_lock(&ct->requests.lock);
+	for (n = 0; n < count; n++) {
+		requests[n].fence = ct_get_next_fence(ct);
+		requests[n].action = FIELD_GET(GUC_HXG_REQUEST_MSG_0_ACTION,
+					       msgs[n].action[0]);
+		requests[n].sent = ktime_get();
+		requests[n].status = 0;
+		requests[n].response_len = 0;
+		requests[n].response_buf = NULL;
+		list_add_tail(&requests[n].link, &ct->requests.pending);
+	}
+	spin_unlock(&ct->requests.lock);
+
+	tail = ctb->tail;
+	for (n = 0; n < count; n++)
+		tail = ct_write_msg(ct, tail, msgs[n].action, msgs[n].len,
+				    requests[n].fence, 0, queued);
+	ct_write_tail(ct, tail, h2g_len_dw);
+	g2h_reserve_space(ct, g2h_len_dw);
+
+	spin_unlock_irqrestore(&ctb->lock, flags);
+
+	intel_guc_notify(ct_to_guc(ct));
+
+	for (n = 0; n < count; n++) {
+		err = wait_for_ct_request_update(ct, &requests[n], &status);
+		g2h_release_space(ct, GUC_CTB_HXG_MSG_MAX_LEN);
+		if (unlikely(err)) {
+			CT_ERROR(ct, "No response for request %#x (fence %u)\n",
+				 msgs[n].action[0], requests[n].fence);
+		} else if (FIELD_GET(GUC_HXG_MSG_0_TYPE, status) ==
+			   GUC_HXG_TYPE_NO_RESPONSE_RETRY) {
+			send_again[n] = true;
+			continue;
+		} else if (FIELD_GET(GUC_HXG_MSG_0_TYPE, status) !=
+			   GUC_HXG_TYPE_RESPONSE_SUCCESS) {
+			CT_ERROR(ct, "Sending action %#x failed status=%#X\n",
+				 msgs[n].action[0], status);
+			err = -EIO;
+		} else {
+			err = FIELD_GET(GUC_HXG_RESPONSE_MSG_0_DATA0, status);
+		}
+		if (msgs[n].status)
+			*msgs[n].status = err;
+		if (unlikely(err < 0) && !ret)
+			ret = err;
+	}
+
+	spin_lock_irqsave(&ct->requests.lock, flags);
+	for (n = 0; n < count; n++)
+		list_del(&requests[n].link);
+	spin_unlock_irqrestore(&ct->requests.lock, flags);
+
+	/* requests that GuC asked to retry are resent one by one */
+	for (n = 0; n < count; n++) {
+		if (likely(!send_again[n]))
+			continue;
+
+		CT_DEBUG(ct, "retrying request %#x\n", msgs[n].action[0]);
+		err = ct_send(ct, msgs[n].action, msgs[n].len, NULL, 0, &status);
+		if (msgs[n].status)
+			*msgs[n].status = err;
+		if (unlikely(err < 0) && !ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
+/**
+ * intel_guc_ct_send_batch - Send many H2G messages at once.
+ * @ct: pointer to CT struct
+ * @msgs: the messages to send
+ * @count: number of the messages
+ * @flags: send flags, as used by intel_guc_ct_send()
+ *
+ * Write all messages into the H2G buffer under single lock and notify the
+ * GuC only once, after the whole batch is visible to the GuC.
+ *
+ * With INTEL_GUC_CT_SEND_NB, all messages are sent as fast requests and each
+ * of them reserves G2H space as specified by @flags. The batch is either sent
+ * in full or not at all (-EBUSY), so the caller may safely retry.
+ *
+ * Otherwise, messages are sent in chunks that fit in the G2H space reserved
+ * for their responses, so each chunk rings the doorbell once, and the function
+ * waits for responses to all requests. There is no buffer for response data,
+ * so only actions with header-only responses can be batched; a response with
+ * any payload is reported by the CT layer as too long (-EMSGSIZE). The result
+ * of each message is stored in its &intel_guc_ct_msg.status, messages that
+ * were not sent are left with -ECANCELED.
+ *
+ * Return: 0 on success or the first negative error code on failure.
+ */
+int intel_guc_ct_send_batch(struct intel_guc_ct *ct,
+			    const struct intel_guc_ct_msg *msgs,
+			    unsigned int count, u32 flags)
+{
+	unsigned int chunk, n;
+	int ret = 0;
+	int err;
+
+	if (!(flags & INTEL_GUC_CT_SEND_NB)) {
+		for (n = 0; n < count; n++)
+			if (msgs[n].status)
+				*msgs[n].status = -ECANCELED;
+	}
+
+	if (unlikely(!ct->enabled)) {
+		struct intel_guc *guc = ct_to_guc(ct);
+		struct intel_uc *uc = container_of(guc, struct intel_uc, guc);
+
+		WARN(!uc->reset_in_progress, "Unexpected batch send: action=%#x\n",
+		     count ? msgs[0].action[0] : 0);
+		return -ENODEV;
+	}
+
+	if (unlikely(ct->ctbs.send.broken))
+		return -EPIPE;
+
+	if (!count)
+		return 0;
+
+	if (flags & INTEL_GUC_CT_SEND_NB)
+		return ct_send_batch_nb(ct, msgs, count, flags);
+
+	while (count) {
+		chunk = min_t(unsigned int, count, CT_SEND_BATCH_MAX);
+		err = ct_send_batch(ct, msgs, chunk);
+		if (unlikely(err) && !ret)
+			ret = err;
+		if (err == -EPIPE || err == -EINTR)
+			break;
+
+		msgs += chunk;
+		count -= chunk;
+	}
+
+	return ret;
+}
+
 /*
  * Command Transport (CT) buffer based GuC send function.
  */
@@ -934,19 +1380,47 @@ int intel_guc_ct_send(struct intel_guc_ct *ct, const u32 *action, u32 len,
 	return ret;
 }
 
-static struct ct_incoming_msg *ct_alloc_msg(u32 num_dwords)
+static bool ct_msg_is_pooled(struct intel_guc_ct *ct, struct ct_incoming_msg *msg)
+{
+	void *slots = ct->msg_pool.slots;
+
+	return slots && (void *)msg >= slots &&
+	       (void *)msg < slots + CT_MSG_POOL_SLOTS * ct_msg_slot_size();
+}
+
+/* must be called with the recv CTB lock held, it is the only consumer */
+static struct ct_incoming_msg *ct_alloc_msg(struct intel_guc_ct *ct, u32 num_dwords)
 {
 	struct ct_incoming_msg *msg;
+	struct llist_node *node = NULL;
 
-	msg = kmalloc(struct_size(msg, msg, num_dwords), GFP_ATOMIC);
-	if (msg)
-		msg->size = num_dwords;
+	lockdep_assert_held(&ct->ctbs.recv.lock);
+
+	if (num_dwords <= CT_MSG_POOL_SLOT_LEN)
+		node = llist_del_first(&ct->msg_pool.free);
+
+	if (node) {
+		msg = llist_entry(node, struct ct_incoming_msg, free_link);
+		ct->msg_pool.allocs++;
+	} else {
+		msg = kmalloc(struct_size(msg, msg, num_dwords), GFP_ATOMIC);
+		if (unlikely(!msg)) {
+			ct->msg_pool.failures++;
+			return NULL;
+		}
+		ct->msg_pool.overflows++;
+	}
+
+	msg->size = num_dwords;
 	return msg;
 }
 
-static void ct_free_msg(struct ct_incoming_msg *msg)
+static void ct_free_msg(struct intel_guc_ct *ct, struct ct_incoming_msg *msg)
 {
-	kfree(msg);
+	if (ct_msg_is_pooled(ct, msg))
+		llist_add(&msg->free_link, &ct->msg_pool.free);
+	else
+		kfree(msg);
 }
 
 /*
@@ -1016,6 +1490,8 @@ static int ct_read(struct intel_guc_ct *ct, struct ct_incoming_msg **msg)
 	CT_DEBUG(ct, "available %d (%u:%u:%u)\n", available, head, tail, size);
 	GEM_BUG_ON(available < 0);
 
+	WRITE_ONCE(ct->stats.g2h_hwm, max_t(u32, ct->stats.g2h_hwm, available));
+
 	header = cmds[head];
 	head = (head + 1) % size;
 
@@ -1032,7 +1508,7 @@ static int ct_read(struct intel_guc_ct *ct, struct ct_incoming_msg **msg)
 		goto corrupted;
 	}
 
-	*msg = ct_alloc_msg(len);
+	*msg = ct_alloc_msg(ct, len);
 	if (!*msg) {
 		CT_ERROR(ct, "No memory for message %*ph %*ph %*ph\n",
 			 4, &header,
@@ -1142,6 +1618,7 @@ static int ct_handle_response(struct intel_guc_ct *ct, struct ct_incoming_msg *r
 		if (datalen)
 			memcpy(req->response_buf, data, 4 * datalen);
 		req->response_len = datalen;
+		ct_stats_response(ct, req);
 		WRITE_ONCE(req->status, hxg[0]);
 		found = true;
 		break;
@@ -1161,7 +1638,7 @@ static int ct_handle_response(struct intel_guc_ct *ct, struct ct_incoming_msg *r
 	if (unlikely(err))
 		return err;
 
-	ct_free_msg(response);
+	ct_free_msg(ct, response);
 	return 0;
 }
 
@@ -1246,37 +1723,47 @@ static int ct_process_request(struct intel_guc_ct *ct, struct ct_incoming_msg *r
 		return ret;
 	}
 
-	ct_free_msg(request);
+	ct_free_msg(ct, request);
 	return 0;
 }
 
+static void ct_process_incoming_request(struct intel_guc_ct *ct,
+					struct ct_incoming_msg *request)
+{
+	int err;
+
+	err = ct_process_request(ct, request);
+	if (unlikely(err)) {
+		CT_ERROR(ct, "Failed to process CT message (%pe) %*ph\n",
+			 ERR_PTR(err), 4 * request->size, request->msg);
+		CT_DEAD(ct, PROCESS_FAILED);
+		ct_free_msg(ct, request);
+	}
+}
+
 static bool ct_process_incoming_requests(struct intel_guc_ct *ct)
 {
+	struct ct_incoming_msg *request, *next;
 	unsigned long flags;
-	struct ct_incoming_msg *request;
-	bool done;
-	int err;
+	LIST_HEAD(batch);
 
+	/* take all pending requests at once */
 	spin_lock_irqsave(&ct->requests.lock, flags);
-	request = list_first_entry_or_null(&ct->requests.incoming,
-					   struct ct_incoming_msg, link);
-	if (request)
-		list_del(&request->link);
-	done = !!list_empty(&ct->requests.incoming);
+	list_splice_init(&ct->requests.incoming, &batch);
 	spin_unlock_irqrestore(&ct->requests.lock, flags);
 
-	if (!request)
+	if (list_empty(&batch))
 		return true;
 
-	err = ct_process_request(ct, request);
-	if (unlikely(err)) {
-		CT_ERROR(ct, "Failed to process CT message (%pe) %*ph\n",
-			 ERR_PTR(err), 4 * request->size, request->msg);
-		CT_DEAD(ct, PROCESS_FAILED);
-		ct_free_msg(request);
+	list_for_each_entry_safe(request, next, &batch, link) {
+		list_del(&request->link);
+		ct_process_incoming_request(ct, request);
 	}
 
-	return done;
+	/* let handlers complete the work they deferred to the batch end */
+	intel_guc_g2h_batch_done(ct_to_guc(ct));
+
+	return false;
 }
 
 static void ct_incoming_request_worker_func(struct work_struct *w)
@@ -1376,7 +1863,7 @@ static void ct_handle_msg(struct intel_guc_ct *ct, struct ct_incoming_msg *msg)
 	if (unlikely(err)) {
 		CT_ERROR(ct, "Failed to process CT message (%pe) %*ph\n",
 			 ERR_PTR(err), 4 * msg->size, msg->msg);
-		ct_free_msg(msg);
+		ct_free_msg(ct, msg);
 	}
 }
 
@@ -1500,6 +1987,80 @@ void intel_guc_ct_print_info(struct intel_guc_ct *ct,
 		   ct->ctbs.recv.desc->head);
 	drm_printf(p, "Tail: %u\n",
 		   ct->ctbs.recv.desc->tail);
+	drm_printf(p, "G2H pooled allocs: %llu\n", READ_ONCE(ct->msg_pool.allocs));
+	drm_printf(p, "G2H overflow allocs: %llu\n", READ_ONCE(ct->msg_pool.overflows));
+	drm_printf(p, "G2H failed allocs: %llu\n", READ_ONCE(ct->msg_pool.failures));
+}
+
+static void ct_print_hist(struct drm_printer *p, const char *name,
+			  const struct intel_guc_ct_hist *hist)
+{
+	unsigned int n;
+
+	u64 count = atomic64_read(&hist->count);
+
+	drm_printf(p, "%s: count=%llu avg=%lluus max=%uus [", name, count,
+		   count ? div64_u64(atomic64_read(&hist->total_us), count) : 0,
+		   (u32)atomic_read(&hist->max_us));
+	for (n = 0; n < INTEL_GUC_CT_HIST_BUCKETS; n++)
+		drm_printf(p, "%s%u", n ? " " : "", (u32)atomic_read(&hist->buckets[n]));
+	drm_printf(p, "]\n");
+}
+
+/**
+ * intel_guc_ct_print_stats - Print CT latency and occupancy statistics.
+ * @ct: pointer to CT struct
+ * @p: the &drm_printer
+ *
+ * Histograms have INTEL_GUC_CT_HIST_BUCKETS buckets, where first bucket
+ * counts samples below 1us and each next bucket covers twice longer time.
+ */
+void intel_guc_ct_print_stats(struct intel_guc_ct *ct, struct drm_printer *p)
+{
+	unsigned int n;
+
+	drm_printf(p, "H2G high-water mark: %u/%u dwords\n",
+		   READ_ONCE(ct->stats.h2g_hwm), ct->ctbs.send.size);
+	drm_printf(p, "G2H high-water mark: %u/%u dwords\n",
+		   READ_ONCE(ct->stats.g2h_hwm), ct->ctbs.recv.size);
+	drm_printf(p, "buckets: <1us");
+	for (n = 1; n < INTEL_GUC_CT_HIST_BUCKETS - 1; n++)
+		drm_printf(p, " <%luus", BIT(n));
+	drm_printf(p, " >=%luus\n", BIT(n - 1));
+
+	ct_print_hist(p, "wait", &ct->stats.wait);
+	for (n = 0; n < ARRAY_SIZE(ct->stats.actions); n++) {
+		int key = atomic_read(&ct->stats.actions[n].key);
+
+		if (!key || !atomic64_read(&ct->stats.actions[n].queue.count))
+			continue;
+
+		drm_printf(p, "action %#06x:\n", key - 1);
+		ct_print_hist(p, "\tqueue", &ct->stats.actions[n].queue);
+		ct_print_hist(p, "\tresponse", &ct->stats.actions[n].response);
+	}
+	drm_printf(p, "untracked: %llu\n", (u64)atomic64_read(&ct->stats.untracked));
+}
+
+/**
+ * intel_guc_ct_reset_stats - Reset CT latency and occupancy statistics.
+ * @ct: pointer to CT struct
+ *
+ * Samples recorded while the reset is in progress may be partially lost.
+ * Action slots stay assigned to their action codes.
+ */
+void intel_guc_ct_reset_stats(struct intel_guc_ct *ct)
+{
+	unsigned int n;
+
+	for (n = 0; n < ARRAY_SIZE(ct->stats.actions); n++) {
+		ct_hist_reset(&ct->stats.actions[n].queue);
+		ct_hist_reset(&ct->stats.actions[n].response);
+	}
+	ct_hist_reset(&ct->stats.wait);
+	atomic64_set(&ct->stats.untracked, 0);
+	WRITE_ONCE(ct->stats.h2g_hwm, 0);
+	WRITE_ONCE(ct->stats.g2h_hwm, 0);
 }
 
 #if IS_ENABLED(CONFIG_DRM_I915_DEBUG_GUC)
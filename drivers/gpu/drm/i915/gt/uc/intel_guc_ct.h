@@ -7,6 +7,7 @@
 #define _INTEL_GUC_CT_H_
 
 #include <linux/interrupt.h>
+#include <linux/llist.h>
 #include <linux/spinlock.h>
 #include <linux/stackdepot.h>
 #include <linux/workqueue.h>
@@ -54,6 +55,29 @@ struct intel_guc_ct_buffer {
 	bool broken;
 };
 
+#define INTEL_GUC_CT_HIST_BUCKETS	16
+#define INTEL_GUC_CT_HIST_ACTIONS_SHIFT	6
+
+/**
+ * struct intel_guc_ct_hist - Histogram of CT latencies.
+ *
+ * Bucket 0 counts samples below 1us, bucket N counts samples in the range
+ * [2^(N-1), 2^N) us and the last bucket also counts all longer samples.
+ * All fields are updated locklessly, so readers may see a sample partially
+ * accounted.
+ *
+ * @buckets: number of samples in each bucket
+ * @count: total number of samples
+ * @total_us: sum of all samples in us
+ * @max_us: longest sample in us
+ */
+struct intel_guc_ct_hist {
+	atomic_t buckets[INTEL_GUC_CT_HIST_BUCKETS];
+	atomic64_t count;
+	atomic64_t total_us;
+	atomic_t max_us;
+};
+
 /** Top-level structure for Command Transport related data
  *
  * Includes a pair of CT buffers for bi-directional communication and tracking
@@ -94,6 +118,41 @@ struct intel_guc_ct {
 #endif
 	} requests;
 
+	/** @msg_pool: preallocated slots for incoming G2H messages */
+	struct {
+		/** @msg_pool.slots: memory of all slots */
+		void *slots;
+		/** @msg_pool.free: list of free slots */
+		struct llist_head free;
+		/** @msg_pool.allocs: number of messages received into slots */
+		u64 allocs;
+		/** @msg_pool.overflows: number of messages allocated with kmalloc */
+		u64 overflows;
+		/** @msg_pool.failures: number of failed message allocations */
+		u64 failures;
+	} msg_pool;
+
+	/** @stats: CT latency and occupancy statistics */
+	struct {
+		/** @stats.actions: per H2G action latencies, indexed by action hash */
+		struct {
+			/** @stats.actions.key: H2G action code + 1, 0 if slot is unused */
+			atomic_t key;
+			/** @stats.actions.queue: time from send until written to H2G */
+			struct intel_guc_ct_hist queue;
+			/** @stats.actions.response: time from write until response */
+			struct intel_guc_ct_hist response;
+		} actions[BIT(INTEL_GUC_CT_HIST_ACTIONS_SHIFT)];
+		/** @stats.untracked: H2G sent when action slot was already taken */
+		atomic64_t untracked;
+		/** @stats.wait: time spent waiting for the response */
+		struct intel_guc_ct_hist wait;
+		/** @stats.h2g_hwm: H2G occupancy high-water mark (dwords) */
+		u32 h2g_hwm;
+		/** @stats.g2h_hwm: G2H occupancy high-water mark (dwords) */
+		u32 g2h_hwm;
+	} stats;
+
 	/** @stall_time: time of first time a CTB submission is stalled */
 	ktime_t stall_time;
 
@@ -142,8 +201,27 @@ static inline bool intel_guc_ct_enabled(const struct intel_guc_ct *ct)
 })
 int intel_guc_ct_send(struct intel_guc_ct *ct, const u32 *action, u32 len,
 		      u32 *response_buf, u32 response_buf_size, u32 flags);
+
+/**
+ * struct intel_guc_ct_msg - H2G message sent as part of the batch.
+ * @action: action code followed by the action data
+ * @len: length of the @action (in dwords)
+ * @status: optional, where the blocking batch stores the data decoded from
+ *          the response to this message, or a negative error code
+ */
+struct intel_guc_ct_msg {
+	const u32 *action;
+	u32 len;
+	int *status;
+};
+
+int intel_guc_ct_send_batch(struct intel_guc_ct *ct,
+			    const struct intel_guc_ct_msg *msgs,
+			    unsigned int count, u32 flags);
 void intel_guc_ct_event_handler(struct intel_guc_ct *ct);
 
 void intel_guc_ct_print_info(struct intel_guc_ct *ct, struct drm_printer *p);
+void intel_guc_ct_print_stats(struct intel_guc_ct *ct, struct drm_printer *p);
+void intel_guc_ct_reset_stats(struct intel_guc_ct *ct);
 
 #endif /* _INTEL_GUC_CT_H_ */
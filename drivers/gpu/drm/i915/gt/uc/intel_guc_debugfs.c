@@ -41,6 +41,27 @@ static int guc_info_show(struct seq_file *m, void *data)
 }
 DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE(guc_info);
 
+static int guc_ct_stats_show(struct seq_file *m, void *data)
+{
+	struct intel_guc *guc = m->private;
+	struct drm_printer p = drm_seq_file_printer(m);
+
+	intel_guc_ct_print_stats(&guc->ct, &p);
+
+	return 0;
+}
+DEFINE_INTEL_GT_DEBUGFS_ATTRIBUTE(guc_ct_stats);
+
+static int guc_ct_stats_reset_set(void *data, u64 val)
+{
+	struct intel_guc *guc = data;
+
+	intel_guc_ct_reset_stats(&guc->ct);
+
+	return 0;
+}
+DEFINE_SIMPLE_ATTRIBUTE(guc_ct_stats_reset_fops, NULL, guc_ct_stats_reset_set, "%llu\n");
+
 static int guc_registered_contexts_show(struct seq_file *m, void *data)
 {
 	struct intel_guc *guc = m->private;
@@ -137,6 +158,8 @@ void intel_guc_debugfs_register(struct intel_guc *guc, struct dentry *root)
 {
 	static const struct intel_gt_debugfs_file files[] = {
 		{ "guc_info", &guc_info_fops, NULL },
+		{ "guc_ct_stats", &guc_ct_stats_fops, NULL },
+		{ "guc_ct_stats_reset", &guc_ct_stats_reset_fops, NULL },
 		{ "guc_registered_contexts", &guc_registered_contexts_fops, NULL },
 		{ "guc_slpc_info", &guc_slpc_info_fops, &intel_eval_slpc_support},
 		{ "guc_sched_disable_delay_ms", &guc_sched_disable_delay_ms_fops, NULL },
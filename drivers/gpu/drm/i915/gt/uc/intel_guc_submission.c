@@ -89,11 +89,15 @@
  * context registration / submission / deregistration. 64k available. Simple ida
  * is used for allocation.
  *
+ * A small part of the single-lrc guc_ids is reserved for high priority
+ * contexts, so they can still get a guc_id when all other ones are in use.
+ *
  * Stealing guc_ids:
  * If no guc_ids are available they can be stolen from another context at
- * request creation time if that context is unpinned. If a guc_id can't be found
- * we punt this problem to the user as we believe this is near impossible to hit
- * during normal use cases.
+ * request creation time if that context is unpinned. The least recently used
+ * guc_id is stolen, but high priority contexts are spared if possible. If a
+ * guc_id can't be found we punt this problem to the user as we believe this is
+ * near impossible to hit during normal use cases.
  *
  * Locking:
  * In the GuC submission code we have 3 basic spin locks which protect
@@ -2172,6 +2176,34 @@ static int mlrc_guc_id_base(struct intel_guc *guc)
 	return number_slrc_guc_id(guc);
 }
 
+/*
+ * We reserve 1/32 of the single-lrc guc_ids for high priority contexts. This
+ * matters most for VFs, which have a small quota of guc_ids, where otherwise
+ * the high priority contexts would keep stealing from (and being stolen by)
+ * the normal priority ones.
+ */
+#define HIGH_PRIO_GUC_ID_RATIO	32
+
+static int number_reserved_guc_id(struct intel_guc *guc)
+{
+	return number_slrc_guc_id(guc) / HIGH_PRIO_GUC_ID_RATIO;
+}
+
+static int reserved_guc_id_base(struct intel_guc *guc)
+{
+	return number_slrc_guc_id(guc) - number_reserved_guc_id(guc);
+}
+
+static bool context_has_high_prio(const struct intel_context *ce)
+{
+	/*
+	 * Priority is not known until the context is initialized. Boosts of
+	 * inflight requests don't count, as the guc_id outlives them.
+	 */
+	return test_bit(CONTEXT_GUC_INIT, &ce->flags) &&
+	       ce->guc_state.base_prio <= GUC_CLIENT_PRIORITY_HIGH;
+}
+
 static int new_mlrc_guc_id(struct intel_guc *guc, struct intel_context *ce)
 {
 	int ret;
@@ -2191,10 +2223,15 @@ static int new_mlrc_guc_id(struct intel_guc *guc, struct intel_context *ce)
 
 static int new_slrc_guc_id(struct intel_guc *guc, struct intel_context *ce)
 {
+	int end;
+
 	GEM_BUG_ON(intel_context_is_parent(ce));
 
-	return ida_simple_get(&guc->submission_state.guc_ids,
-			      0, number_slrc_guc_id(guc),
+	/* lowest free guc_id is used, so reserved ones are taken last */
+	end = context_has_high_prio(ce) ? number_slrc_guc_id(guc) :
+					  reserved_guc_id_base(guc);
+
+	return ida_simple_get(&guc->submission_state.guc_ids, 0, end,
 			      GFP_KERNEL | __GFP_RETRY_MAYFAIL |
 			      __GFP_NOWARN);
 }
@@ -2263,6 +2300,42 @@ static void release_guc_id(struct intel_guc *guc, struct intel_context *ce)
 	spin_unlock_irqrestore(&guc->submission_state.lock, flags);
 }
 
+/*
+ * The guc_id_list is in LRU order, as contexts are added at the tail once
+ * their guc_id is no longer used. Look at most at that many contexts, also
+ * counting the ones skipped for holding reserved guc_ids, for a victim which
+ * is not high priority, before falling back to the LRU one.
+ */
+#define STEAL_GUC_ID_SCAN	32
+
+static struct intel_context *find_guc_id_victim(struct intel_guc *guc,
+						struct intel_context *ce)
+{
+	int reserved_base = reserved_guc_id_base(guc);
+	bool high_prio = context_has_high_prio(ce);
+	struct intel_context *cn, *fallback = NULL;
+	unsigned int scan = 0;
+
+	lockdep_assert_held(&guc->submission_state.lock);
+
+	list_for_each_entry(cn, &guc->submission_state.guc_id_list, guc_id.link) {
+		if (scan++ == STEAL_GUC_ID_SCAN)
+			break;
+
+		/* reserved guc_ids can't be given to normal priority contexts */
+		if (!high_prio && cn->guc_id.id >= reserved_base)
+			continue;
+
+		if (!context_has_high_prio(cn))
+			return cn;
+
+		if (!fallback)
+			fallback = cn;
+	}
+
+	return fallback;
+}
+
 static int steal_guc_id(struct intel_guc *guc, struct intel_context *ce)
 {
 	struct intel_context *cn;
@@ -2271,11 +2344,8 @@ static int steal_guc_id(struct intel_guc *guc, struct intel_context *ce)
 	GEM_BUG_ON(intel_context_is_child(ce));
 	GEM_BUG_ON(intel_context_is_parent(ce));
 
-	if (!list_empty(&guc->submission_state.guc_id_list)) {
-		cn = list_first_entry(&guc->submission_state.guc_id_list,
-				      struct intel_context,
-				      guc_id.link);
-
+	cn = find_guc_id_victim(guc, ce);
+	if (cn) {
 		GEM_BUG_ON(atomic_read(&cn->guc_id.ref));
 		GEM_BUG_ON(context_guc_id_invalid(cn));
 		GEM_BUG_ON(intel_context_is_child(cn));
@@ -2290,9 +2360,7 @@ static int steal_guc_id(struct intel_guc *guc, struct intel_context *ce)
 
 		set_context_guc_id_invalid(cn);
 
-#ifdef CONFIG_DRM_I915_SELFTEST
 		guc->number_guc_id_stolen++;
-#endif
 
 		return 0;
 	} else {
@@ -3378,7 +3446,8 @@ static void guc_context_close(struct intel_context *ce)
 	spin_unlock_irqrestore(&ce->guc_state.lock, flags);
 }
 
-static inline void guc_lrc_desc_unpin(struct intel_context *ce)
+/* Return: true if the context must be deregistered from the GuC */
+static inline bool guc_lrc_desc_unpin(struct intel_context *ce)
 {
 	struct intel_guc *guc = ce_to_guc(ce);
 	struct intel_gt *gt = guc_to_gt(guc);
@@ -3402,10 +3471,10 @@ static inline void guc_lrc_desc_unpin(struct intel_context *ce)
 	if (unlikely(disabled)) {
 		release_guc_id(guc, ce);
 		__guc_context_destroy(ce);
-		return;
+		return false;
 	}
 
-	deregister_context(ce, ce->guc_id.id);
+	return true;
 }
 
 static void __guc_context_destroy(struct intel_context *ce)
@@ -3456,9 +3525,23 @@ static void guc_flush_destroyed_contexts(struct intel_guc *guc)
 	}
 }
 
+#define GUC_DEREGISTER_BATCH	16
+
+static void deregister_contexts_batch(struct intel_guc *guc,
+				      struct intel_guc_ct_msg *msgs,
+				      unsigned int count)
+{
+	atomic_add(count, &guc->outstanding_submission_g2h);
+	intel_guc_send_batch_busy_loop(guc, msgs, count,
+				       G2H_LEN_DW_DEREGISTER_CONTEXT);
+}
+
 static void deregister_destroyed_contexts(struct intel_guc *guc)
 {
+	u32 actions[GUC_DEREGISTER_BATCH][2];
+	struct intel_guc_ct_msg msgs[GUC_DEREGISTER_BATCH];
 	struct intel_context *ce;
+	unsigned int count = 0;
 	unsigned long flags;
 
 	while (!list_empty(&guc->submission_state.destroyed_contexts)) {
@@ -3473,8 +3556,26 @@ static void deregister_destroyed_contexts(struct intel_guc *guc)
 		if (!ce)
 			break;
 
-		guc_lrc_desc_unpin(ce);
+		if (!guc_lrc_desc_unpin(ce))
+			continue;
+
+		GEM_BUG_ON(intel_context_is_child(ce));
+		trace_intel_context_deregister(ce);
+
+		actions[count][0] = INTEL_GUC_ACTION_DEREGISTER_CONTEXT;
+		actions[count][1] = ce->guc_id.id;
+		msgs[count].action = actions[count];
+		msgs[count].len = ARRAY_SIZE(actions[count]);
+
+		/* one H2G doorbell for the whole batch of deregistrations */
+		if (++count == GUC_DEREGISTER_BATCH) {
+			deregister_contexts_batch(guc, msgs, count);
+			count = 0;
+		}
 	}
+
+	if (count)
+		deregister_contexts_batch(guc, msgs, count);
 }
 
 static void destroyed_worker_func(struct work_struct *w)
@@ -3777,7 +3878,8 @@ static void guc_context_init(struct intel_context *ce)
 		prio = ctx->sched.priority;
 	rcu_read_unlock();
 
-	ce->guc_state.prio = map_i915_prio_to_guc_prio(prio);
+	ce->guc_state.base_prio = map_i915_prio_to_guc_prio(prio);
+	ce->guc_state.prio = ce->guc_state.base_prio;
 
 	INIT_DELAYED_WORK(&ce->guc_state.sched_disable_delay_work,
 			  __delay_sched_disable);
@@ -4373,6 +4475,14 @@ static inline int guc_kernel_context_pin(struct intel_guc *guc,
 	 * isn't happening and even it did this code would be run again.
 	 */
 
+	/*
+	 * Kernel contexts have no GEM context, so they get the default
+	 * priority and never use the reserved guc_ids, but initialize them
+	 * first anyway, so the guc_id is picked with the registered priority.
+	 */
+	if (!test_bit(CONTEXT_GUC_INIT, &ce->flags))
+		guc_context_init(ce);
+
 	if (context_guc_id_invalid(ce)) {
 		ret = pin_guc_id(guc, ce);
 
@@ -4380,9 +4490,6 @@ static inline int guc_kernel_context_pin(struct intel_guc *guc,
 			return ret;
 	}
 
-	if (!test_bit(CONTEXT_GUC_INIT, &ce->flags))
-		guc_context_init(ce);
-
 	ret = try_context_registration(ce, true);
 	if (ret)
 		unpin_guc_id(guc, ce);
@@ -4782,6 +4889,7 @@ void intel_guc_submission_init_early(struct intel_guc *guc)
 	INIT_LIST_HEAD(&guc->submission_state.guc_id_list);
 	ida_init(&guc->submission_state.guc_ids);
 	INIT_LIST_HEAD(&guc->submission_state.destroyed_contexts);
+	INIT_LIST_HEAD(&guc->submission_state.deregistered_contexts);
 	INIT_WORK(&guc->submission_state.destroyed_worker,
 		  destroyed_worker_func);
 	INIT_WORK(&guc->submission_state.reset_fail_worker,
@@ -5016,10 +5124,13 @@ int intel_guc_deregister_done_process_msg(struct intel_guc *guc,
 		guc_signal_context_fence(ce);
 		intel_context_put(ce);
 	} else if (context_destroyed(ce)) {
-		/* Context has been destroyed */
-		intel_gt_pm_put_async(guc_to_gt(guc));
-		release_guc_id(guc, ce);
-		__guc_context_destroy(ce);
+		/*
+		 * Context has been destroyed, release it together with other
+		 * contexts from this batch of G2H, see intel_guc_g2h_batch_done()
+		 */
+		list_add_tail(&ce->destroyed_link,
+			      &guc->submission_state.deregistered_contexts);
+		return 0;
 	}
 
 	decr_outstanding_submission_g2h(guc);
@@ -5027,6 +5138,40 @@ int intel_guc_deregister_done_process_msg(struct intel_guc *guc,
 	return 0;
 }
 
+/**
+ * intel_guc_g2h_batch_done - Complete work deferred by the G2H handlers.
+ * @guc: the GuC
+ *
+ * Called by the CT after processing a batch of incoming G2H requests.
+ * Releases guc_ids of all contexts deregistered in the batch under a single
+ * submission lock and then frees these contexts.
+ */
+void intel_guc_g2h_batch_done(struct intel_guc *guc)
+{
+	struct list_head *list = &guc->submission_state.deregistered_contexts;
+	struct intel_context *ce, *cn;
+	unsigned long flags;
+	int count = 0;
+
+	if (list_empty(list))
+		return;
+
+	spin_lock_irqsave(&guc->submission_state.lock, flags);
+	list_for_each_entry(ce, list, destroyed_link)
+		__release_guc_id(guc, ce);
+	spin_unlock_irqrestore(&guc->submission_state.lock, flags);
+
+	list_for_each_entry_safe(ce, cn, list, destroyed_link) {
+		list_del_init(&ce->destroyed_link);
+		intel_gt_pm_put_async(guc_to_gt(guc));
+		__guc_context_destroy(ce);
+		count++;
+	}
+
+	if (atomic_sub_and_test(count, &guc->outstanding_submission_g2h))
+		wake_up_all(&guc->ct.wq);
+}
+
 int intel_guc_sched_done_process_msg(struct intel_guc *guc,
 				     const u32 *msg,
 				     u32 len)
@@ -5433,6 +5578,10 @@ void intel_guc_submission_print_info(struct intel_guc *guc,
 		   atomic_read(&guc->outstanding_submission_g2h));
 	drm_printf(p, "GuC tasklet count: %u\n",
 		   atomic_read(&sched_engine->tasklet.count));
+	drm_printf(p, "GuC single-lrc ids in use: %u/%d (reserved %d)\n",
+		   READ_ONCE(guc->submission_state.guc_ids_in_use),
+		   number_slrc_guc_id(guc), number_reserved_guc_id(guc));
+	drm_printf(p, "GuC ids stolen: %d\n", READ_ONCE(guc->number_guc_id_stolen));
 
 	spin_lock_irqsave(&sched_engine->lock, flags);
 	drm_printf(p, "Requests in GuC submit tasklet:\n");
@@ -134,9 +134,11 @@ err:
  * This test creates a spinner which is used to block all subsequent submissions
  * until it completes. Next, a loop creates a context and a NOP request each
  * iteration until the guc_ids are exhausted (request creation returns -EAGAIN).
- * The spinner is ended, unblocking all requests created in the loop. At this
- * point all guc_ids are exhausted but are available to steal. Try to create
- * another request which should successfully steal a guc_id. Wait on last
+ * A high priority context must then still get one of the reserved guc_ids,
+ * without stealing. The spinner is ended, unblocking all requests created in
+ * the loop. At this point all guc_ids are exhausted but are available to
+ * steal. Try to create another request which should successfully steal a
+ * guc_id. Wait on last
  * request to complete, idle GPU, verify a guc_id was stolen via a counter, and
  * exit the test. Test also artificially reduces the number of guc_ids so the
  * test runs in a timely manner.
@@ -145,7 +147,7 @@ static int intel_guc_steal_guc_ids(void *arg)
 {
 	struct intel_gt *gt = arg;
 	struct intel_guc *guc = &gt->uc.guc;
-	int ret, sv, context_index = 0;
+	int ret, sv, context_index = 0, steal_index;
 	intel_wakeref_t wakeref;
 	struct intel_engine_cs *engine;
 	struct intel_context **ce;
@@ -215,6 +217,39 @@ static int intel_guc_steal_guc_ids(void *arg)
 			last = rq;
 		}
 	}
+	steal_index = context_index;
+
+	/* High priority context takes a reserved guc_id instead of stealing */
+	ce[++context_index] = intel_context_create(engine);
+	if (IS_ERR(ce[context_index])) {
+		ret = PTR_ERR(ce[context_index]);
+		guc_err(guc, "Failed to create context: %pe\n", ce[context_index]);
+		ce[context_index--] = NULL;
+		i915_request_put(last);
+		goto err_spin_rq;
+	}
+	guc_context_init(ce[context_index]);
+	ce[context_index]->guc_state.base_prio = GUC_CLIENT_PRIORITY_HIGH;
+	ce[context_index]->guc_state.prio = GUC_CLIENT_PRIORITY_HIGH;
+
+	rq = nop_user_request(ce[context_index], spin_rq);
+	if (IS_ERR(rq)) {
+		ret = PTR_ERR(rq);
+		guc_err(guc, "Failed to create high priority request: %pe\n", rq);
+		i915_request_put(last);
+		goto err_spin_rq;
+	}
+	i915_request_put(rq);
+
+	if (ce[context_index]->guc_id.id < reserved_guc_id_base(guc) ||
+	    guc->number_guc_id_stolen != number_guc_id_stolen) {
+		guc_err(guc, "High priority context got guc_id %u (reserved from %d), %d stolen\n",
+			ce[context_index]->guc_id.id, reserved_guc_id_base(guc),
+			guc->number_guc_id_stolen - number_guc_id_stolen);
+		ret = -EINVAL;
+		i915_request_put(last);
+		goto err_spin_rq;
+	}
 
 	/* Release blocked requests */
 	igt_spinner_end(&spin);
@@ -237,10 +272,10 @@ static int intel_guc_steal_guc_ids(void *arg)
 	}
 
 	/* Try to steal guc_id */
-	rq = nop_user_request(ce[context_index], NULL);
+	rq = nop_user_request(ce[steal_index], NULL);
 	if (IS_ERR(rq)) {
 		ret = PTR_ERR(rq);
-		guc_err(guc, "Failed to steal guc_id %d: %pe\n", context_index, rq);
+		guc_err(guc, "Failed to steal guc_id %d: %pe\n", steal_index, rq);
 		goto err_spin_rq;
 	}
 
@@ -286,11 +321,101 @@ err_wakeref:
 	return ret;
 }
 
+#define CT_BATCH_MSGS		12
+#define CT_BATCH_G2H_LEN_DW	FIELD_MAX(INTEL_GUC_CT_SEND_G2H_DW_MASK)
+
+/*
+ * intel_guc_ct_batch - Test H2G batches
+ *
+ * Batches are made of FORCE_LOG_BUFFER_FLUSH requests, as these are harmless
+ * and get header-only responses. A non-blocking batch that reserves more G2H
+ * space than the whole G2H buffer can never fit, so it must be rejected as a
+ * whole, without sending any of its messages. A blocking batch, larger than a
+ * single chunk, must then report the status of each of its messages.
+ */
+
+static int intel_guc_ct_batch(void *arg)
+{
+	static const u32 action[] = { INTEL_GUC_ACTION_FORCE_LOG_BUFFER_FLUSH, 0 };
+	struct intel_gt *gt = arg;
+	struct intel_guc *guc = &gt->uc.guc;
+	struct intel_guc_ct *ct = &guc->ct;
+	unsigned int n, count, count_nb;
+	struct intel_guc_ct_msg *msgs;
+	intel_wakeref_t wakeref;
+	int *status;
+	u16 fence;
+	int ret;
+
+	count_nb = ct->ctbs.recv.size / CT_BATCH_G2H_LEN_DW + 1;
+	count = max_t(unsigned int, count_nb, CT_BATCH_MSGS);
+
+	msgs = kcalloc(count, sizeof(*msgs), GFP_KERNEL);
+	status = kcalloc(count, sizeof(*status), GFP_KERNEL);
+	if (!msgs || !status) {
+		ret = -ENOMEM;
+		goto out_free;
+	}
+
+	for (n = 0; n < count; n++) {
+		msgs[n].action = action;
+		msgs[n].len = ARRAY_SIZE(action);
+		msgs[n].status = &status[n];
+		status[n] = -EINPROGRESS;
+	}
+
+	/* no other H2G traffic is expected from now on */
+	ret = intel_gt_wait_for_idle(gt, HZ * 30);
+	if (ret < 0) {
+		guc_err(guc, "GT failed to idle: %pe\n", ERR_PTR(ret));
+		goto out_free;
+	}
+
+	wakeref = intel_runtime_pm_get(gt->uncore->rpm);
+
+	fence = READ_ONCE(ct->requests.last_fence);
+	ret = intel_guc_ct_send_batch(ct, msgs, count_nb, MAKE_SEND_FLAGS(CT_BATCH_G2H_LEN_DW));
+	if (ret != -EBUSY) {
+		guc_err(guc, "Batch of %u messages not rejected: %pe\n", count_nb, ERR_PTR(ret));
+		ret = -EINVAL;
+		goto out_wakeref;
+	}
+
+	if (READ_ONCE(ct->requests.last_fence) != fence) {
+		guc_err(guc, "Rejected batch sent %u messages\n",
+			(u16)(READ_ONCE(ct->requests.last_fence) - fence));
+		ret = -EINVAL;
+		goto out_wakeref;
+	}
+
+	ret = intel_guc_ct_send_batch(ct, msgs, CT_BATCH_MSGS, 0);
+	if (ret) {
+		guc_err(guc, "Batch of %u messages failed: %pe\n", CT_BATCH_MSGS, ERR_PTR(ret));
+		goto out_wakeref;
+	}
+
+	for (n = 0; n < CT_BATCH_MSGS; n++) {
+		if (status[n] < 0) {
+			guc_err(guc, "Batch message %u failed: %pe\n", n, ERR_PTR(status[n]));
+			ret = -EINVAL;
+			goto out_wakeref;
+		}
+	}
+
+out_wakeref:
+	intel_runtime_pm_put(gt->uncore->rpm, wakeref);
+out_free:
+	kfree(status);
+	kfree(msgs);
+	return ret;
+}
+
 int intel_guc_live_selftests(struct drm_i915_private *i915)
 {
 	static const struct i915_subtest tests[] = {
 		SUBTEST(intel_guc_scrub_ctbs),
 		SUBTEST(intel_guc_steal_guc_ids),
+		SUBTEST(intel_guc_ct_batch),
 	};
 	struct intel_gt *gt = to_gt(i915);
 
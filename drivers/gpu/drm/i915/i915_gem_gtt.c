@@ -17,6 +17,7 @@
 
 #include "display/intel_frontbuffer.h"
 #include "gt/intel_gt.h"
+#include "gt/iov/intel_iov_ggtt.h"
 #include "gt/intel_gt_requests.h"
 
 #include "i915_drv.h"
@@ -152,6 +153,11 @@ static u64 random_offset(u64 start, u64 end, u64 len, u64 align)
 	return round_up(start, align);
 }
 
+static bool vm_is_vf_ggtt(struct i915_address_space *vm)
+{
+	return i915_is_ggtt(vm) && IS_SRIOV_VF(vm->i915);
+}
+
 /**
  * i915_gem_gtt_insert - insert a node into an address_space (GTT)
  * @vm: the &struct i915_address_space
@@ -209,6 +215,14 @@ int i915_gem_gtt_insert(struct i915_address_space *vm,
 	GEM_BUG_ON(vm == &to_gt(vm->i915)->ggtt->alias->vm);
 	GEM_BUG_ON(drm_mm_node_allocated(node));
 
+	if (vm_is_vf_ggtt(vm)) {
+		err = intel_iov_ggtt_vf_insert(&vm->gt->iov, &vm->mm, node,
+					       size, alignment, color,
+					       &start, &end);
+		if (err != -ENOSPC)
+			return err;
+	}
+
 	if (unlikely(range_overflows(start, size, end)))
 		return -ENOSPC;
 
@@ -292,6 +306,26 @@ int i915_gem_gtt_insert(struct i915_address_space *vm,
 					   start, end, DRM_MM_INSERT_EVICT);
 }
 
+/**
+ * i915_gem_gtt_remove - remove a node from an address_space (GTT)
+ * @vm: the &struct i915_address_space
+ * @node: the &struct drm_mm_node to remove
+ *
+ * Counterpart of i915_gem_gtt_insert() and i915_gem_gtt_reserve() that lets
+ * the VF GGTT allocator reuse the released space for the next allocation
+ * of the same size.
+ */
+void i915_gem_gtt_remove(struct i915_address_space *vm,
+			 struct drm_mm_node *node)
+{
+	lockdep_assert_held(&vm->mutex);
+
+	if (vm_is_vf_ggtt(vm))
+		intel_iov_ggtt_vf_remove(&vm->gt->iov, node);
+
+	drm_mm_remove_node(node);
+}
+
 #if IS_ENABLED(CONFIG_DRM_I915_SELFTEST)
 #include "selftests/i915_gem_gtt.c"
 #endif
@@ -37,6 +37,9 @@ int i915_gem_gtt_insert(struct i915_address_space *vm,
 			u64 size, u64 alignment, unsigned long color,
 			u64 start, u64 end, unsigned int flags);
 
+void i915_gem_gtt_remove(struct i915_address_space *vm,
+			 struct drm_mm_node *node);
+
 /* Flags used by pin/bind&friends. */
 #define PIN_NOEVICT		BIT_ULL(0)
 #define PIN_NOSEARCH		BIT_ULL(1)
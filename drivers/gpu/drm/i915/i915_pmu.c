@@ -15,9 +15,11 @@
 #include "gt/intel_gt_regs.h"
 #include "gt/intel_rc6.h"
 #include "gt/intel_rps.h"
+#include "gt/iov/intel_iov_service.h"
 
 #include "i915_drv.h"
 #include "i915_pmu.h"
+#include "i915_sriov.h"
 
 /* Frequency for the sampling timer for events which need it. */
 #define FREQUENCY 200
@@ -66,6 +68,24 @@ static u64 config_counter(const u64 config)
 	return config & ~(~0ULL << __I915_PMU_GT_SHIFT);
 }
 
+static bool is_vf_config(const u64 config)
+{
+	u64 counter = config_counter(config);
+
+	return counter >= __I915_PMU_OTHER(__I915_PMU_VF(0, 0)) &&
+	       counter < __I915_PMU_OTHER(__I915_PMU_VF_BASE + __I915_PMU_VF_RANGE);
+}
+
+static unsigned int vf_config_vfid(const u64 config)
+{
+	return (config_counter(config) - __I915_PMU_OTHER(__I915_PMU_VF(0, 0))) / IOV_VF_STAT_MAX;
+}
+
+static enum intel_iov_vf_stat vf_config_stat(const u64 config)
+{
+	return (config_counter(config) - __I915_PMU_OTHER(__I915_PMU_VF(0, 0))) % IOV_VF_STAT_MAX;
+}
+
 static unsigned int other_bit(const u64 config)
 {
 	unsigned int val;
@@ -543,6 +563,16 @@ config_status(struct drm_i915_private *i915, u64 config)
 	if (gt_id > max_gt_id)
 		return -ENOENT;
 
+	if (is_vf_config(config)) {
+		unsigned int vfid = vf_config_vfid(config);
+
+		if (!IS_SRIOV_PF(i915) || !i915->gt[gt_id])
+			return -ENODEV;
+		if (!vfid || vfid > i915_sriov_pf_get_totalvfs(i915))
+			return -ENOENT;
+		return 0;
+	}
+
 	switch (config_counter(config)) {
 	case I915_PMU_ACTUAL_FREQUENCY:
 		if (IS_VALLEYVIEW(i915) || IS_CHERRYVIEW(i915))
@@ -656,6 +686,11 @@ static u64 __i915_pmu_event_read(struct perf_event *event)
 		const unsigned int gt_id = config_gt_id(event->attr.config);
 		const u64 config = config_counter(event->attr.config);
 
+		if (is_vf_config(config))
+			return intel_iov_service_read_vf_stat(&i915->gt[gt_id]->iov,
+							      vf_config_vfid(config),
+							      vf_config_stat(config));
+
 		switch (config) {
 		case I915_PMU_ACTUAL_FREQUENCY:
 			val =
@@ -1004,7 +1039,22 @@ create_event_attributes(struct i915_pmu *pmu)
 		__engine_event(I915_SAMPLE_SEMA, "sema"),
 		__engine_event(I915_SAMPLE_WAIT, "wait"),
 	};
-	unsigned int count = 0;
+	static const struct {
+		enum intel_iov_vf_stat stat;
+		const char *name;
+		const char *unit;
+	} vf_events[] = {
+		{ IOV_VF_STAT_RELAY_MSGS, "relay-msgs", NULL },
+		{ IOV_VF_STAT_RELAY_BYTES, "relay-bytes", "bytes" },
+		{ IOV_VF_STAT_RUNTIME_QUERIES, "runtime-queries", NULL },
+		{ IOV_VF_STAT_GGTT_PTES, "ggtt-ptes", NULL },
+		{ IOV_VF_STAT_LATENCY_10US, "relay-latency-10us", NULL },
+		{ IOV_VF_STAT_LATENCY_100US, "relay-latency-100us", NULL },
+		{ IOV_VF_STAT_LATENCY_1MS, "relay-latency-1ms", NULL },
+		{ IOV_VF_STAT_LATENCY_SLOW, "relay-latency-slow", NULL },
+	};
+	unsigned int totalvfs = IS_SRIOV_PF(i915) ? i915_sriov_pf_get_totalvfs(i915) : 0;
+	unsigned int vfid, count = 0;
 	struct perf_pmu_events_attr *pmu_attr = NULL, *pmu_iter;
 	struct i915_ext_attribute *i915_attr = NULL, *i915_iter;
 	struct attribute **attr = NULL, **attr_iter;
@@ -1020,6 +1070,16 @@ create_event_attributes(struct i915_pmu *pmu)
 			if (!config_status(i915, config))
 				count++;
 		}
+
+		for (vfid = 1; vfid <= totalvfs; vfid++) {
+			for (i = 0; i < ARRAY_SIZE(vf_events); i++) {
+				u64 config = ___I915_PMU_OTHER(j, __I915_PMU_VF(vfid,
+										vf_events[i].stat));
+
+				if (!config_status(i915, config))
+					count++;
+			}
+		}
 	}
 
 	for_each_uabi_engine(engine, i915) {
@@ -1083,6 +1143,45 @@ create_event_attributes(struct i915_pmu *pmu)
 							events[i].unit);
 			}
 		}
+
+		for (vfid = 1; vfid <= totalvfs; vfid++) {
+			for (i = 0; i < ARRAY_SIZE(vf_events); i++) {
+				u64 config = ___I915_PMU_OTHER(j, __I915_PMU_VF(vfid,
+										vf_events[i].stat));
+				char *str;
+
+				if (config_status(i915, config))
+					continue;
+
+				if (!HAS_EXTRA_GT_LIST(i915))
+					str = kasprintf(GFP_KERNEL, "vf%u-%s",
+							vfid, vf_events[i].name);
+				else
+					str = kasprintf(GFP_KERNEL, "vf%u-%s-gt%u",
+							vfid, vf_events[i].name, j);
+				if (!str)
+					goto err;
+
+				*attr_iter++ = &i915_iter->attr.attr;
+				i915_iter = add_i915_attr(i915_iter, str, config);
+
+				if (!vf_events[i].unit)
+					continue;
+
+				if (!HAS_EXTRA_GT_LIST(i915))
+					str = kasprintf(GFP_KERNEL, "vf%u-%s.unit",
+							vfid, vf_events[i].name);
+				else
+					str = kasprintf(GFP_KERNEL, "vf%u-%s-gt%u.unit",
+							vfid, vf_events[i].name, j);
+				if (!str)
+					goto err;
+
+				*attr_iter++ = &pmu_iter->attr.attr;
+				pmu_iter = add_pmu_attr(pmu_iter, str,
+							vf_events[i].unit);
+			}
+		}
 	}
 
 	/* Initialize supported engine counters. */
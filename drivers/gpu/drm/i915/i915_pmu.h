@@ -40,6 +40,16 @@ enum {
 
 #define I915_PMU_MAX_GT 2
 
+/*
+ * Driver private range of non-engine counters used to expose per-VF
+ * control-plane traffic (see &enum intel_iov_vf_stat). Must fit within
+ * the i915_eventid config bits.
+ */
+#define __I915_PMU_VF_BASE		0x1000
+#define __I915_PMU_VF_RANGE		0x1000
+#define __I915_PMU_VF(vfid, stat) \
+	(__I915_PMU_VF_BASE + (vfid) * IOV_VF_STAT_MAX + (stat))
+
 /*
  * How many different events we track in the global PMU mask.
  *
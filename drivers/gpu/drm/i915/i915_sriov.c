@@ -18,6 +18,7 @@
 #include "gt/iov/intel_iov_provisioning.h"
 #include "gt/iov/intel_iov_service.h"
 #include "gt/iov/intel_iov_reg.h"
+#include "gt/iov/intel_iov_sched.h"
 #include "gt/iov/intel_iov_state.h"
 #include "gt/iov/intel_iov_utils.h"
 
@@ -393,6 +394,34 @@ set:
 	return 0;
 }
 
+int i915_sriov_pf_set_profile(struct drm_i915_private *i915, const char *spec)
+{
+	GEM_BUG_ON(!IS_SRIOV_PF(i915));
+
+	return intel_iov_provisioning_set_profile(&to_gt(i915)->iov, spec);
+}
+
+int i915_sriov_pf_select_profile(struct drm_i915_private *i915, const char *name)
+{
+	GEM_BUG_ON(!IS_SRIOV_PF(i915));
+
+	return intel_iov_provisioning_select_profile(&to_gt(i915)->iov, name);
+}
+
+ssize_t i915_sriov_pf_show_profile(struct drm_i915_private *i915, char *buf)
+{
+	GEM_BUG_ON(!IS_SRIOV_PF(i915));
+
+	return intel_iov_provisioning_show_profile(&to_gt(i915)->iov, buf);
+}
+
+ssize_t i915_sriov_pf_show_profiles(struct drm_i915_private *i915, char *buf)
+{
+	GEM_BUG_ON(!IS_SRIOV_PF(i915));
+
+	return intel_iov_provisioning_show_profiles(&to_gt(i915)->iov, buf);
+}
+
 /**
  * i915_sriov_print_info - Print SR-IOV information.
  * @i915: the i915 struct
@@ -555,6 +584,9 @@ int i915_sriov_pf_enable_vfs(struct drm_i915_private *i915, int num_vfs)
 
 	i915_sriov_sysfs_update_links(i915, true);
 
+	for_each_gt(gt, i915, id)
+		intel_iov_sched_update(&gt->iov);
+
 	dev_info(dev, "Enabled %u VFs\n", num_vfs);
 	return num_vfs;
 
@@ -583,24 +615,54 @@ static void pf_start_vfs_flr(struct intel_iov *iov, unsigned int num_vfs)
 }
 
 #define I915_VF_FLR_TIMEOUT_MS 1000
+#define I915_ALL_VFS_FLR_TIMEOUT_MS 5000
 
-static unsigned int pf_wait_vfs_flr(struct intel_iov *iov, unsigned int num_vfs,
-				    unsigned int timeout_ms)
+static unsigned int pf_count_vfs_in_flr(struct intel_iov *iov, unsigned int num_vfs)
 {
-	unsigned int timed_out = 0;
+	unsigned int in_flr = 0;
 	unsigned int n;
 
 	GEM_BUG_ON(!intel_iov_is_pf(iov));
 
-	for (n = 1; n <= num_vfs; n++) {
-		if (wait_for(intel_iov_state_no_flr(iov, n), timeout_ms)) {
-			IOV_ERROR(iov, "VF%u FLR didn't complete within %u ms\n",
-				  n, timeout_ms);
-			timeout_ms /= 2;
-			timed_out++;
-		}
-	}
-	return timed_out;
+	for (n = 1; n <= num_vfs; n++)
+		if (!intel_iov_state_no_flr(iov, n))
+			in_flr++;
+
+	return in_flr;
+}
+
+static bool pf_all_vfs_flr_done(struct drm_i915_private *i915, unsigned int num_vfs)
+{
+	struct intel_gt *gt;
+	unsigned int id;
+
+	for_each_gt(gt, i915, id)
+		if (pf_count_vfs_in_flr(&gt->iov, num_vfs))
+			return false;
+
+	return true;
+}
+
+/*
+ * FLRs of all VFs on all GTs are processed concurrently by the per-GT state
+ * workers, so wait for all of them against a single deadline instead of
+ * polling each VF in turn. The deadline doesn't depend on the number of VFs,
+ * to keep disabling VFs bounded.
+ */
+static void pf_wait_all_vfs_flr(struct drm_i915_private *i915, unsigned int num_vfs,
+				unsigned int timeout_ms)
+{
+	struct intel_gt *gt;
+	unsigned int id, n;
+
+	if (!wait_for(pf_all_vfs_flr_done(i915, num_vfs), timeout_ms))
+		return;
+
+	for_each_gt(gt, i915, id)
+		for (n = 1; n <= num_vfs; n++)
+			if (!intel_iov_state_no_flr(&gt->iov, n))
+				IOV_ERROR(&gt->iov, "VF%u FLR didn't complete within %u ms\n",
+					  n, timeout_ms);
 }
 
 /**
@@ -640,12 +702,11 @@ int i915_sriov_pf_disable_vfs(struct drm_i915_private *i915)
 
 	for_each_gt(gt, i915, id)
 		pf_start_vfs_flr(&gt->iov, num_vfs);
-	for_each_gt(gt, i915, id)
-		pf_wait_vfs_flr(&gt->iov, num_vfs, I915_VF_FLR_TIMEOUT_MS);
+	pf_wait_all_vfs_flr(i915, num_vfs, I915_ALL_VFS_FLR_TIMEOUT_MS);
 
 	for_each_gt(gt, i915, id) {
 		/* unprovisioning wont work if FLR didn't finish */
-		in_flr = pf_wait_vfs_flr(&gt->iov, num_vfs, 0);
+		in_flr = pf_count_vfs_in_flr(&gt->iov, num_vfs);
 		if (in_flr) {
 			gt_warn(gt, "Can't unprovision %u VFs, %u FLRs are still in progress\n",
 				 num_vfs, in_flr);
@@ -762,7 +823,11 @@ skip_vf:
 	drm_dbg(&i915->drm, "%u of %u VFs running state successfully saved", saved, num_vfs);
 }
 
-static int pf_gt_save_vf_guc_state(struct intel_gt *gt, unsigned int vfid)
+/*
+ * Query size of the VF GuC state and prepare the blob for it, so the save
+ * itself doesn't have to ask the GuC again.
+ */
+static int pf_gt_prepare_vf_guc_state(struct intel_gt *gt, unsigned int vfid)
 {
 	struct pci_dev *pdev = to_pci_dev(gt->i915->drm.dev);
 	struct intel_iov *iov = &gt->iov;
@@ -775,6 +840,7 @@ static int pf_gt_save_vf_guc_state(struct intel_gt *gt, unsigned int vfid)
 	ret = intel_iov_state_save_vf_size(iov, vfid);
 	if (unlikely(ret < 0)) {
 		IOV_ERROR(iov, "Failed to get size of VF%u GuC state: (%pe)", vfid, ERR_PTR(ret));
+		kfree(fetch_and_zero(&data->guc_state.blob));
 		return ret;
 	}
 	size = ret;
@@ -791,12 +857,24 @@ static int pf_gt_save_vf_guc_state(struct intel_gt *gt, unsigned int vfid)
 	}
 
 	if (!data->guc_state.blob) {
-		ret = -ENOMEM;
-		goto error;
+		IOV_ERROR(iov, "Failed to save VF%u GuC state: (%pe)", vfid, ERR_PTR(-ENOMEM));
+		return -ENOMEM;
 	}
 
+	return size;
+}
+
+static int pf_gt_save_vf_guc_state(struct intel_gt *gt, unsigned int vfid)
+{
+	struct intel_iov *iov = &gt->iov;
+	struct intel_iov_data *data = &iov->pf.state.data[vfid];
+	int ret;
+
+	/* blob was prepared by pf_gt_prepare_vf_guc_state() */
+	if (!data->guc_state.blob)
+		return -ENODATA;
+
 	ret = intel_iov_state_save_vf(iov, vfid, data->guc_state.blob, data->guc_state.size);
-error:
 	if (unlikely(ret < 0)) {
 		IOV_ERROR(iov, "Failed to save VF%u GuC state: (%pe)", vfid, ERR_PTR(ret));
 		return ret;
@@ -805,30 +883,155 @@ error:
 	return ret;
 }
 
-static void pf_save_vfs_guc_state(struct drm_i915_private *i915, unsigned int num_vfs)
+struct pf_vf_state_work {
+	struct work_struct base;
+	struct intel_gt *gt;
+	unsigned int vfid;
+	int result;
+};
+
+static void pf_save_vf_guc_state_work(struct work_struct *w)
 {
-	unsigned int saved = 0;
+	struct pf_vf_state_work *work = container_of(w, typeof(*work), base);
+	struct intel_iov_data *data = &work->gt->iov.pf.state.data[work->vfid];
+	ktime_t start = ktime_get();
+
+	work->result = pf_gt_save_vf_guc_state(work->gt, work->vfid);
+	data->guc_state.save_us = ktime_us_delta(ktime_get(), start);
+}
+
+/*
+ * Run @func for each VF on each GT, all in parallel on the unbound workqueue.
+ * Return number of VFs for which @func succeeded on all GTs.
+ */
+static unsigned int pf_run_vfs_state_works(struct drm_i915_private *i915, unsigned int num_vfs,
+					   work_func_t func, const char *what)
+{
+	struct pf_vf_state_work *works, *work;
+	unsigned int done = 0;
 	struct intel_gt *gt;
 	unsigned int gt_id;
 	unsigned int vfid;
+	bool ok;
+
+	works = kcalloc(num_vfs * I915_MAX_GT, sizeof(*works), GFP_KERNEL);
 
 	for (vfid = 1; vfid <= num_vfs; vfid++) {
 		if (!needs_save_restore(i915, vfid)) {
-			drm_dbg(&i915->drm, "Save of VF%u GuC state has been skipped\n", vfid);
+			drm_dbg(&i915->drm, "%s of VF%u GuC state has been skipped\n", what, vfid);
 			continue;
 		}
 
+		ok = true;
 		for_each_gt(gt, i915, gt_id) {
-			int err = pf_gt_save_vf_guc_state(gt, vfid);
+			struct pf_vf_state_work serial;
+
+			if (!works) {
+				/* no memory for parallel works, run serially */
+				INIT_WORK_ONSTACK(&serial.base, func);
+				serial.gt = gt;
+				serial.vfid = vfid;
+				func(&serial.base);
+				destroy_work_on_stack(&serial.base);
+				ok &= serial.result >= 0;
+				continue;
+			}
+
+			work = &works[(vfid - 1) * I915_MAX_GT + gt_id];
+			INIT_WORK(&work->base, func);
+			work->gt = gt;
+			work->vfid = vfid;
+			queue_work(system_unbound_wq, &work->base);
+		}
+		if (!works)
+			done += ok;
+	}
 
-			if (err < 0)
-				goto skip_vf;
+	if (!works)
+		return done;
+
+	for (vfid = 1; vfid <= num_vfs; vfid++) {
+		if (!needs_save_restore(i915, vfid))
+			continue;
+
+		ok = true;
+		for_each_gt(gt, i915, gt_id) {
+			work = &works[(vfid - 1) * I915_MAX_GT + gt_id];
+			flush_work(&work->base);
+			ok &= work->result >= 0;
 		}
-		saved++;
-		continue;
-skip_vf:
-		break;
+		done += ok;
+	}
+
+	kfree(works);
+	return done;
+}
+
+static void pf_prepare_vfs_guc_state(struct drm_i915_private *i915, unsigned int num_vfs)
+{
+	struct intel_gt *gt;
+	unsigned int gt_id;
+	unsigned int vfid;
+
+	for (vfid = 1; vfid <= num_vfs; vfid++) {
+		if (!needs_save_restore(i915, vfid))
+			continue;
+
+		for_each_gt(gt, i915, gt_id)
+			pf_gt_prepare_vf_guc_state(gt, vfid);
 	}
+}
+
+static u32 pf_gt_max_vfs_guc_state_size(struct intel_gt *gt, unsigned int num_vfs)
+{
+	struct intel_iov *iov = &gt->iov;
+	u32 max_size = 0;
+	unsigned int vfid;
+
+	for (vfid = 1; vfid <= num_vfs; vfid++) {
+		if (!needs_save_restore(gt->i915, vfid))
+			continue;
+
+		if (iov->pf.state.data[vfid].guc_state.blob)
+			max_size = max_t(u32, max_size, iov->pf.state.data[vfid].guc_state.size);
+	}
+
+	return max_size;
+}
+
+/* blobs must be already prepared, staging buffer is sized to the largest one */
+static void pf_prepare_vfs_state_staging(struct drm_i915_private *i915, unsigned int num_vfs)
+{
+	struct intel_gt *gt;
+	unsigned int gt_id;
+	int err;
+
+	for_each_gt(gt, i915, gt_id) {
+		err = intel_iov_state_staging_init(&gt->iov, num_vfs,
+						   pf_gt_max_vfs_guc_state_size(gt, num_vfs));
+		if (err)
+			drm_dbg(&i915->drm, "Using separate GuC buffers on gt%u (%pe)\n",
+				gt_id, ERR_PTR(err));
+	}
+}
+
+static void pf_release_vfs_state_staging(struct drm_i915_private *i915)
+{
+	struct intel_gt *gt;
+	unsigned int gt_id;
+
+	for_each_gt(gt, i915, gt_id)
+		intel_iov_state_staging_fini(&gt->iov);
+}
+
+static void pf_save_vfs_guc_state(struct drm_i915_private *i915, unsigned int num_vfs)
+{
+	unsigned int saved;
+
+	pf_prepare_vfs_guc_state(i915, num_vfs);
+	pf_prepare_vfs_state_staging(i915, num_vfs);
+	saved = pf_run_vfs_state_works(i915, num_vfs, pf_save_vf_guc_state_work, "Save");
+	pf_release_vfs_state_staging(i915);
 
 	drm_dbg(&i915->drm, "%u of %u VFs GuC state successfully saved", saved, num_vfs);
 }
@@ -883,31 +1086,24 @@ static int pf_gt_restore_vf_guc_state(struct intel_gt *gt, unsigned int vfid)
 	return 0;
 }
 
-static void pf_restore_vfs_guc_state(struct drm_i915_private *i915, unsigned int num_vfs)
+static void pf_restore_vf_guc_state_work(struct work_struct *w)
 {
-	unsigned int restored = 0;
-	struct intel_gt *gt;
-	unsigned int gt_id;
-	unsigned int vfid;
+	struct pf_vf_state_work *work = container_of(w, typeof(*work), base);
+	struct intel_iov_data *data = &work->gt->iov.pf.state.data[work->vfid];
+	ktime_t start = ktime_get();
 
-	for (vfid = 1; vfid <= num_vfs; vfid++) {
-		if (!needs_save_restore(i915, vfid)) {
-			drm_dbg(&i915->drm, "Restoration of VF%u GuC state has been skipped\n",
-				vfid);
-			continue;
-		}
+	work->result = pf_gt_restore_vf_guc_state(work->gt, work->vfid);
+	data->guc_state.restore_us = ktime_us_delta(ktime_get(), start);
+}
 
-		for_each_gt(gt, i915, gt_id) {
-			int err = pf_gt_restore_vf_guc_state(gt, vfid);
+static void pf_restore_vfs_guc_state(struct drm_i915_private *i915, unsigned int num_vfs)
+{
+	unsigned int restored;
 
-			if (err < 0)
-				goto skip_vf;
-		}
-		restored++;
-		continue;
-skip_vf:
-		break;
-	}
+	pf_prepare_vfs_state_staging(i915, num_vfs);
+	restored = pf_run_vfs_state_works(i915, num_vfs, pf_restore_vf_guc_state_work,
+					  "Restoration");
+	pf_release_vfs_state_staging(i915);
 
 	drm_dbg(&i915->drm, "%u of %u VFs GuC state restored successfully", restored, num_vfs);
 }
@@ -1269,6 +1465,97 @@ i915_sriov_ggtt_load(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
 }
 EXPORT_SYMBOL_NS_GPL(i915_sriov_ggtt_load, I915_SRIOV_NS);
 
+/**
+ * i915_sriov_ggtt_clear_dirty - Start tracking of modified VF GGTT PTEs.
+ * @pdev: PF pci device
+ * @vfid: VF identifier
+ * @tile: tile identifier
+ *
+ * Shall be called before the initial i915_sriov_ggtt_save(), then PTEs
+ * modified afterwards can be saved with i915_sriov_ggtt_save_dirty().
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: 0 on success, -EOPNOTSUPP if dirty tracking is not available,
+ *         or a negative error code on failure.
+ */
+int
+i915_sriov_ggtt_clear_dirty(struct pci_dev *pdev, unsigned int vfid, unsigned int tile)
+{
+	struct intel_gt *gt;
+
+	gt = sriov_to_gt(pdev, tile);
+	if (!gt)
+		return -ENODEV;
+
+	if (gt->type == GT_MEDIA)
+		return -ENODEV;
+
+	return intel_iov_state_clear_ggtt_dirty(&gt->iov, vfid);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_ggtt_clear_dirty, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_ggtt_save_dirty - Save VF GGTT PTEs modified since last save.
+ * @pdev: PF pci device
+ * @vfid: VF identifier
+ * @tile: tile identifier
+ * @buf: buffer to save dirty VF GGTT PTEs
+ * @size: size of buffer to save dirty VF GGTT PTEs
+ *
+ * Saved PTEs are no longer dirty, call until it returns 0 to save all of them.
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: Size of data written on success, -EOPNOTSUPP if dirty tracking
+ *         is not available, or a negative error code on failure.
+ */
+ssize_t
+i915_sriov_ggtt_save_dirty(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
+			   void *buf, size_t size)
+{
+	struct intel_gt *gt;
+
+	gt = sriov_to_gt(pdev, tile);
+	if (!gt)
+		return -ENODEV;
+
+	if (gt->type == GT_MEDIA)
+		return -ENODEV;
+
+	return intel_iov_state_save_ggtt_dirty(&gt->iov, vfid, buf, size);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_ggtt_save_dirty, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_ggtt_load_dirty - Load VF GGTT PTEs saved as dirty.
+ * @pdev: PF pci device
+ * @vfid: VF identifier
+ * @tile: tile identifier
+ * @buf: buffer from i915_sriov_ggtt_save_dirty()
+ * @size: size of buffer with dirty VF GGTT PTEs
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: 0 on success or a negative error code on failure.
+ */
+int
+i915_sriov_ggtt_load_dirty(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
+			   const void *buf, size_t size)
+{
+	struct intel_gt *gt;
+
+	gt = sriov_to_gt(pdev, tile);
+	if (!gt)
+		return -ENODEV;
+
+	if (gt->type == GT_MEDIA)
+		return -ENODEV;
+
+	return intel_iov_state_restore_ggtt_dirty(&gt->iov, vfid, buf, size);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_ggtt_load_dirty, I915_SRIOV_NS);
+
 /**
  * i915_sriov_fw_state_size - Get size needed to store GuC FW state.
  * @pdev: PF pci device
@@ -1350,6 +1637,119 @@ i915_sriov_fw_state_load(struct pci_dev *pdev, unsigned int vfid, unsigned int t
 }
 EXPORT_SYMBOL_NS_GPL(i915_sriov_fw_state_load, I915_SRIOV_NS);
 
+/**
+ * i915_sriov_state_save_begin - Start streaming VF migration state.
+ * @pdev: PF pci device
+ * @vfid: VF identifier
+ * @tile: tile identifier
+ *
+ * The stream contains VF GGTT (if applicable to the tile) and GuC FW state,
+ * which can be read in bounded chunks using i915_sriov_state_save_next_chunk().
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: stream on success or an ERR_PTR on failure.
+ */
+struct intel_iov_state_stream *
+i915_sriov_state_save_begin(struct pci_dev *pdev, unsigned int vfid, unsigned int tile)
+{
+	struct intel_gt *gt;
+
+	gt = sriov_to_gt(pdev, tile);
+	if (!gt)
+		return ERR_PTR(-ENODEV);
+
+	return intel_iov_state_save_begin(&gt->iov, vfid);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_state_save_begin, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_state_save_next_chunk - Read next chunk of VF migration state.
+ * @stream: stream from i915_sriov_state_save_begin()
+ * @buf: buffer to save the chunk
+ * @size: size of the buffer, in bytes
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: Size of data written (in bytes), 0 at the end of the stream,
+ *         or a negative error code on failure.
+ */
+ssize_t
+i915_sriov_state_save_next_chunk(struct intel_iov_state_stream *stream, void *buf, size_t size)
+{
+	return intel_iov_state_save_next_chunk(stream, buf, size);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_state_save_next_chunk, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_state_save_end - Finish streaming VF migration state.
+ * @stream: stream from i915_sriov_state_save_begin()
+ *
+ * This function shall be called only on PF.
+ */
+void i915_sriov_state_save_end(struct intel_iov_state_stream *stream)
+{
+	intel_iov_state_save_end(stream);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_state_save_end, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_state_restore_begin - Start restoring VF migration state.
+ * @pdev: PF pci device
+ * @vfid: VF identifier
+ * @tile: tile identifier
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: stream on success or an ERR_PTR on failure.
+ */
+struct intel_iov_state_stream *
+i915_sriov_state_restore_begin(struct pci_dev *pdev, unsigned int vfid, unsigned int tile)
+{
+	struct intel_gt *gt;
+
+	gt = sriov_to_gt(pdev, tile);
+	if (!gt)
+		return ERR_PTR(-ENODEV);
+
+	return intel_iov_state_restore_begin(&gt->iov, vfid);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_state_restore_begin, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_state_restore_next_chunk - Write next chunk of VF migration state.
+ * @stream: stream from i915_sriov_state_restore_begin()
+ * @buf: buffer with the chunk
+ * @size: size of the chunk, in bytes
+ *
+ * Chunks may be split differently than they were saved, but must keep the order.
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: Size of data consumed (in bytes) or a negative error code on failure.
+ */
+ssize_t
+i915_sriov_state_restore_next_chunk(struct intel_iov_state_stream *stream,
+				    const void *buf, size_t size)
+{
+	return intel_iov_state_restore_next_chunk(stream, buf, size);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_state_restore_next_chunk, I915_SRIOV_NS);
+
+/**
+ * i915_sriov_state_restore_end - Finish restoring VF migration state.
+ * @stream: stream from i915_sriov_state_restore_begin()
+ *
+ * This function shall be called only on PF.
+ *
+ * Return: 0 on success or a negative error code if the stream was incomplete.
+ */
+int i915_sriov_state_restore_end(struct intel_iov_state_stream *stream)
+{
+	return intel_iov_state_restore_end(stream);
+}
+EXPORT_SYMBOL_NS_GPL(i915_sriov_state_restore_end, I915_SRIOV_NS);
+
 /**
  * i915_sriov_pf_clear_vf - Unprovision VF.
  * @i915: the i915 struct
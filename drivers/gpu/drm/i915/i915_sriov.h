@@ -41,6 +41,10 @@ int i915_sriov_pf_clear_vf(struct drm_i915_private *i915, unsigned int vfid);
 
 bool i915_sriov_pf_is_auto_provisioning_enabled(struct drm_i915_private *i915);
 int i915_sriov_pf_set_auto_provisioning(struct drm_i915_private *i915, bool enable);
+int i915_sriov_pf_set_profile(struct drm_i915_private *i915, const char *spec);
+int i915_sriov_pf_select_profile(struct drm_i915_private *i915, const char *name);
+ssize_t i915_sriov_pf_show_profile(struct drm_i915_private *i915, char *buf);
+ssize_t i915_sriov_pf_show_profiles(struct drm_i915_private *i915, char *buf);
 
 int i915_sriov_suspend_prepare(struct drm_i915_private *i915);
 int i915_sriov_resume(struct drm_i915_private *i915);
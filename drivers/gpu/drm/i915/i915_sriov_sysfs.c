@@ -92,6 +92,45 @@ static ssize_t auto_provisioning_sriov_ext_attr_store(struct drm_i915_private *i
 
 I915_SRIOV_EXT_ATTR(auto_provisioning);
 
+static ssize_t auto_provisioning_profile_sriov_ext_attr_show(struct drm_i915_private *i915,
+							     unsigned int id, char *buf)
+{
+	return i915_sriov_pf_show_profile(i915, buf);
+}
+
+static ssize_t auto_provisioning_profile_sriov_ext_attr_store(struct drm_i915_private *i915,
+							      unsigned int id,
+							      const char *buf, size_t count)
+{
+	char name[IOV_PROFILE_NAME_LEN + 1]; /* allow trailing newline */
+	int err;
+
+	if (strscpy(name, buf, sizeof(name)) < 0)
+		return -EINVAL;
+
+	err = i915_sriov_pf_select_profile(i915, strim(name));
+	return err ?: count;
+}
+
+static ssize_t auto_provisioning_profiles_sriov_ext_attr_show(struct drm_i915_private *i915,
+							      unsigned int id, char *buf)
+{
+	return i915_sriov_pf_show_profiles(i915, buf);
+}
+
+static ssize_t auto_provisioning_profiles_sriov_ext_attr_store(struct drm_i915_private *i915,
+							       unsigned int id,
+							       const char *buf, size_t count)
+{
+	int err;
+
+	err = i915_sriov_pf_set_profile(i915, buf);
+	return err ?: count;
+}
+
+I915_SRIOV_EXT_ATTR(auto_provisioning_profile);
+I915_SRIOV_EXT_ATTR(auto_provisioning_profiles);
+
 static ssize_t id_sriov_ext_attr_show(struct drm_i915_private *i915,
 				      unsigned int id, char *buf)
 {
@@ -137,6 +176,8 @@ static const struct attribute_group sriov_ext_attr_group = {
 
 static struct attribute *pf_ext_attrs[] = {
 	&auto_provisioning_sriov_ext_attr.attr,
+	&auto_provisioning_profile_sriov_ext_attr.attr,
+	&auto_provisioning_profiles_sriov_ext_attr.attr,
 	NULL
 };
 
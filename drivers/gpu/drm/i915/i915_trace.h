@@ -744,6 +744,135 @@ DEFINE_EVENT(i915_context, i915_context_free,
 	TP_ARGS(ctx)
 );
 
+/**
+ * DOC: i915_iov_vf_flr tracepoint
+ *
+ * This tracepoint is emitted by the PF on each VF FLR phase transition,
+ * separately for each GT, and can be used to profile FLR latency.
+ */
+TRACE_DEFINE_ENUM(IOV_FLR_PHASE_NOTIFY);
+TRACE_DEFINE_ENUM(IOV_FLR_PHASE_START);
+TRACE_DEFINE_ENUM(IOV_FLR_PHASE_DONE);
+TRACE_DEFINE_ENUM(IOV_FLR_PHASE_FINISH);
+TRACE_DEFINE_ENUM(IOV_FLR_PHASE_COMPLETE);
+TRACE_DEFINE_ENUM(IOV_FLR_PHASE_FAILED);
+
+TRACE_EVENT(i915_iov_vf_flr,
+	    TP_PROTO(struct intel_gt *gt, u32 vfid, enum intel_iov_flr_phase phase),
+	    TP_ARGS(gt, vfid, phase),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, gt)
+			     __field(u32, vfid)
+			     __field(u32, phase)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = gt->i915->drm.primary->index;
+			   __entry->gt = gt->info.id;
+			   __entry->vfid = vfid;
+			   __entry->phase = phase;
+			   ),
+
+	    TP_printk("dev=%u, gt=%u, vf=%u, phase=%s",
+		      __entry->dev, __entry->gt, __entry->vfid,
+		      __print_symbolic(__entry->phase,
+				       { IOV_FLR_PHASE_NOTIFY, "notify" },
+				       { IOV_FLR_PHASE_START, "start" },
+				       { IOV_FLR_PHASE_DONE, "done" },
+				       { IOV_FLR_PHASE_FINISH, "finish" },
+				       { IOV_FLR_PHASE_COMPLETE, "complete" },
+				       { IOV_FLR_PHASE_FAILED, "failed" }))
+);
+
+/**
+ * DOC: intel_guc_ct tracepoints
+ *
+ * These tracepoints are emitted for each H2G message written to the CT buffer
+ * (with the time spent waiting for the H2G space), for each response received
+ * from the GuC (with the time since the request was sent) and for each wait
+ * for such response, and can be used to tell CT backpressure from GuC latency.
+ */
+TRACE_EVENT(intel_guc_ct_h2g,
+	    TP_PROTO(struct intel_gt *gt, u32 fence, u32 action, u32 len, u32 queue_us),
+	    TP_ARGS(gt, fence, action, len, queue_us),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, gt)
+			     __field(u32, fence)
+			     __field(u32, action)
+			     __field(u32, len)
+			     __field(u32, queue_us)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = gt->i915->drm.primary->index;
+			   __entry->gt = gt->info.id;
+			   __entry->fence = fence;
+			   __entry->action = action;
+			   __entry->len = len;
+			   __entry->queue_us = queue_us;
+			   ),
+
+	    TP_printk("dev=%u, gt=%u, fence=%u, action=%#x, len=%u, queue=%uus",
+		      __entry->dev, __entry->gt, __entry->fence, __entry->action,
+		      __entry->len, __entry->queue_us)
+);
+
+TRACE_EVENT(intel_guc_ct_response,
+	    TP_PROTO(struct intel_gt *gt, u32 fence, u32 action, u32 response_us),
+	    TP_ARGS(gt, fence, action, response_us),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, gt)
+			     __field(u32, fence)
+			     __field(u32, action)
+			     __field(u32, response_us)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = gt->i915->drm.primary->index;
+			   __entry->gt = gt->info.id;
+			   __entry->fence = fence;
+			   __entry->action = action;
+			   __entry->response_us = response_us;
+			   ),
+
+	    TP_printk("dev=%u, gt=%u, fence=%u, action=%#x, response=%uus",
+		      __entry->dev, __entry->gt, __entry->fence, __entry->action,
+		      __entry->response_us)
+);
+
+TRACE_EVENT(intel_guc_ct_wait,
+	    TP_PROTO(struct intel_gt *gt, u32 fence, u32 action, u32 wait_us, int err),
+	    TP_ARGS(gt, fence, action, wait_us, err),
+
+	    TP_STRUCT__entry(
+			     __field(u32, dev)
+			     __field(u32, gt)
+			     __field(u32, fence)
+			     __field(u32, action)
+			     __field(u32, wait_us)
+			     __field(int, err)
+			     ),
+
+	    TP_fast_assign(
+			   __entry->dev = gt->i915->drm.primary->index;
+			   __entry->gt = gt->info.id;
+			   __entry->fence = fence;
+			   __entry->action = action;
+			   __entry->wait_us = wait_us;
+			   __entry->err = err;
+			   ),
+
+	    TP_printk("dev=%u, gt=%u, fence=%u, action=%#x, wait=%uus, err=%d",
+		      __entry->dev, __entry->gt, __entry->fence, __entry->action,
+		      __entry->wait_us, __entry->err)
+);
+
 #endif /* _I915_TRACE_H_ */
 
 /* This part must be outside protection */
@@ -1578,7 +1578,7 @@ int i915_vma_pin_ww(struct i915_vma *vma, struct i915_gem_ww_ctx *ww,
 err_remove:
 	if (!i915_vma_is_bound(vma, I915_VMA_BIND_MASK)) {
 		i915_vma_detach(vma);
-		drm_mm_remove_node(&vma->node);
+		i915_gem_gtt_remove(vma->vm, &vma->node);
 	}
 err_active:
 	i915_active_release(&vma->active);
@@ -2109,7 +2109,7 @@ int __i915_vma_unbind(struct i915_vma *vma)
 	GEM_BUG_ON(i915_vma_is_active(vma));
 	__i915_vma_evict(vma, false);
 
-	drm_mm_remove_node(&vma->node); /* pairs with i915_vma_release() */
+	i915_gem_gtt_remove(vma->vm, &vma->node); /* pairs with i915_vma_release() */
 	return 0;
 }
 
@@ -2143,7 +2143,7 @@ static struct dma_fence *__i915_vma_unbind_async(struct i915_vma *vma)
 
 	fence = __i915_vma_evict(vma, true);
 
-	drm_mm_remove_node(&vma->node); /* pairs with i915_vma_release() */
+	i915_gem_gtt_remove(vma->vm, &vma->node); /* pairs with i915_vma_release() */
 
 	return fence;
 }
@@ -36,3 +36,7 @@ selftest(memory_region, intel_memory_region_mock_selftests)
 selftest(iov_relay, selftest_mock_iov_relay)
 selftest(iov_service, selftest_mock_iov_service)
 selftest(iov_ggtt, selftest_mock_iov_ggtt)
+selftest(iov_sched, selftest_mock_iov_sched)
+selftest(iov_state, selftest_mock_iov_state)
+selftest(iov_provisioning, selftest_mock_iov_provisioning)
+selftest(iov_relay_perf, selftest_mock_perf_iov_relay)
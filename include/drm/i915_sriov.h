@@ -3,6 +3,8 @@
 #include <linux/pci.h>
 #include <linux/types.h>
 
+struct intel_iov_state_stream;
+
 int i915_sriov_pause_vf(struct pci_dev *pdev, unsigned int vfid);
 int i915_sriov_resume_vf(struct pci_dev *pdev, unsigned int vfid);
 
@@ -15,6 +17,14 @@ ssize_t i915_sriov_ggtt_save(struct pci_dev *pdev, unsigned int vfid, unsigned i
 int
 i915_sriov_ggtt_load(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
 		     const void *buf, size_t size);
+int
+i915_sriov_ggtt_clear_dirty(struct pci_dev *pdev, unsigned int vfid, unsigned int tile);
+ssize_t
+i915_sriov_ggtt_save_dirty(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
+			   void *buf, size_t size);
+int
+i915_sriov_ggtt_load_dirty(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
+			   const void *buf, size_t size);
 
 ssize_t
 i915_sriov_fw_state_size(struct pci_dev *pdev, unsigned int vfid,
@@ -26,6 +36,18 @@ int
 i915_sriov_fw_state_load(struct pci_dev *pdev, unsigned int vfid, unsigned int tile,
 			 const void *buf, size_t size);
 
+struct intel_iov_state_stream *
+i915_sriov_state_save_begin(struct pci_dev *pdev, unsigned int vfid, unsigned int tile);
+ssize_t
+i915_sriov_state_save_next_chunk(struct intel_iov_state_stream *stream, void *buf, size_t size);
+void i915_sriov_state_save_end(struct intel_iov_state_stream *stream);
+struct intel_iov_state_stream *
+i915_sriov_state_restore_begin(struct pci_dev *pdev, unsigned int vfid, unsigned int tile);
+ssize_t
+i915_sriov_state_restore_next_chunk(struct intel_iov_state_stream *stream,
+				    const void *buf, size_t size);
+int i915_sriov_state_restore_end(struct intel_iov_state_stream *stream);
+
 ssize_t
 i915_sriov_lmem_size(struct pci_dev *pdev, unsigned int vfid, unsigned int tile);
 void *i915_sriov_lmem_map(struct pci_dev *pdev, unsigned int vfid, unsigned int tile);